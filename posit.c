@@ -1,46 +1,9 @@
-#include <math.h>
+#include <pthread.h>
 #include <stdio.h>
-#include <stdbool.h>
-#include <string.h>
 #include <stdlib.h>
+#include "posit8.h"
 
-typedef unsigned char posit8; // posit with 8 bits and exponent size 0
-
-typedef struct posit_values
-{
-    bool sign;
-    int k;
-    unsigned char exp;
-    unsigned char frac;
-    unsigned char fracLength;
-
-    bool inf;
-    bool zero;
-} posit_values;
-
-
-int clz(char c)
-{
-    unsigned int n = 0;
-    if (c == 0)
-        return 8;
-
-    if ((c & 0xF0) == 0)
-    {
-        n = n + 4;
-        c = c << 4;
-    }
-    if ((c & 0xC0) == 0)
-    {
-        n = n + 2;
-        c = c << 2;
-    }
-    if ((c & 0x80) == 0)
-    {
-        n = n + 1;
-    }
-    return n;
-}
+// host side extensions of the posit8 library in posit8.h: lookup tables and vectorized batch APIs
 
 void printBits(size_t const size, void const *const ptr)
 {
@@ -59,654 +22,474 @@ void printBits(size_t const size, void const *const ptr)
     puts("");
 }
 
-posit8 twosComplement(posit8 input)
-{
-    input = ~input;
-    input = input + 1;
-    return input;
-}
+// lookup tables with the results of all 256 x 256 operand pairs,
+// indexed by (a << 8) | b and filled by the reference functions of posit8.h
+#define LUT_INDEX(a, b) (((unsigned int)(a) << 8) | (b))
 
-void extractPositValues(posit8 input, posit_values *output)
-{
-    output->exp = 0x0; //allways zero by definition
+// 3 bytes of padding so the vectorized lookups can gather 4 bytes at the last index
+static posit8 addLut[256 * 256 + 3];
+static posit8 subLut[256 * 256 + 3];
+static posit8 multLut[256 * 256 + 3];
+static posit8 divLut[256 * 256 + 3];
 
-    if (input == 0x0)
-    {
-        output->zero = true;
-        output->inf = false;
-        output->sign = false;
-        output->k = 0;
-        output->frac = 0x0;
-        output->fracLength = 0;
-    }
-    else if (input == 0x80)
-    {
-        output->zero = false;
-        output->inf = true;
-        output->sign = true;
-        output->k = 0;
-        output->frac = 0x0;
-        output->fracLength = 0;
-    }
-    else
-    {
-        output->sign = input >> 7;
-        // if negative make two's complement
-        if (output->sign)
-        {
-            input = twosComplement(input);
-        }
+// value of every posit8 as float and as fixed point number with 6 fraction bits (0 for NaR)
+static float floatLut[256];
+static int fixedLut[256];
 
-        // regime bits consisting of zeros
-        int regime_bits = clz(input << 1);
-        output->k = -1 * regime_bits;
+static pthread_once_t lutOnce = PTHREAD_ONCE_INIT;
 
-        if (regime_bits == 0)
+static void fillPosit8Lut(void)
+{
+    for (unsigned int a = 0; a < 256; a++)
+    {
+        for (unsigned int b = 0; b < 256; b++)
         {
-            // regime bits consisting of ones
-            unsigned char temp = ~(input << 1); // make bitshift before inverting for all-1-case
-            regime_bits = clz(temp);
-            output->k = regime_bits - 1;
+            addPosit8(a, b, &addLut[LUT_INDEX(a, b)]);
+            subPosit8(a, b, &subLut[LUT_INDEX(a, b)]);
+            multPosit8(a, b, &multLut[LUT_INDEX(a, b)]);
+            divPosit8(a, b, &divLut[LUT_INDEX(a, b)]);
         }
 
-        // flush sign and regime
-        if (regime_bits < 7)
-        {
-            output->fracLength = 8 - (regime_bits + 2); //mask all the regime bits (regime_bits + 1) + the sign bit (1)
-        }
-        else
-        {
-            output->fracLength = 0;
-        }
-        if (output->fracLength > 0)
-        {
-            unsigned char mask = ((1 << output->fracLength) - 1);
-            output->frac = input & mask;
-        }
-        else
-        {
-            output->frac = 0x0;
-        }
+        double value;
+        posit8ToDouble(a, &value);
+        floatLut[a] = a == 0x80 ? NAN : value;
+        fixedLut[a] = a == 0x80 ? 0 : value * 64;
     }
 }
 
-void posit8ToDouble(posit8 posit, double *output)
+// fills the tables on the first call, threads calling it at the same time wait for that
+void initPosit8Lut()
 {
-    posit_values pval;
-    extractPositValues(posit, &pval);
-    double fraction_max = pow(2, pval.fracLength);
-    double fracVal = 1 + ((double)pval.frac / fraction_max);
-    if (posit == 0x0)
-    {
-        *output = 0;
-    }
-    else
-    {
-        *output = pow(-1, pval.sign) * pow(2, pval.k) * fracVal;
-    }
+    pthread_once(&lutOnce, fillPosit8Lut);
 }
 
-char convertFraction(double doubleFraction, unsigned int fracLength)
+// table based versions of the arithmetic functions, initPosit8Lut() has to be called once before use
+void addPosit8Lut(posit8 a, posit8 b, posit8 *result)
 {
-    char positFraction = 0x0;
-    unsigned int fracCounter = fracLength;
-    double temp = 1;
-    while (fracCounter > 0)
-    {
-        temp /= 2;
-
-        if (doubleFraction >= temp)
-        {
-            // shift in 1
-            positFraction <<= 1;
-            positFraction += 1;
-            doubleFraction -= temp;
-        }
-        else
-        {
-            // shift in 0
-            positFraction <<= 1;
-        }
-        fracCounter--;
-    }
-    return positFraction;
+    *result = addLut[LUT_INDEX(a, b)];
 }
 
-void doubleToPosit8(double doubleInput, posit8 *out)
+void subPosit8Lut(posit8 a, posit8 b, posit8 *result)
 {
-    char output = 0x0;
-    unsigned int sign;
-    unsigned int regimeLength;
-    double tempDoubleInput;
-    unsigned int regimeIsOnes;
-    // extract sign
-    (doubleInput >= 0) ? (sign = 0) : (sign = 1);
+    *result = subLut[LUT_INDEX(a, b)];
+}
 
-    if (doubleInput == 0)
-    {
-        // check for zero
-        output = 0;
-    }
-    else if (isinf(doubleInput) || isnan(doubleInput))
-    {
-        // check for infinity
-        output = 0x80;
-    }
-    else if (doubleInput >= 64)
-    {
-        // check for maxpos
-        output = 0x7F;
-    }
-    else if (doubleInput <= -64)
-    {
-        // check for minpos
-        output = 0x81;
-    }
-    else if (doubleInput <= 0.015625 && !sign)
-    {
-        // check for +minpos
-        output = 0x1;
-    }
-    else if (doubleInput >= -0.015625 && sign)
-    {
-        // check for -minpos
-        output = 0xFF;
-    }
-    else
-    {
-        if (sign)
-        {
-            // Make negative numbers positive for easier computation
-            doubleInput = -doubleInput;
-        }
+void multPosit8Lut(posit8 a, posit8 b, posit8 *result)
+{
+    *result = multLut[LUT_INDEX(a, b)];
+}
 
-        tempDoubleInput = doubleInput;
+void divPosit8Lut(posit8 a, posit8 b, posit8 *result)
+{
+    *result = divLut[LUT_INDEX(a, b)];
+}
 
-        // check if regime is composed of ones
-        if (doubleInput > 1 || doubleInput < -1)
-        {
-            regimeIsOnes = 1;
-            regimeLength = 1; // because k = m - 1 we need to add one
-            while (tempDoubleInput >= 2)
-            {
-                tempDoubleInput /= 2;
-                regimeLength++;
-            }
-        }
-        // regime is composed of zeros
-        else
-        {
-            regimeIsOnes = 0;
-            regimeLength = 0; // because k = m
-            while (tempDoubleInput < 1)
-            {
-                tempDoubleInput *= 2;
-                regimeLength++;
-            }
-        }
+// batch versions of the posit8 operations for whole arrays. They use AVX-512 or AVX2 when the
+// cpu supports it (checked at runtime) and fall back to the scalar lookup tables otherwise,
+// all paths give the same results as the scalar reference functions (test/verify.c runs each).
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define POSIT8_X86_SIMD
+#include <immintrin.h>
+#endif
 
-        double doubleFraction = tempDoubleInput - 1; // remove hidden bit (1.0101010)
-        unsigned int fracLength = 6 - regimeLength;
-        char positFraction = convertFraction(doubleFraction, fracLength);
+// instruction sets of the batch functions, ordered by width
+#define POSIT8_SIMD_SCALAR 0
+#define POSIT8_SIMD_AVX2 1
+#define POSIT8_SIMD_AVX512 2
 
-        output = 0x0;
+static int simdLevelLimit = POSIT8_SIMD_AVX512;
 
-        for (int i = 0; i < regimeLength; i++)
-        {
-            output = (output << 1) + regimeIsOnes;
-        }
-        output = (output << 1) + !regimeIsOnes;
-        output = (output << fracLength);
-        output |= positFraction;
+bool cpuHasAvx2()
+{
+#ifdef POSIT8_X86_SIMD
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
 
-        if (sign)
-        {
-            output = twosComplement(output);
-        }
-    }
-    *out = output;
+bool cpuHasAvx512()
+{
+#ifdef POSIT8_X86_SIMD
+    return __builtin_cpu_supports("avx512f");
+#else
+    return false;
+#endif
 }
 
-char kToRegime(int k)
+// widest instruction set the batch functions use, the limit and the cpu allow it
+int posit8SimdLevel()
 {
-    if (k >= 6)
-    {
-        // regime is only 1s
-        return (1 << 7) - 1;
-    }
-    if (k <= -7)
+    if (simdLevelLimit >= POSIT8_SIMD_AVX512 && cpuHasAvx512())
     {
-        // regime is only 0s
-        return 0x0;
+        return POSIT8_SIMD_AVX512;
     }
-    if (k >= 0)
+    if (simdLevelLimit >= POSIT8_SIMD_AVX2 && cpuHasAvx2())
     {
-        // k is positive, regime consists of 1s ending in 0
-        return (1 << (k + 2)) - 2;
+        return POSIT8_SIMD_AVX2;
     }
-    // k is negative and regime ends therefore with 1
-    return 0x1;
+    return POSIT8_SIMD_SCALAR;
 }
 
-int regimeLengthFromK(int k, int positSize)
+// limits the batch functions to level, e.g. so a test runs the narrower paths on a wide cpu.
+// Returns the level that is used, lower than requested if the cpu does not support it.
+int setPosit8SimdLevel(int level)
 {
-    int result = 0;
+    simdLevelLimit = level;
+    return posit8SimdLevel();
+}
 
-    if (k >= 0)
+#ifdef POSIT8_X86_SIMD
+
+// one result byte per 32 bit lane is moved to the lowest 8 bytes of the register
+__attribute__((target("avx2"))) static __m128i packLowBytesAvx2(__m256i values)
+{
+    const __m256i shuffle = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                             0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i laneOrder = _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1);
+    values = _mm256_shuffle_epi8(values, shuffle);
+    values = _mm256_permutevar8x32_epi32(values, laneOrder);
+    return _mm256_castsi256_si128(values);
+}
+
+// looks up (a << 8) | b in one of the 64K tables, 4 bytes are gathered per lane and the first one is kept
+__attribute__((target("avx2"))) static void lutPosit8ArrayAvx2(const posit8 *lut, const posit8 *a, const posit8 *b, posit8 *result, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
     {
-        result = k + 2;
+        __m256i valuesA = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(a + i)));
+        __m256i valuesB = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(b + i)));
+        __m256i index = _mm256_or_si256(_mm256_slli_epi32(valuesA, 8), valuesB);
+        __m256i values = _mm256_i32gather_epi32((const int *)lut, index, 1);
+        _mm_storel_epi64((__m128i *)(result + i), packLowBytesAvx2(values));
     }
-    else if (k < 0)
+    for (; i < n; i++)
     {
-        result = -k + 1;
+        result[i] = lut[LUT_INDEX(a[i], b[i])];
     }
+}
 
-    if (result > positSize - 1)
+__attribute__((target("avx512f"))) static void lutPosit8ArrayAvx512(const posit8 *lut, const posit8 *a, const posit8 *b, posit8 *result, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
     {
-        result = positSize - 1;
+        __m512i valuesA = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(a + i)));
+        __m512i valuesB = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(b + i)));
+        __m512i index = _mm512_or_si512(_mm512_slli_epi32(valuesA, 8), valuesB);
+        __m512i values = _mm512_i32gather_epi32(index, (const int *)lut, 1);
+        _mm_storeu_si128((__m128i *)(result + i), _mm512_cvtepi32_epi8(values));
+    }
+    for (; i < n; i++)
+    {
+        result[i] = lut[LUT_INDEX(a[i], b[i])];
     }
-    return result;
 }
 
-void addHiddenBitToFraction(posit_values *a)
+__attribute__((target("avx2"))) static void posit8ToFloatArrayAvx2(const posit8 *input, float *output, size_t n)
 {
-    char hiddenBit = 0x1;
-    hiddenBit <<= a->fracLength;
-    a->frac |= hiddenBit;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(input + i)));
+        _mm256_storeu_ps(output + i, _mm256_i32gather_ps(floatLut, index, 4));
+    }
+    for (; i < n; i++)
+    {
+        output[i] = floatLut[input[i]];
+    }
 }
 
-void multPosit8(posit8 a, posit8 b, posit8 *result)
+__attribute__((target("avx512f"))) static void posit8ToFloatArrayAvx512(const posit8 *input, float *output, size_t n)
 {
-    *result = 0x0;
-    if (a == 0x0)
-    {
-        *result = 0x0;
-    }
-    else if (b == 0x0)
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
     {
-        *result = 0x0;
+        __m512i index = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(input + i)));
+        _mm512_storeu_ps(output + i, _mm512_i32gather_ps(index, floatLut, 4));
     }
-    else if (a == 0x80 || b == 0x80)
+    for (; i < n; i++)
     {
-        *result = 0x80;
+        output[i] = floatLut[input[i]];
     }
-    else
+}
+
+// same conversion as floatToPosit8, done on the float bits: the exponent gives k and with it
+// the regime, regime and mantissa are concatenated, cut down to 7 bits and rounded to nearest even
+__attribute__((target("avx2"))) static void floatToPosit8ArrayAvx2(const float *input, posit8 *output, size_t n)
+{
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
     {
-        // extracting posit values
-        posit_values valuesA;
-        extractPositValues(a, &valuesA);
-        posit_values valuesB;
-        extractPositValues(b, &valuesB);
-        bool sign = valuesA.sign ^ valuesB.sign;
+        __m256 x = _mm256_loadu_ps(input + i);
+        __m256 absX = _mm256_and_ps(x, absMask);
+        __m256i bits = _mm256_castps_si256(absX);
 
-        // adding scales of a and b
-        int newK = valuesA.k + valuesB.k;
+        // k is clamped so all shifts stay in range, inputs outside of it are replaced below
+        __m256i k = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+        k = _mm256_min_epi32(_mm256_max_epi32(k, _mm256_set1_epi32(-6)), _mm256_set1_epi32(5));
+        __m256i positiveK = _mm256_cmpgt_epi32(k, _mm256_set1_epi32(-1));
 
-        // adding hidden bit to fraction
-        addHiddenBitToFraction(&valuesA);
-        addHiddenBitToFraction(&valuesB);
+        __m256i regimeLength = _mm256_blendv_epi8(_mm256_sub_epi32(one, k), _mm256_add_epi32(k, _mm256_set1_epi32(2)), positiveK);
+        __m256i regime = _mm256_blendv_epi8(one, _mm256_sub_epi32(_mm256_sllv_epi32(one, _mm256_add_epi32(k, _mm256_set1_epi32(2))), _mm256_set1_epi32(2)), positiveK);
+        __m256i body = _mm256_or_si256(_mm256_slli_epi32(regime, 23), _mm256_and_si256(bits, _mm256_set1_epi32(0x7FFFFF)));
+        __m256i shift = _mm256_add_epi32(regimeLength, _mm256_set1_epi32(16));
+        __m256i result = _mm256_srlv_epi32(body, shift);
 
-        // keeping track of shift value for position of hidden bit
-        int fracLength;
+        // round to nearest even, the masks are -1 where true so subtracting them adds one
+        __m256i half = _mm256_sllv_epi32(one, _mm256_sub_epi32(shift, one));
+        __m256i rest = _mm256_and_si256(body, _mm256_sub_epi32(_mm256_sllv_epi32(one, shift), one));
+        __m256i odd = _mm256_cmpeq_epi32(_mm256_and_si256(result, one), one);
+        __m256i roundUp = _mm256_or_si256(_mm256_cmpgt_epi32(rest, half), _mm256_and_si256(_mm256_cmpeq_epi32(rest, half), odd));
+        result = _mm256_sub_epi32(result, roundUp);
 
-        // shifting the mantissa of the smaller factor so both are of equal scaling
-        if (valuesA.fracLength > valuesB.fracLength)
-        {
-            valuesB.frac <<= valuesA.fracLength - valuesB.fracLength;
-            //fracLength = 2 * valuesA.fracLength;
-            fracLength = valuesA.fracLength << 1;
-        }
-        else
-        {
-            valuesA.frac <<= valuesB.fracLength - valuesA.fracLength;
-            //fracLength = 2 * valuesB.fracLength;
-            fracLength = valuesB.fracLength << 1;
-        }
+        result = _mm256_blendv_epi8(result, _mm256_set1_epi32(0x7F), _mm256_castps_si256(_mm256_cmp_ps(absX, _mm256_set1_ps(64), _CMP_GE_OQ)));
+        result = _mm256_blendv_epi8(result, one, _mm256_castps_si256(_mm256_cmp_ps(absX, _mm256_set1_ps(0.015625), _CMP_LT_OQ)));
 
-        // calculating product of aligned mantissas
-        unsigned int intResult = valuesA.frac * valuesB.frac;
+        __m256i negative = _mm256_srai_epi32(_mm256_castps_si256(x), 31);
+        result = _mm256_blendv_epi8(result, _mm256_and_si256(_mm256_sub_epi32(_mm256_setzero_si256(), result), byteMask), negative);
 
-        {
-            if (intResult >> fracLength + 1 > 0)
-            {
-                newK++;
-                fracLength++;
-            }
-
-            if (fracLength > 0)
-            {
-                // mask hidden bit
-                intResult &= 0xffffffff >> 32 - fracLength;
-            }
-            else
-            {
-                intResult = 0x0;
-            }
-        }
+        __m256 zero = _mm256_cmp_ps(absX, _mm256_setzero_ps(), _CMP_EQ_OQ);
+        __m256 nar = _mm256_or_ps(_mm256_cmp_ps(absX, absX, _CMP_UNORD_Q), _mm256_cmp_ps(absX, _mm256_set1_ps(INFINITY), _CMP_EQ_OQ));
+        result = _mm256_andnot_si256(_mm256_castps_si256(zero), result);
+        result = _mm256_blendv_epi8(result, _mm256_set1_epi32(0x80), _mm256_castps_si256(nar));
 
-        int newRegimeLength = regimeLengthFromK(newK, 8);
-        int resultFracLength = 8 - newRegimeLength - 1;
+        _mm_storel_epi64((__m128i *)(output + i), packLowBytesAvx2(result));
+    }
+    for (; i < n; i++)
+    {
+        floatToPosit8(input[i], &output[i]);
+    }
+}
 
-        unsigned int carryCondition = intResult & 0xffffffff >> 32 - (fracLength - resultFracLength);
-        bool carryBit = 0;
+__attribute__((target("avx512f"))) static void floatToPosit8ArrayAvx512(const float *input, posit8 *output, size_t n)
+{
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i byteMask = _mm512_set1_epi32(0xFF);
 
-        // check if rest of mantissa that is not used in new posit is bigger than (0.)100
-        // if so carry bit is one and will be added in the end
-        if ((fracLength - resultFracLength) > 1 && carryCondition > (0x1 << (fracLength - resultFracLength) - 1))
-        {
-            carryBit = 1;
-        }
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i rawBits = _mm512_loadu_si512(input + i);
+        __m512i bits = _mm512_and_si512(rawBits, _mm512_set1_epi32(0x7FFFFFFF));
+        __m512 absX = _mm512_castsi512_ps(bits);
 
-        // determine new regime length
-        newRegimeLength = regimeLengthFromK(newK, 8);
+        __m512i k = _mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(127));
+        k = _mm512_min_epi32(_mm512_max_epi32(k, _mm512_set1_epi32(-6)), _mm512_set1_epi32(5));
+        __mmask16 positiveK = _mm512_cmpgt_epi32_mask(k, _mm512_set1_epi32(-1));
 
-        // transform k value to regime bits
-        char newRegime = kToRegime(newK);
+        __m512i regimeLength = _mm512_mask_blend_epi32(positiveK, _mm512_sub_epi32(one, k), _mm512_add_epi32(k, _mm512_set1_epi32(2)));
+        __m512i regime = _mm512_mask_blend_epi32(positiveK, one, _mm512_sub_epi32(_mm512_sllv_epi32(one, _mm512_add_epi32(k, _mm512_set1_epi32(2))), _mm512_set1_epi32(2)));
+        __m512i body = _mm512_or_si512(_mm512_slli_epi32(regime, 23), _mm512_and_si512(bits, _mm512_set1_epi32(0x7FFFFF)));
+        __m512i shift = _mm512_add_epi32(regimeLength, _mm512_set1_epi32(16));
+        __m512i result = _mm512_srlv_epi32(body, shift);
 
-        // calculate length of mantissa bits
-        resultFracLength = 8 - newRegimeLength - 1;
-        int fracShift = fracLength - resultFracLength;
-        unsigned char newFrac;
-        if (fracShift > 0)
-        {
-            newFrac = intResult >> fracShift;
-        }
-        else
-        {
-            newFrac = intResult << -fracShift;
-        }
+        // round to nearest even
+        __m512i half = _mm512_sllv_epi32(one, _mm512_sub_epi32(shift, one));
+        __m512i rest = _mm512_and_si512(body, _mm512_sub_epi32(_mm512_sllv_epi32(one, shift), one));
+        __mmask16 roundUp = _mm512_cmpgt_epi32_mask(rest, half) | (_mm512_cmpeq_epi32_mask(rest, half) & _mm512_test_epi32_mask(result, one));
+        result = _mm512_mask_add_epi32(result, roundUp, result, one);
 
-        *result |= newRegime << resultFracLength;
+        result = _mm512_mask_blend_epi32(_mm512_cmp_ps_mask(absX, _mm512_set1_ps(64), _CMP_GE_OQ), result, _mm512_set1_epi32(0x7F));
+        result = _mm512_mask_blend_epi32(_mm512_cmp_ps_mask(absX, _mm512_set1_ps(0.015625), _CMP_LT_OQ), result, one);
 
-        if (resultFracLength > 0)
-        {
-            *result |= newFrac;
-        }
+        __mmask16 negative = _mm512_cmplt_epi32_mask(rawBits, _mm512_setzero_si512());
+        result = _mm512_mask_blend_epi32(negative, result, _mm512_and_si512(_mm512_sub_epi32(_mm512_setzero_si512(), result), byteMask));
 
-        if (*result != 0x7f && (carryBit || ((*result & 0x1) == 1 && carryCondition == (0x1 << (fracLength - resultFracLength) - 1))))
-        {
-            *result += 1;
-        }
+        __mmask16 zero = _mm512_cmp_ps_mask(absX, _mm512_setzero_ps(), _CMP_EQ_OQ);
+        __mmask16 nar = _mm512_cmp_ps_mask(absX, absX, _CMP_UNORD_Q) | _mm512_cmp_ps_mask(absX, _mm512_set1_ps(INFINITY), _CMP_EQ_OQ);
+        result = _mm512_mask_blend_epi32(zero, result, _mm512_setzero_si512());
+        result = _mm512_mask_blend_epi32(nar, result, _mm512_set1_epi32(0x80));
 
-        // per definition posits never drop to zero
-        if (*result == 0x0)
-        {
-            *result = 0x1;
-        }
-        if (sign)
-        {
-            *result = twosComplement(*result);
-        }
+        _mm_storeu_si128((__m128i *)(output + i), _mm512_cvtepi32_epi8(result));
+    }
+    for (; i < n; i++)
+    {
+        floatToPosit8(input[i], &output[i]);
     }
 }
 
-void divPosit8(posit8 a, posit8 b, posit8 *result)
+// every posit8 is a multiple of 2^-6 below 2^7, so the products of the fixed point values
+// are exact quire values and can be summed with plain integer arithmetic
+__attribute__((target("avx2"))) static void dotPosit8Avx2(const posit8 *a, const posit8 *b, size_t n, quire8 *q)
 {
-    *result = 0x0;
-    if (a == 0x0)
+    __m256i sum = _mm256_setzero_si256();
+    __m256i nar = _mm256_setzero_si256();
+    const __m256i narPattern = _mm256_set1_epi32(0x80);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
     {
-        *result = 0x0;
+        __m256i indexA = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(a + i)));
+        __m256i indexB = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(b + i)));
+        nar = _mm256_or_si256(nar, _mm256_cmpeq_epi32(indexA, narPattern));
+        nar = _mm256_or_si256(nar, _mm256_cmpeq_epi32(indexB, narPattern));
+
+        __m256i product = _mm256_mullo_epi32(_mm256_i32gather_epi32(fixedLut, indexA, 4), _mm256_i32gather_epi32(fixedLut, indexB, 4));
+        sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(product)));
+        sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(product, 1)));
     }
-    else if (b == 0x0)
+
+    long long lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, sum);
+    *q += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    if (!_mm256_testz_si256(nar, nar))
     {
-        *result = NAN;
+        *q = QUIRE8_NAR;
     }
-    else if (a == 0x80 || b == 0x80)
+
+    for (; i < n; i++)
     {
-        *result = 0x80;
+        fdpPosit8(q, a[i], b[i]);
     }
-    else
-    {
-        // extracting posit values
-        posit_values valuesA;
-        extractPositValues(a, &valuesA);
-        posit_values valuesB;
-        extractPositValues(b, &valuesB);
-        bool sign = valuesA.sign ^ valuesB.sign;
-
-        // subtracting scales of a and b
-        int newK = valuesA.k - valuesB.k;
-
-        // adding hidden bit to fraction
-        addHiddenBitToFraction(&valuesA);
-        addHiddenBitToFraction(&valuesB);
-
-        valuesB.frac <<= 7 - valuesB.fracLength;
-        valuesA.frac <<= 7 - valuesA.fracLength;
-
-        unsigned int dividend = valuesA.frac << 7;
-
-        unsigned int quot = dividend / valuesB.frac;
-        unsigned int rem = dividend % valuesB.frac;
-
-        if (quot != 0)
-        {
-            bool rcarry = quot >> 7; // this is the hidden bit (7th bit) , extreme right bit is bit 0
-            if (!rcarry)
-            {
-                newK--;
-                quot <<= 1;
-            }
-        }
-
-        // determine new regime length
-        unsigned int newRegimeLength = regimeLengthFromK(newK, 8);
-
-        // transform k value to regime bits
-        char newRegime = kToRegime(newK);
-
-        int resultFracLength = 8 - newRegimeLength - 1;
-
-        newRegime <<= resultFracLength;
+}
 
-        *result = newRegime;
+__attribute__((target("avx512f"))) static void dotPosit8Avx512(const posit8 *a, const posit8 *b, size_t n, quire8 *q)
+{
+    __m512i sum = _mm512_setzero_si512();
+    __mmask16 nar = 0;
+    const __m512i narPattern = _mm512_set1_epi32(0x80);
 
-        int scale;
-        if (newK < 0)
-        {
-            scale = -newK;
-        }
-        else
-        {
-            scale = newK + 1;
-        }
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i indexA = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(a + i)));
+        __m512i indexB = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(b + i)));
+        nar |= _mm512_cmpeq_epi32_mask(indexA, narPattern) | _mm512_cmpeq_epi32_mask(indexB, narPattern);
 
-        quot &= 0x7F;
-        unsigned char newFrac = quot;
-        newFrac >>= scale + 1;
+        __m512i product = _mm512_mullo_epi32(_mm512_i32gather_epi32(indexA, fixedLut, 4), _mm512_i32gather_epi32(indexB, fixedLut, 4));
+        sum = _mm512_add_epi64(sum, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(product)));
+        sum = _mm512_add_epi64(sum, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(product, 1)));
+    }
 
-        *result |= newFrac;
+    *q += _mm512_reduce_add_epi64(sum);
+    if (nar)
+    {
+        *q = QUIRE8_NAR;
+    }
 
-        bool guard = (bool)(0x1 & quot >> scale);
-        if (guard)
-        {
-            bool roundSticky = (((1 << scale) - 1) & quot) ? 1 : 0;
-            if (rem > 0 || roundSticky || ((*result & 0x1) == 1 && !roundSticky))
-            {
-                *result += 1;
-            }
-        }
+    for (; i < n; i++)
+    {
+        fdpPosit8(q, a[i], b[i]);
+    }
+}
 
-        if (*result == 0x0)
-        {
-            *result = 0x1;
-        }
+#endif
 
-        if (sign)
-        {
-            *result = twosComplement(*result);
-        }
+void addPosit8Array(const posit8 *a, const posit8 *b, posit8 *result, size_t n)
+{
+    initPosit8Lut();
+#ifdef POSIT8_X86_SIMD
+    const int level = posit8SimdLevel();
+    if (level == POSIT8_SIMD_AVX512)
+    {
+        lutPosit8ArrayAvx512(addLut, a, b, result, n);
+        return;
+    }
+    if (level == POSIT8_SIMD_AVX2)
+    {
+        lutPosit8ArrayAvx2(addLut, a, b, result, n);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < n; i++)
+    {
+        addPosit8Lut(a[i], b[i], &result[i]);
     }
 }
 
-void addPosit8(posit8 a, posit8 b, posit8 *result)
+void multPosit8Array(const posit8 *a, const posit8 *b, posit8 *result, size_t n)
 {
-    *result = 0x0;
-    if (a == 0x0)
+    initPosit8Lut();
+#ifdef POSIT8_X86_SIMD
+    const int level = posit8SimdLevel();
+    if (level == POSIT8_SIMD_AVX512)
     {
-        *result = b;
+        lutPosit8ArrayAvx512(multLut, a, b, result, n);
+        return;
     }
-    else if (b == 0x0)
+    if (level == POSIT8_SIMD_AVX2)
     {
-        *result = a;
+        lutPosit8ArrayAvx2(multLut, a, b, result, n);
+        return;
     }
-    else if (a == 0x80 || b == 0x80)
+#endif
+    for (size_t i = 0; i < n; i++)
     {
-        *result = 0x80;
+        multPosit8Lut(a[i], b[i], &result[i]);
     }
-    else if (twosComplement(a) == b)
+}
+
+void posit8ToFloatArray(const posit8 *input, float *output, size_t n)
+{
+    initPosit8Lut();
+#ifdef POSIT8_X86_SIMD
+    const int level = posit8SimdLevel();
+    if (level == POSIT8_SIMD_AVX512)
     {
-        *result = 0x0;
+        posit8ToFloatArrayAvx512(input, output, n);
+        return;
     }
-    else
+    if (level == POSIT8_SIMD_AVX2)
     {
-
-        posit_values valuesA;
-        extractPositValues(a, &valuesA);
-        posit_values valuesB;
-        extractPositValues(b, &valuesB);
-
-        bool newSign = 0;
-
-        posit8 compA = a;
-        if (valuesA.sign == 1)
-        {
-            compA = twosComplement(a);
-        }
-
-        posit8 compB = b;
-        if (valuesB.sign == 1)
-        {
-            compB = twosComplement(b);
-        }
-        newSign = (compA > compB) ? valuesA.sign : valuesB.sign;
-
-        // compute scale factor
-        int newK = valuesA.k;
-        addHiddenBitToFraction(&valuesA);
-        addHiddenBitToFraction(&valuesB);
-
-        if (valuesA.k > valuesB.k)
-        {
-            valuesB.fracLength += valuesA.k - valuesB.k;
-            newK = valuesA.k;
-        }
-        else if (valuesA.k < valuesB.k)
-        {
-            valuesA.fracLength += valuesB.k - valuesA.k;
-            newK = valuesB.k;
-        }
-
-        int fracLength;
-        unsigned int fracA, fracB;
-        if (valuesA.fracLength > valuesB.fracLength)
-        {
-            fracB = valuesB.frac << valuesA.fracLength - valuesB.fracLength;
-            fracA = valuesA.frac;
-            fracLength = valuesA.fracLength;
-        }
-        else
-        {
-            fracA = valuesA.frac << valuesB.fracLength - valuesA.fracLength;
-            fracB = valuesB.frac;
-            fracLength = valuesB.fracLength;
-        }
-        unsigned int tempFrac;
-
-        if (valuesA.sign == valuesB.sign)
-        {
-            tempFrac = fracA + fracB;
-        }
-        else
-        {
-            if (fracA > fracB)
-            {
-                tempFrac = fracA - fracB;
-            }
-
-            else
-            {
-                tempFrac = fracB - fracA;
-            }
-        }
-
-        {
-            if (tempFrac >> fracLength + 1 > 0)
-            {
-                newK++;
-                fracLength++;
-            }
-            else
-            {
-                while (tempFrac >> fracLength == 0 && fracLength > 0)
-                {
-                    newK--;
-                    fracLength--;
-                }
-            }
-
-            if (fracLength > 0)
-            {
-                // mask hidden bit
-                tempFrac &= 0xffffffff >> 32 - fracLength;
-            }
-            else
-            {
-                tempFrac = 0x0;
-            }
-        }
-
-        int newRegimeLength = regimeLengthFromK(newK, 8);
-        int resultFracLength = 8 - newRegimeLength - 1;
-        int fractionShiftValue = fracLength - resultFracLength;
-
-        unsigned int cond = tempFrac & (0xffffffff >> 32 - (fracLength - resultFracLength));
-
-        bool carryBit = 0;
-        if ((fracLength - resultFracLength) > 0 && cond > (0x1 << (fracLength - resultFracLength) - 1))
-        {
-            carryBit = 1;
-        }
-        char newRegime = kToRegime(newK);
-        unsigned char newFrac = tempFrac;
-
-        *result = 0x0 << 7;
-        *result |= newRegime << resultFracLength;
-
-        if (resultFracLength > 0)
-        {
-            if (fractionShiftValue > 0)
-            {
-                *result |= (tempFrac >> fractionShiftValue);
-            }
-            else
-            {
-                *result |= (tempFrac << -fractionShiftValue);
-            }
-        }
-
-        if (carryBit || (((*result & 0x1) == 1 && cond == (0x1 << (fracLength - resultFracLength) - 1)) && *result != 0x7f))
-        {
-            *result += 1;
-        }
-
-        if (newSign == 1)
-        {
-            *result = twosComplement(*result);
-        }
+        posit8ToFloatArrayAvx2(input, output, n);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < n; i++)
+    {
+        output[i] = floatLut[input[i]];
     }
 }
 
-void subPosit8(posit8 a, posit8 b, posit8 *result)
+void floatToPosit8Array(const float *input, posit8 *output, size_t n)
 {
-    *result = 0x0;
-    posit8 negative = twosComplement(b);
-    addPosit8(a, negative, result);
+#ifdef POSIT8_X86_SIMD
+    const int level = posit8SimdLevel();
+    if (level == POSIT8_SIMD_AVX512)
+    {
+        floatToPosit8ArrayAvx512(input, output, n);
+        return;
+    }
+    if (level == POSIT8_SIMD_AVX2)
+    {
+        floatToPosit8ArrayAvx2(input, output, n);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < n; i++)
+    {
+        floatToPosit8(input[i], &output[i]);
+    }
 }
 
-void sigmoidPosit8(posit8 *x)
+// dot product of two posit8 arrays with a single rounding at the end
+void dotPosit8(const posit8 *a, const posit8 *b, size_t n, posit8 *result)
 {
-    *x = *x ^ (1 << 7);
-    *x >>= 2;
+    quire8 q = 0;
+    initPosit8Lut();
+#ifdef POSIT8_X86_SIMD
+    const int level = posit8SimdLevel();
+    if (level == POSIT8_SIMD_AVX512)
+    {
+        dotPosit8Avx512(a, b, n, &q);
+    }
+    else if (level == POSIT8_SIMD_AVX2)
+    {
+        dotPosit8Avx2(a, b, n, &q);
+    }
+    else
+#endif
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            fdpPosit8(&q, a[i], b[i]);
+        }
+    }
+    quire8ToPosit8(q, result);
 }
-
@@ -0,0 +1,191 @@
+// C++ value type for posit<nbits, es>, built on the generic routines of positn.h (needs C++14).
+//
+// Posit<nbits, es> stores the encoding in the smallest unsigned integer that holds nbits. The
+// arithmetic is constexpr, the conversions from and to double are not. For posit8 with es = 0
+// the table based Posit8 of posit8.hpp is faster, Posit<8, 0> gives the same results.
+#ifndef POSIT_HPP
+#define POSIT_HPP
+
+#if __cplusplus < 201402L
+#error "posit.hpp needs C++14"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include "positn.h"
+
+template <int nbits, int es>
+class Posit
+{
+    static_assert(nbits >= 3 && nbits <= 32, "posit.hpp supports 3 to 32 bits");
+    static_assert(es >= 0 && es <= 4, "posit.hpp supports exponent sizes up to 4");
+
+  public:
+    typedef typename std::conditional<(nbits <= 8), uint8_t, typename std::conditional<(nbits <= 16), uint16_t, uint32_t>::type>::type
+        storage_type;
+
+    constexpr Posit() : encoding(0) {}
+    explicit Posit(double value) : encoding((storage_type)doubleToPositN(value, nbits, es)) {}
+    explicit Posit(float value) : encoding((storage_type)doubleToPositN(value, nbits, es)) {}
+    explicit Posit(int value) : encoding((storage_type)doubleToPositN(value, nbits, es)) {}
+
+    static constexpr Posit fromBits(positn bits)
+    {
+        Posit result;
+        result.encoding = (storage_type)(bits & maskPositN(nbits));
+        return result;
+    }
+    static constexpr Posit nar() { return fromBits(narPositN(nbits)); }
+
+    constexpr storage_type bits() const { return encoding; }
+    constexpr bool isNaR() const { return encoding == narPositN(nbits); }
+
+    // every posit with up to 32 bits is exact as double, NaR becomes NaN
+    explicit operator double() const { return positNToDouble(encoding, nbits, es); }
+    explicit operator float() const { return (float)positNToDouble(encoding, nbits, es); }
+
+    constexpr Posit operator+() const { return *this; }
+    constexpr Posit operator-() const { return fromBits(negPositN(encoding, nbits)); }
+
+    constexpr Posit &operator+=(Posit other)
+    {
+        encoding = (storage_type)addPositN(encoding, other.encoding, nbits, es);
+        return *this;
+    }
+    constexpr Posit &operator-=(Posit other)
+    {
+        encoding = (storage_type)subPositN(encoding, other.encoding, nbits, es);
+        return *this;
+    }
+    constexpr Posit &operator*=(Posit other)
+    {
+        encoding = (storage_type)multPositN(encoding, other.encoding, nbits, es);
+        return *this;
+    }
+    constexpr Posit &operator/=(Posit other)
+    {
+        encoding = (storage_type)divPositN(encoding, other.encoding, nbits, es);
+        return *this;
+    }
+
+  private:
+    storage_type encoding;
+};
+
+// the formats of the original posit proposal, next to posit8 with es = 0
+typedef Posit<16, 1> Posit16;
+typedef Posit<32, 2> Posit32;
+
+template <int nbits, int es>
+constexpr Posit<nbits, es> operator+(Posit<nbits, es> a, Posit<nbits, es> b) { return a += b; }
+template <int nbits, int es>
+constexpr Posit<nbits, es> operator-(Posit<nbits, es> a, Posit<nbits, es> b) { return a -= b; }
+template <int nbits, int es>
+constexpr Posit<nbits, es> operator*(Posit<nbits, es> a, Posit<nbits, es> b) { return a *= b; }
+template <int nbits, int es>
+constexpr Posit<nbits, es> operator/(Posit<nbits, es> a, Posit<nbits, es> b) { return a /= b; }
+
+// posits are ordered like their bits as two's complement integers, see posit8.hpp
+template <int nbits, int es>
+constexpr int32_t signedBits(Posit<nbits, es> a)
+{
+    return (int32_t)((uint32_t)a.bits() << (32 - nbits)) >> (32 - nbits);
+}
+
+template <int nbits, int es>
+constexpr bool operator==(Posit<nbits, es> a, Posit<nbits, es> b) { return a.bits() == b.bits(); }
+template <int nbits, int es>
+constexpr bool operator!=(Posit<nbits, es> a, Posit<nbits, es> b) { return a.bits() != b.bits(); }
+template <int nbits, int es>
+constexpr bool operator<(Posit<nbits, es> a, Posit<nbits, es> b) { return signedBits(a) < signedBits(b); }
+template <int nbits, int es>
+constexpr bool operator>(Posit<nbits, es> a, Posit<nbits, es> b) { return b < a; }
+template <int nbits, int es>
+constexpr bool operator<=(Posit<nbits, es> a, Posit<nbits, es> b) { return !(b < a); }
+template <int nbits, int es>
+constexpr bool operator>=(Posit<nbits, es> a, Posit<nbits, es> b) { return !(a < b); }
+
+// a * b + c with a single rounding
+template <int nbits, int es>
+constexpr Posit<nbits, es> fma(Posit<nbits, es> a, Posit<nbits, es> b, Posit<nbits, es> c)
+{
+    return Posit<nbits, es>::fromBits(fmaPositN(a.bits(), b.bits(), c.bits(), nbits, es));
+}
+
+template <int nbits, int es>
+constexpr Posit<nbits, es> abs(Posit<nbits, es> a) { return a < Posit<nbits, es>() && !a.isNaR() ? -a : a; }
+
+// sum of a[i * a_stride] * b[i * b_stride] for i < n, accumulated like the kernels and rounded once
+template <int nbits, int es>
+constexpr Posit<nbits, es> dot(const Posit<nbits, es> *a, size_t a_stride, const Posit<nbits, es> *b, size_t b_stride, size_t n)
+{
+    positn_unpacked acc = zeroPositN();
+    for (size_t i = 0; i < n; i++)
+    {
+        fdpPositN(&acc, a[i * a_stride].bits(), b[i * b_stride].bits(), nbits, es);
+    }
+    return Posit<nbits, es>::fromBits(roundPositN(acc, nbits, es));
+}
+
+namespace std
+{
+
+template <int nbits, int es>
+class numeric_limits<Posit<nbits, es>>
+{
+  public:
+    static constexpr bool is_specialized = true;
+    static constexpr bool is_signed = true;
+    static constexpr bool is_integer = false;
+    static constexpr bool is_exact = false;
+    static constexpr bool has_infinity = false;
+    static constexpr bool has_quiet_NaN = true; // NaR
+    static constexpr bool has_signaling_NaN = false;
+    static constexpr float_denorm_style has_denorm = denorm_absent;
+    static constexpr bool has_denorm_loss = false;
+    static constexpr float_round_style round_style = round_to_nearest;
+    static constexpr bool is_iec559 = false;
+    static constexpr bool is_bounded = true;
+    static constexpr bool is_modulo = false;
+    static constexpr int radix = 2;
+    static constexpr int digits = nbits - 2 - es; // hidden bit and fraction bits around 1
+    static constexpr int digits10 = (digits - 1) * 30103 / 100000;
+    static constexpr int max_digits10 = 2 + digits * 30103 / 100000;
+    static constexpr int max_exponent = (nbits - 2) * (1 << es) + 1; // maxpos is 2^((nbits - 2) * 2^es)
+    static constexpr int min_exponent = 1 - (nbits - 2) * (1 << es);
+    static constexpr int max_exponent10 = (max_exponent - 1) * 30103 / 100000;
+    static constexpr int min_exponent10 = -max_exponent10;
+    static constexpr bool traps = false;
+    static constexpr bool tinyness_before = false;
+
+    static constexpr Posit<nbits, es> min() noexcept { return Posit<nbits, es>::fromBits(1); }
+    static constexpr Posit<nbits, es> max() noexcept { return Posit<nbits, es>::fromBits(maskPositN(nbits - 1)); }
+    static constexpr Posit<nbits, es> lowest() noexcept { return -max(); }
+    static constexpr Posit<nbits, es> epsilon() noexcept
+    {
+        // 1.0 is 01 followed by zeros, its successor differs in the last bit
+        return Posit<nbits, es>::fromBits(((positn)1 << (nbits - 2)) + 1) - Posit<nbits, es>::fromBits((positn)1 << (nbits - 2));
+    }
+    static constexpr Posit<nbits, es> round_error() noexcept
+    {
+        Posit<nbits, es> one = Posit<nbits, es>::fromBits((positn)1 << (nbits - 2));
+        return one / (one + one);
+    }
+    static constexpr Posit<nbits, es> infinity() noexcept { return Posit<nbits, es>::nar(); } // there is no infinity
+    static constexpr Posit<nbits, es> quiet_NaN() noexcept { return Posit<nbits, es>::nar(); }
+    static constexpr Posit<nbits, es> signaling_NaN() noexcept { return Posit<nbits, es>::nar(); }
+    static constexpr Posit<nbits, es> denorm_min() noexcept { return min(); }
+};
+
+template <int nbits, int es>
+struct hash<Posit<nbits, es>>
+{
+    size_t operator()(Posit<nbits, es> value) const noexcept { return hash<typename Posit<nbits, es>::storage_type>()(value.bits()); }
+};
+
+} // namespace std
+
+#endif
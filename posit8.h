@@ -0,0 +1,776 @@
+// Single-source posit8 (8 bit posit, exponent size 0) library for C, C++ and OpenCL C.
+//
+// Everything is defined static inline in this header, so the host code, the OpenCL kernels and
+// the tests compile the same routines. Compile time switches:
+//   POSIT8_HAS_DOUBLE  double conversions, on by default except on OpenCL devices without fp64
+//   POSIT8_HAS_QUIRE   quire8 and the fused operations, needs 64 bit integers, on by default
+#ifndef POSIT8_H
+#define POSIT8_H
+
+#ifdef __OPENCL_C_VERSION__
+#define POSIT8_OPENCL
+#endif
+
+#ifdef POSIT8_OPENCL
+#ifndef POSIT8_HAS_DOUBLE
+#if defined(cl_khr_fp64) || defined(INTELFPGA_CL)
+#define POSIT8_HAS_DOUBLE 1
+#else
+#define POSIT8_HAS_DOUBLE 0
+#endif
+#endif
+#if defined(cl_khr_fp64) && POSIT8_HAS_DOUBLE
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+typedef ulong posit8_u64;
+typedef long posit8_s64;
+#define POSIT8_S64_MIN LONG_MIN
+#define POSIT8_CLZ(x) clz(x)
+#define POSIT8_CLZ64(x) clz(x)
+#else
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+typedef unsigned long long posit8_u64;
+typedef long long posit8_s64;
+#define POSIT8_S64_MIN LLONG_MIN
+#define POSIT8_CLZ(x) __builtin_clz(x)
+#define POSIT8_CLZ64(x) __builtin_clzll(x)
+#endif
+
+#ifndef POSIT8_HAS_DOUBLE
+#define POSIT8_HAS_DOUBLE 1
+#endif
+#ifndef POSIT8_HAS_QUIRE
+#define POSIT8_HAS_QUIRE 1
+#endif
+
+// the pure integer routines can be evaluated at compile time in C++14 and later
+#if defined(__cplusplus) && __cplusplus >= 201402L
+#define POSIT8_CONSTEXPR constexpr
+#else
+#define POSIT8_CONSTEXPR
+#endif
+#define POSIT8_FUNC static inline
+
+typedef unsigned char posit8; // posit with 8 bits and exponent size 0
+
+typedef struct posit_values
+{
+    bool sign;
+    int k;
+    unsigned char exp;
+    unsigned char frac;
+    unsigned char fracLength;
+
+    bool inf;
+    bool zero;
+} posit_values;
+
+POSIT8_FUNC POSIT8_CONSTEXPR posit8 twosComplement(posit8 input)
+{
+    return (posit8)(~input + 1);
+}
+
+// packed result of decodePosit8, fits into a single 32 bit register
+typedef struct posit8_decoded
+{
+    unsigned char sign;
+    signed char scale;         // k, the value is 2^k * significand / 2^7
+    unsigned char significand; // hidden bit at bit 7 followed by the fraction bits
+    unsigned char fracLength;  // number of fraction bits stored in the posit
+} posit8_decoded;
+
+// decodes a posit8 without data dependent branches, zero and NaR have to be checked by the caller
+POSIT8_FUNC POSIT8_CONSTEXPR posit8_decoded decodePosit8(posit8 input)
+{
+    unsigned int sign = input >> 7;
+
+    // two's complement of negative values, then drop the sign bit
+    unsigned int absolute = ((input ^ -sign) + sign) & 0xFF;
+    unsigned int body = (absolute << 1) & 0xFF;
+
+    // the regime is a run of equal bits, inverting runs of ones turns it into leading zeros.
+    // the extra bit below the byte limits the count to 8
+    unsigned int regimeBit = body >> 7;
+    unsigned int run = POSIT8_CLZ((((body ^ -regimeBit) & 0xFF) << 24) | 0x800000);
+
+    // the fraction bits follow the run and its terminating bit
+    unsigned int fraction = (body << (run + 1)) & 0xFF;
+
+    posit8_decoded decoded = {(unsigned char)sign, (signed char)(regimeBit ? (int)run - 1 : -(int)run),
+                              (unsigned char)(0x80 | (fraction >> 1)), (unsigned char)(run < 6 ? 6 - run : 0)};
+    return decoded;
+}
+
+POSIT8_FUNC void extractPositValues(posit8 input, posit_values *output)
+{
+    posit8_decoded decoded = decodePosit8(input);
+
+    output->exp = 0x0; //allways zero by definition
+    output->zero = input == 0x0;
+    output->inf = input == 0x80;
+    output->sign = decoded.sign;
+    output->k = (output->zero || output->inf) ? 0 : decoded.scale;
+    output->fracLength = decoded.fracLength;
+    output->frac = (decoded.significand & 0x7F) >> (7 - decoded.fracLength);
+}
+
+POSIT8_FUNC POSIT8_CONSTEXPR char kToRegime(int k)
+{
+    if (k >= 6)
+    {
+        // regime is only 1s
+        return (1 << 7) - 1;
+    }
+    if (k <= -7)
+    {
+        // regime is only 0s
+        return 0x0;
+    }
+    if (k >= 0)
+    {
+        // k is positive, regime consists of 1s ending in 0
+        return (1 << (k + 2)) - 2;
+    }
+    // k is negative and regime ends therefore with 1
+    return 0x1;
+}
+
+POSIT8_FUNC POSIT8_CONSTEXPR int regimeLengthFromK(int k, int positSize)
+{
+    int result = k >= 0 ? k + 2 : -k + 1;
+    return result > positSize - 1 ? positSize - 1 : result;
+}
+
+// rounds 2^k * 1.fraction to the nearest posit8 (ties to even), fraction holds fracLength bits.
+// Regime and fraction bits are concatenated and cut down to 7 bits, so no loops are needed.
+// Outside of maxpos and minpos the result saturates, posits never drop to zero.
+POSIT8_FUNC POSIT8_CONSTEXPR posit8 roundToPosit8(bool sign, int k, posit8_u64 fraction, int fracLength)
+{
+    // saturate at maxpos
+    posit8 result = 0x7F;
+    if (k < -6)
+    {
+        // per definition posits never drop to zero, this also covers all subnormal inputs
+        result = 0x1;
+    }
+    else if (k < 6)
+    {
+        posit8_u64 positBits = ((posit8_u64)kToRegime(k) << fracLength) | fraction;
+        int shift = regimeLengthFromK(k, 8) + fracLength - 7;
+
+        result = positBits >> shift;
+
+        posit8_u64 rest = positBits & (((posit8_u64)1 << shift) - 1);
+        posit8_u64 half = (posit8_u64)1 << (shift - 1);
+        if (rest > half || (rest == half && (result & 0x1) == 1))
+        {
+            result += 1;
+        }
+    }
+    return sign ? twosComplement(result) : result;
+}
+
+// converts the bit pattern of an IEEE 754 number with the given field lengths to the nearest posit8
+POSIT8_FUNC posit8 ieeeToPosit8Bits(posit8_u64 bits, int exponentLength, int mantissaLength)
+{
+    bool sign = (bits >> (exponentLength + mantissaLength)) & 0x1;
+    posit8_u64 absBits = bits & (((posit8_u64)1 << (exponentLength + mantissaLength)) - 1);
+    int exponent = absBits >> mantissaLength;
+    int exponentMax = (1 << exponentLength) - 1;
+
+    if (absBits == 0)
+    {
+        // check for zero
+        return 0x0;
+    }
+    if (exponent == exponentMax)
+    {
+        // infinity and nan become NaR
+        return 0x80;
+    }
+    posit8_u64 mantissa = absBits & (((posit8_u64)1 << mantissaLength) - 1);
+    return roundToPosit8(sign, exponent - (exponentMax >> 1), mantissa, mantissaLength);
+}
+
+POSIT8_FUNC void ieeeToPosit8(posit8_u64 bits, int exponentLength, int mantissaLength, posit8 *out)
+{
+    *out = ieeeToPosit8Bits(bits, exponentLength, mantissaLength);
+}
+
+POSIT8_FUNC void floatToPosit8(float floatInput, posit8 *out)
+{
+#ifdef POSIT8_OPENCL
+    unsigned int bits = as_uint(floatInput);
+#else
+    unsigned int bits;
+    memcpy(&bits, &floatInput, sizeof(bits));
+#endif
+    ieeeToPosit8(bits, 8, 23, out);
+}
+
+// C has no portable half type, so the input is the raw binary16 bit pattern
+POSIT8_FUNC void halfToPosit8(unsigned short halfInput, posit8 *out)
+{
+    ieeeToPosit8(halfInput, 5, 10, out);
+}
+
+#if POSIT8_HAS_DOUBLE
+POSIT8_FUNC void doubleToPosit8(double doubleInput, posit8 *out)
+{
+#ifdef POSIT8_OPENCL
+    posit8_u64 bits = as_ulong(doubleInput);
+#else
+    posit8_u64 bits;
+    memcpy(&bits, &doubleInput, sizeof(bits));
+#endif
+    ieeeToPosit8(bits, 11, 52, out);
+}
+
+// every posit8 is exact as double, NaR becomes NaN
+POSIT8_FUNC void posit8ToDouble(posit8 posit, double *output)
+{
+    if (posit == 0x0)
+    {
+        *output = 0;
+        return;
+    }
+    if (posit == 0x80)
+    {
+        *output = NAN;
+        return;
+    }
+    posit8_decoded decoded = decodePosit8(posit);
+    double value = ldexp((double)decoded.significand, decoded.scale - 7);
+    *output = decoded.sign ? -value : value;
+}
+#endif
+
+POSIT8_FUNC void addHiddenBitToFraction(posit_values *a)
+{
+    char hiddenBit = 0x1;
+    hiddenBit <<= a->fracLength;
+    a->frac |= hiddenBit;
+}
+
+POSIT8_FUNC void multPosit8(posit8 a, posit8 b, posit8 *result)
+{
+    *result = 0x0;
+    if (a == 0x80 || b == 0x80)
+    {
+        // NaR wins over zero
+        *result = 0x80;
+    }
+    else if (a == 0x0 || b == 0x0)
+    {
+        *result = 0x0;
+    }
+    else
+    {
+        // extracting posit values
+        posit_values valuesA;
+        extractPositValues(a, &valuesA);
+        posit_values valuesB;
+        extractPositValues(b, &valuesB);
+        bool sign = valuesA.sign ^ valuesB.sign;
+
+        // adding scales of a and b
+        int newK = valuesA.k + valuesB.k;
+
+        // adding hidden bit to fraction
+        addHiddenBitToFraction(&valuesA);
+        addHiddenBitToFraction(&valuesB);
+
+        // keeping track of shift value for position of hidden bit
+        int fracLength;
+
+        // shifting the mantissa of the smaller factor so both are of equal scaling
+        if (valuesA.fracLength > valuesB.fracLength)
+        {
+            valuesB.frac <<= valuesA.fracLength - valuesB.fracLength;
+            //fracLength = 2 * valuesA.fracLength;
+            fracLength = valuesA.fracLength << 1;
+        }
+        else
+        {
+            valuesA.frac <<= valuesB.fracLength - valuesA.fracLength;
+            //fracLength = 2 * valuesB.fracLength;
+            fracLength = valuesB.fracLength << 1;
+        }
+
+        // calculating product of aligned mantissas
+        unsigned int intResult = valuesA.frac * valuesB.frac;
+
+        {
+            if (intResult >> fracLength + 1 > 0)
+            {
+                newK++;
+                fracLength++;
+            }
+
+            if (fracLength > 0)
+            {
+                // mask hidden bit
+                intResult &= 0xffffffff >> 32 - fracLength;
+            }
+            else
+            {
+                intResult = 0x0;
+            }
+        }
+
+        int newRegimeLength = regimeLengthFromK(newK, 8);
+        int resultFracLength = 8 - newRegimeLength - 1;
+
+        unsigned int carryCondition = intResult & 0xffffffff >> 32 - (fracLength - resultFracLength);
+        bool carryBit = 0;
+
+        // check if rest of mantissa that is not used in new posit is bigger than (0.)100
+        // if so carry bit is one and will be added in the end
+        if ((fracLength - resultFracLength) > 1 && carryCondition > (0x1 << (fracLength - resultFracLength) - 1))
+        {
+            carryBit = 1;
+        }
+
+        // determine new regime length
+        newRegimeLength = regimeLengthFromK(newK, 8);
+
+        // transform k value to regime bits
+        char newRegime = kToRegime(newK);
+
+        // calculate length of mantissa bits
+        resultFracLength = 8 - newRegimeLength - 1;
+        int fracShift = fracLength - resultFracLength;
+        unsigned char newFrac;
+        if (fracShift > 0)
+        {
+            newFrac = intResult >> fracShift;
+        }
+        else
+        {
+            newFrac = intResult << -fracShift;
+        }
+
+        *result |= newRegime << resultFracLength;
+
+        if (resultFracLength > 0)
+        {
+            *result |= newFrac;
+        }
+
+        if (*result != 0x7f && (carryBit || ((*result & 0x1) == 1 && carryCondition == (0x1 << (fracLength - resultFracLength) - 1))))
+        {
+            *result += 1;
+        }
+
+        // per definition posits never drop to zero
+        if (*result == 0x0)
+        {
+            *result = 0x1;
+        }
+        if (sign)
+        {
+            *result = twosComplement(*result);
+        }
+    }
+}
+
+POSIT8_FUNC void divPosit8(posit8 a, posit8 b, posit8 *result)
+{
+    *result = 0x0;
+    if (a == 0x80 || b == 0x80 || b == 0x0)
+    {
+        // division by zero is NaR as well
+        *result = 0x80;
+    }
+    else if (a == 0x0)
+    {
+        *result = 0x0;
+    }
+    else
+    {
+        // extracting posit values
+        posit_values valuesA;
+        extractPositValues(a, &valuesA);
+        posit_values valuesB;
+        extractPositValues(b, &valuesB);
+        bool sign = valuesA.sign ^ valuesB.sign;
+
+        // subtracting scales of a and b
+        int newK = valuesA.k - valuesB.k;
+
+        // adding hidden bit to fraction
+        addHiddenBitToFraction(&valuesA);
+        addHiddenBitToFraction(&valuesB);
+
+        valuesB.frac <<= 7 - valuesB.fracLength;
+        valuesA.frac <<= 7 - valuesA.fracLength;
+
+        unsigned int dividend = valuesA.frac << 7;
+
+        unsigned int quot = dividend / valuesB.frac;
+        unsigned int rem = dividend % valuesB.frac;
+
+        if (quot != 0)
+        {
+            bool rcarry = quot >> 7; // this is the hidden bit (7th bit) , extreme right bit is bit 0
+            if (!rcarry)
+            {
+                newK--;
+                quot <<= 1;
+            }
+        }
+
+        // determine new regime length
+        unsigned int newRegimeLength = regimeLengthFromK(newK, 8);
+
+        // transform k value to regime bits
+        char newRegime = kToRegime(newK);
+
+        int resultFracLength = 8 - newRegimeLength - 1;
+
+        newRegime <<= resultFracLength;
+
+        *result = newRegime;
+
+        int scale;
+        if (newK < 0)
+        {
+            scale = -newK;
+        }
+        else
+        {
+            scale = newK + 1;
+        }
+
+        quot &= 0x7F;
+        unsigned char newFrac = quot;
+        newFrac >>= scale + 1;
+
+        *result |= newFrac;
+
+        bool guard = (bool)(0x1 & quot >> scale);
+        if (guard)
+        {
+            bool roundSticky = (((1 << scale) - 1) & quot) ? 1 : 0;
+            if (rem > 0 || roundSticky || ((*result & 0x1) == 1 && !roundSticky))
+            {
+                *result += 1;
+            }
+        }
+
+        if (*result == 0x0)
+        {
+            *result = 0x1;
+        }
+
+        if (sign)
+        {
+            *result = twosComplement(*result);
+        }
+    }
+}
+
+POSIT8_FUNC void addPosit8(posit8 a, posit8 b, posit8 *result)
+{
+    *result = 0x0;
+    if (a == 0x0)
+    {
+        *result = b;
+    }
+    else if (b == 0x0)
+    {
+        *result = a;
+    }
+    else if (a == 0x80 || b == 0x80)
+    {
+        *result = 0x80;
+    }
+    else if (twosComplement(a) == b)
+    {
+        *result = 0x0;
+    }
+    else
+    {
+
+        posit_values valuesA;
+        extractPositValues(a, &valuesA);
+        posit_values valuesB;
+        extractPositValues(b, &valuesB);
+
+        bool newSign = 0;
+
+        posit8 compA = a;
+        if (valuesA.sign == 1)
+        {
+            compA = twosComplement(a);
+        }
+
+        posit8 compB = b;
+        if (valuesB.sign == 1)
+        {
+            compB = twosComplement(b);
+        }
+        newSign = (compA > compB) ? valuesA.sign : valuesB.sign;
+
+        // compute scale factor
+        int newK = valuesA.k;
+        addHiddenBitToFraction(&valuesA);
+        addHiddenBitToFraction(&valuesB);
+
+        if (valuesA.k > valuesB.k)
+        {
+            valuesB.fracLength += valuesA.k - valuesB.k;
+            newK = valuesA.k;
+        }
+        else if (valuesA.k < valuesB.k)
+        {
+            valuesA.fracLength += valuesB.k - valuesA.k;
+            newK = valuesB.k;
+        }
+
+        int fracLength;
+        unsigned int fracA, fracB;
+        if (valuesA.fracLength > valuesB.fracLength)
+        {
+            fracB = valuesB.frac << valuesA.fracLength - valuesB.fracLength;
+            fracA = valuesA.frac;
+            fracLength = valuesA.fracLength;
+        }
+        else
+        {
+            fracA = valuesA.frac << valuesB.fracLength - valuesA.fracLength;
+            fracB = valuesB.frac;
+            fracLength = valuesB.fracLength;
+        }
+        unsigned int tempFrac;
+
+        if (valuesA.sign == valuesB.sign)
+        {
+            tempFrac = fracA + fracB;
+        }
+        else
+        {
+            if (fracA > fracB)
+            {
+                tempFrac = fracA - fracB;
+            }
+
+            else
+            {
+                tempFrac = fracB - fracA;
+            }
+        }
+
+        {
+            if (tempFrac >> fracLength + 1 > 0)
+            {
+                newK++;
+                fracLength++;
+            }
+            else
+            {
+                while (tempFrac >> fracLength == 0 && fracLength > 0)
+                {
+                    newK--;
+                    fracLength--;
+                }
+            }
+
+            if (fracLength > 0)
+            {
+                // mask hidden bit
+                tempFrac &= 0xffffffff >> 32 - fracLength;
+            }
+            else
+            {
+                tempFrac = 0x0;
+            }
+        }
+
+        int newRegimeLength = regimeLengthFromK(newK, 8);
+        int resultFracLength = 8 - newRegimeLength - 1;
+        int fractionShiftValue = fracLength - resultFracLength;
+
+        unsigned int cond = tempFrac & (0xffffffff >> 32 - (fracLength - resultFracLength));
+
+        bool carryBit = 0;
+        if ((fracLength - resultFracLength) > 0 && cond > (0x1 << (fracLength - resultFracLength) - 1))
+        {
+            carryBit = 1;
+        }
+        char newRegime = kToRegime(newK);
+        unsigned char newFrac = tempFrac;
+
+        *result = 0x0 << 7;
+        *result |= newRegime << resultFracLength;
+
+        if (resultFracLength > 0)
+        {
+            if (fractionShiftValue > 0)
+            {
+                *result |= (tempFrac >> fractionShiftValue);
+            }
+            else
+            {
+                *result |= (tempFrac << -fractionShiftValue);
+            }
+        }
+
+        if (carryBit || (((*result & 0x1) == 1 && cond == (0x1 << (fracLength - resultFracLength) - 1)) && *result != 0x7f))
+        {
+            *result += 1;
+        }
+
+        if (newSign == 1)
+        {
+            *result = twosComplement(*result);
+        }
+    }
+}
+
+POSIT8_FUNC void subPosit8(posit8 a, posit8 b, posit8 *result)
+{
+    *result = 0x0;
+    posit8 negative = twosComplement(b);
+    addPosit8(a, negative, result);
+}
+
+POSIT8_FUNC void sigmoidPosit8(posit8 *x)
+{
+    *x = *x ^ (1 << 7);
+    *x >>= 2;
+}
+
+
+#if POSIT8_HAS_QUIRE
+// the quire is an exact fixed point accumulator for sums of posit8 products:
+// every product of two posit8 values is a multiple of 2^-12, so 12 fraction bits
+// are enough and the remaining integer bits act as carry guard for long dot products
+typedef posit8_s64 quire8;
+
+#define QUIRE8_FRAC_BITS 12
+#define QUIRE8_NAR POSIT8_S64_MIN
+
+POSIT8_FUNC void clearQuire8(quire8 *q)
+{
+    *q = 0;
+}
+
+POSIT8_FUNC void posit8ToQuire8(posit8 a, quire8 *q)
+{
+    *q = 0;
+    if (a == 0x80)
+    {
+        *q = QUIRE8_NAR;
+    }
+    else if (a != 0x0)
+    {
+        posit8_decoded values = decodePosit8(a);
+
+        // lsb of every posit8 is at least 2^-6, so shifting the product back is exact
+        quire8 value = ((quire8)values.significand << (values.scale + QUIRE8_FRAC_BITS)) >> 7;
+        *q = values.sign ? -value : value;
+    }
+}
+
+// fused dot product step: adds the exact product a * b to the quire without rounding
+POSIT8_FUNC void fdpPosit8(quire8 *q, posit8 a, posit8 b)
+{
+    if (*q == QUIRE8_NAR)
+    {
+        return;
+    }
+    if (a == 0x80 || b == 0x80)
+    {
+        *q = QUIRE8_NAR;
+    }
+    else if (a != 0x0 && b != 0x0)
+    {
+        posit8_decoded valuesA = decodePosit8(a);
+        posit8_decoded valuesB = decodePosit8(b);
+
+        // product of the significands has 14 fraction bits, shift it to the fixed position of the quire.
+        // lsb of every posit8 is at least 2^-6, so shifting back after the scaling is exact
+        quire8 product = (quire8)(valuesA.significand * valuesB.significand);
+        product = (product << (valuesA.scale + valuesB.scale + QUIRE8_FRAC_BITS)) >> 14;
+
+        if (valuesA.sign ^ valuesB.sign)
+        {
+            *q -= product;
+        }
+        else
+        {
+            *q += product;
+        }
+    }
+}
+
+// rounds the quire to the nearest posit8 (ties to even), this is the only rounding of a fused operation
+POSIT8_FUNC void quire8ToPosit8(quire8 q, posit8 *result)
+{
+    if (q == QUIRE8_NAR)
+    {
+        *result = 0x80;
+        return;
+    }
+    if (q == 0)
+    {
+        *result = 0x0;
+        return;
+    }
+
+    bool sign = q < 0;
+    posit8_u64 magnitude = sign ? -(posit8_u64)q : (posit8_u64)q;
+    int k = 63 - (int)POSIT8_CLZ64(magnitude) - QUIRE8_FRAC_BITS;
+
+    // all bits below the leading one are fraction bits
+    int fracLength = k + QUIRE8_FRAC_BITS;
+    *result = roundToPosit8(sign, k, magnitude & (((posit8_u64)1 << fracLength) - 1), fracLength);
+}
+
+// fused multiply add, computes a * b + c with a single rounding
+POSIT8_FUNC void fmaPosit8(posit8 a, posit8 b, posit8 c, posit8 *result)
+{
+    quire8 q;
+    posit8ToQuire8(c, &q);
+    fdpPosit8(&q, a, b);
+    quire8ToPosit8(q, result);
+}
+
+// activations of the fused GEMM epilogue
+#define POSIT8_ACTIVATION_NONE 0
+#define POSIT8_ACTIVATION_RELU 1
+#define POSIT8_ACTIVATION_SIGMOID 2 // sigmoidPosit8
+
+// epilogue of a fused layer, activation(round(q + bias) * scale). The bias is added exactly in the
+// quire, so without scaling the result is rounded once. NaR passes through all activations
+POSIT8_FUNC posit8 epiloguePosit8(quire8 q, posit8 bias, posit8 scale, int activation)
+{
+    posit8 result;
+    fdpPosit8(&q, bias, 0x40);
+    quire8ToPosit8(q, &result);
+
+    // 0x40 is 1.0
+    if (scale != 0x40)
+    {
+        multPosit8(result, scale, &result);
+    }
+    if (result != 0x80)
+    {
+        if (activation == POSIT8_ACTIVATION_RELU && (result & 0x80))
+        {
+            result = 0x0;
+        }
+        else if (activation == POSIT8_ACTIVATION_SIGMOID)
+        {
+            sigmoidPosit8(&result);
+        }
+    }
+    return result;
+}
+#endif
+
+#endif
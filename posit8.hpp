@@ -0,0 +1,287 @@
+// C++ value type for posit8, built on the routines of posit8.h (needs C++17).
+//
+// Posit8 is a one byte value class with the usual operators, so it works in templated numeric
+// code (std algorithms, containers, ...). All arithmetic is constexpr. The results of +, -, *
+// and / for all 256 x 256 operand pairs are constexpr tables (posit8_tables.h, generated from the
+// reference arithmetic below), so constant expressions fold and every operation at runtime is a
+// single load, without an init call.
+#ifndef POSIT8_HPP
+#define POSIT8_HPP
+
+#if __cplusplus < 201703L
+#error "posit8.hpp needs C++17"
+#endif
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include "posit8.h"
+
+namespace posit8_detail
+{
+
+constexpr posit8 NAR = 0x80;
+
+// value * 64, every posit8 is a multiple of 2^-6 below 2^7 so this is exact. 0 for NaR
+constexpr int toFixed(posit8 p)
+{
+    if (p == 0x0 || p == NAR)
+    {
+        return 0;
+    }
+    posit8_decoded decoded = decodePosit8(p);
+    int fixed = (decoded.significand << (decoded.scale + 6)) >> 7;
+    return decoded.sign ? -fixed : fixed;
+}
+
+// rounds value * 2^-fracBits to posit8. The caller makes sure the leading one is at least 6 bits
+// above the lsb (fracBits >= 12 for all posit8 results) and ors a sticky bit into the lsb if the
+// value is not exact, so ties are only detected for exact values.
+constexpr posit8 roundFixed(long long value, int fracBits)
+{
+    if (value == 0)
+    {
+        return 0x0;
+    }
+    bool sign = value < 0;
+    unsigned long long magnitude = sign ? -(unsigned long long)value : (unsigned long long)value;
+    int msb = 63 - __builtin_clzll(magnitude);
+    return roundToPosit8(sign, msb - fracBits, magnitude & ((1ULL << msb) - 1), msb);
+}
+
+// exact reference arithmetic, test/generate_posit8_tables.cpp fills posit8_tables.h from these functions
+constexpr posit8 add(posit8 a, posit8 b)
+{
+    if (a == NAR || b == NAR)
+    {
+        return NAR;
+    }
+    return roundFixed((long long)(toFixed(a) + toFixed(b)) * 64, 12);
+}
+
+constexpr posit8 mult(posit8 a, posit8 b)
+{
+    if (a == NAR || b == NAR)
+    {
+        return NAR;
+    }
+    return roundFixed((long long)toFixed(a) * toFixed(b), 12);
+}
+
+constexpr posit8 div(posit8 a, posit8 b)
+{
+    if (a == NAR || b == NAR || b == 0x0)
+    {
+        return NAR;
+    }
+    long long dividend = toFixed(a);
+    long long divisor = toFixed(b);
+    bool sign = (dividend < 0) != (divisor < 0);
+    dividend = dividend < 0 ? -dividend : dividend;
+    divisor = divisor < 0 ? -divisor : divisor;
+
+    // 24 fraction bits keep the quotient (at least 2^-12) far above the sticky bit
+    long long quotient = (dividend << 24) / divisor;
+    quotient |= (dividend << 24) % divisor != 0;
+    return roundFixed(sign ? -quotient : quotient, 24);
+}
+
+constexpr posit8 fma(posit8 a, posit8 b, posit8 c)
+{
+    if (a == NAR || b == NAR || c == NAR)
+    {
+        return NAR;
+    }
+    return roundFixed((long long)toFixed(a) * toFixed(b) + (long long)toFixed(c) * 64, 12);
+}
+
+typedef std::array<posit8, 256 * 256> op_table;
+
+} // namespace posit8_detail
+
+#include "posit8_tables.h"
+
+namespace posit8_detail
+{
+
+constexpr std::array<double, 256> makeValues()
+{
+    std::array<double, 256> values{};
+    for (unsigned i = 0; i < values.size(); i++)
+    {
+        values[i] = i == NAR ? std::numeric_limits<double>::quiet_NaN() : toFixed(i) / 64.0;
+    }
+    return values;
+}
+
+inline constexpr std::array<double, 256> values = makeValues();
+
+// nearest posit8 (ties to even) like doubleToPosit8, found by binary search over the positive
+// values because the IEEE bits are not accessible in constant expressions before C++20
+constexpr posit8 fromDouble(double value)
+{
+    if (value != value || value > std::numeric_limits<double>::max() || value < -std::numeric_limits<double>::max())
+    {
+        return NAR;
+    }
+    if (value == 0)
+    {
+        return 0x0;
+    }
+
+    double magnitude = value < 0 ? -value : value;
+    posit8 result = 0x7F; // saturate at maxpos
+    if (magnitude < values[0x01])
+    {
+        // posits never drop to zero
+        result = 0x01;
+    }
+    else if (magnitude < values[0x7F])
+    {
+        unsigned lo = 0x01;
+        unsigned hi = 0x7F;
+        while (hi - lo > 1)
+        {
+            unsigned mid = (lo + hi) / 2;
+            if (values[mid] <= magnitude)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        // midpoints between posit8 values are exact in double
+        double mid = (values[lo] + values[hi]) / 2;
+        result = magnitude < mid || (magnitude == mid && (lo & 0x1) == 0) ? lo : hi;
+    }
+    return value < 0 ? twosComplement(result) : result;
+}
+
+} // namespace posit8_detail
+
+class Posit8
+{
+  public:
+    constexpr Posit8() : encoding(0x0) {}
+    constexpr explicit Posit8(double value) : encoding(posit8_detail::fromDouble(value)) {}
+    constexpr explicit Posit8(float value) : encoding(posit8_detail::fromDouble(value)) {}
+    constexpr explicit Posit8(int value) : encoding(posit8_detail::fromDouble(value)) {}
+
+    static constexpr Posit8 fromBits(posit8 bits)
+    {
+        Posit8 result;
+        result.encoding = bits;
+        return result;
+    }
+    static constexpr Posit8 nar() { return fromBits(posit8_detail::NAR); }
+
+    constexpr posit8 bits() const { return encoding; }
+    constexpr bool isNaR() const { return encoding == posit8_detail::NAR; }
+
+    // every posit8 is exact as float and double, NaR becomes NaN
+    constexpr explicit operator double() const { return posit8_detail::values[encoding]; }
+    constexpr explicit operator float() const { return (float)posit8_detail::values[encoding]; }
+
+    constexpr Posit8 operator+() const { return *this; }
+    constexpr Posit8 operator-() const { return fromBits(twosComplement(encoding)); }
+
+    constexpr Posit8 &operator+=(Posit8 other)
+    {
+        encoding = posit8_detail::addTable[index(encoding, other.encoding)];
+        return *this;
+    }
+    constexpr Posit8 &operator-=(Posit8 other)
+    {
+        encoding = posit8_detail::addTable[index(encoding, twosComplement(other.encoding))];
+        return *this;
+    }
+    constexpr Posit8 &operator*=(Posit8 other)
+    {
+        encoding = posit8_detail::multTable[index(encoding, other.encoding)];
+        return *this;
+    }
+    constexpr Posit8 &operator/=(Posit8 other)
+    {
+        encoding = posit8_detail::divTable[index(encoding, other.encoding)];
+        return *this;
+    }
+
+  private:
+    static constexpr unsigned index(posit8 a, posit8 b) { return ((unsigned)a << 8) | b; }
+
+    posit8 encoding;
+};
+
+constexpr Posit8 operator+(Posit8 a, Posit8 b) { return a += b; }
+constexpr Posit8 operator-(Posit8 a, Posit8 b) { return a -= b; }
+constexpr Posit8 operator*(Posit8 a, Posit8 b) { return a *= b; }
+constexpr Posit8 operator/(Posit8 a, Posit8 b) { return a /= b; }
+
+// posits are ordered like their bits as two's complement integers, so NaR equals itself
+// and is smaller than every other value (unlike NaN this gives a total order)
+constexpr bool operator==(Posit8 a, Posit8 b) { return a.bits() == b.bits(); }
+constexpr bool operator!=(Posit8 a, Posit8 b) { return a.bits() != b.bits(); }
+constexpr bool operator<(Posit8 a, Posit8 b) { return (signed char)a.bits() < (signed char)b.bits(); }
+constexpr bool operator>(Posit8 a, Posit8 b) { return b < a; }
+constexpr bool operator<=(Posit8 a, Posit8 b) { return !(b < a); }
+constexpr bool operator>=(Posit8 a, Posit8 b) { return !(a < b); }
+
+// a * b + c with a single rounding
+constexpr Posit8 fma(Posit8 a, Posit8 b, Posit8 c) { return Posit8::fromBits(posit8_detail::fma(a.bits(), b.bits(), c.bits())); }
+
+constexpr Posit8 abs(Posit8 a) { return a < Posit8() && !a.isNaR() ? -a : a; }
+
+namespace std
+{
+
+template <>
+class numeric_limits<Posit8>
+{
+  public:
+    static constexpr bool is_specialized = true;
+    static constexpr bool is_signed = true;
+    static constexpr bool is_integer = false;
+    static constexpr bool is_exact = false;
+    static constexpr bool has_infinity = false;
+    static constexpr bool has_quiet_NaN = true; // NaR
+    static constexpr bool has_signaling_NaN = false;
+    static constexpr float_denorm_style has_denorm = denorm_absent;
+    static constexpr bool has_denorm_loss = false;
+    static constexpr float_round_style round_style = round_to_nearest;
+    static constexpr bool is_iec559 = false;
+    static constexpr bool is_bounded = true;
+    static constexpr bool is_modulo = false;
+    static constexpr int radix = 2;
+    static constexpr int digits = 6; // hidden bit and 5 fraction bits around 1
+    static constexpr int digits10 = 1;
+    static constexpr int max_digits10 = 3;
+    static constexpr int min_exponent = -5; // minpos is 2^-6
+    static constexpr int min_exponent10 = -1;
+    static constexpr int max_exponent = 7; // maxpos is 2^6
+    static constexpr int max_exponent10 = 1;
+    static constexpr bool traps = false;
+    static constexpr bool tinyness_before = false;
+
+    static constexpr Posit8 min() noexcept { return Posit8::fromBits(0x01); }
+    static constexpr Posit8 max() noexcept { return Posit8::fromBits(0x7F); }
+    static constexpr Posit8 lowest() noexcept { return Posit8::fromBits(0x81); }
+    static constexpr Posit8 epsilon() noexcept { return Posit8::fromBits(0x41) - Posit8::fromBits(0x40); }
+    static constexpr Posit8 round_error() noexcept { return Posit8(0.5); }
+    static constexpr Posit8 infinity() noexcept { return Posit8::nar(); } // there is no infinity
+    static constexpr Posit8 quiet_NaN() noexcept { return Posit8::nar(); }
+    static constexpr Posit8 signaling_NaN() noexcept { return Posit8::nar(); }
+    static constexpr Posit8 denorm_min() noexcept { return min(); }
+};
+
+template <>
+struct hash<Posit8>
+{
+    size_t operator()(Posit8 value) const noexcept { return hash<unsigned char>()(value.bits()); }
+};
+
+} // namespace std
+
+#endif
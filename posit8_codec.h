@@ -0,0 +1,396 @@
+// Block compressed storage of posit8 arrays for C, C++ and OpenCL C (see posit8.h).
+//
+// Posit8 values of typical tensors cluster around +-1, so their codes carry much less than 8 bits
+// of information. A stream stores them with one canonical Huffman code over the 256 codes, split
+// into independently decodable blocks, so the host and the devices (decode_posit8_blocks) decode
+// the blocks in parallel. All fields are little endian:
+//
+//   uint32 POSIT8_CODEC_MAGIC, uint32 number of values, uint32 values per block, uint32 number of blocks
+//   uint8  code length of each of the 256 codes (0 for codes that do not occur, at most POSIT8_CODEC_MAX_LENGTH)
+//   uint32 byte offset of each block in the payload, followed by the payload size
+//   payload, every block starts at a byte, its codes are stored from the most significant bit on
+//
+// A block whose codes would not be smaller than its values, e.g. of near uniform data, holds the
+// values as they are and has POSIT8_CODEC_STORED set in its offset, so a stream never grows beyond
+// its values and headers. Payloads are smaller than POSIT8_CODEC_STORED bytes.
+//
+// The encoder is only available on the host, the block decoder on the host and the devices.
+#ifndef POSIT8_CODEC_H
+#define POSIT8_CODEC_H
+
+#include "posit8.h"
+
+#define POSIT8_CODEC_MAGIC 0x43483850 // "P8HC"
+#define POSIT8_CODEC_MAX_LENGTH 11
+#define POSIT8_CODEC_TABLE_SIZE (1 << POSIT8_CODEC_MAX_LENGTH)
+#define POSIT8_CODEC_HEADER_SIZE (16 + 256)
+#define POSIT8_CODEC_BLOCK_SIZE 4096 // default values per block
+#define POSIT8_CODEC_STORED 0x80000000u // flag of a stored block in its offset
+
+// memory the stream is read from and decoded to, and of the decode table
+#ifdef POSIT8_OPENCL
+#define POSIT8_CODEC_GLOBAL __global
+#define POSIT8_CODEC_LOCAL __local
+#else
+#define POSIT8_CODEC_GLOBAL
+#define POSIT8_CODEC_LOCAL
+#endif
+
+// Lookup table for the next POSIT8_CODEC_MAX_LENGTH bits of a block: code | (code length << 8),
+// 0 where no code starts. Returns false if the lengths do not form a prefix code.
+POSIT8_FUNC bool buildPosit8DecodeTable(const unsigned char *lengths, unsigned short *table)
+{
+    for (int i = 0; i < POSIT8_CODEC_TABLE_SIZE; i++)
+    {
+        table[i] = 0;
+    }
+    // canonical codes: ordered by length, then by the posit8 code
+    unsigned code = 0;
+    for (int length = 1; length <= POSIT8_CODEC_MAX_LENGTH; length++)
+    {
+        for (int symbol = 0; symbol < 256; symbol++)
+        {
+            if (lengths[symbol] != length)
+            {
+                continue;
+            }
+            if (code >= (1u << length))
+            {
+                return false;
+            }
+            unsigned first = code << (POSIT8_CODEC_MAX_LENGTH - length);
+            unsigned entries = 1u << (POSIT8_CODEC_MAX_LENGTH - length);
+            for (unsigned i = 0; i < entries; i++)
+            {
+                table[first + i] = (unsigned short)(symbol | (length << 8));
+            }
+            code++;
+        }
+        code <<= 1;
+    }
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+        if (lengths[symbol] > POSIT8_CODEC_MAX_LENGTH)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Decodes count values of the block in data[0 .. size), stored if its offset has POSIT8_CODEC_STORED.
+// Returns false if the size does not match a stored block or a coded one is shorter than its values
+// or contains bits that are no code.
+POSIT8_FUNC bool decodePosit8Block(POSIT8_CODEC_GLOBAL const unsigned char *data, unsigned size, unsigned count, bool stored,
+                                   POSIT8_CODEC_LOCAL const unsigned short *table, POSIT8_CODEC_GLOBAL posit8 *out)
+{
+    if (stored)
+    {
+        if (size != count)
+        {
+            return false;
+        }
+        for (unsigned i = 0; i < count; i++)
+        {
+            out[i] = data[i];
+        }
+        return true;
+    }
+
+    posit8_u64 bits = 0; // next bits of the block, aligned to the most significant bit
+    int available = 0;
+    unsigned next = 0;
+    for (unsigned i = 0; i < count; i++)
+    {
+        while (available <= 56 && next < size)
+        {
+            bits |= (posit8_u64)data[next++] << (56 - available);
+            available += 8;
+        }
+        unsigned short entry = table[bits >> (64 - POSIT8_CODEC_MAX_LENGTH)];
+        int length = entry >> 8;
+        if (length == 0 || length > available)
+        {
+            return false;
+        }
+        out[i] = (posit8)entry;
+        bits <<= length;
+        available -= length;
+    }
+    return true;
+}
+
+#ifndef POSIT8_OPENCL
+
+POSIT8_FUNC unsigned readPosit8StreamU32(const unsigned char *bytes)
+{
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned)bytes[3] << 24);
+}
+
+POSIT8_FUNC void writePosit8StreamU32(unsigned char *bytes, unsigned value)
+{
+    bytes[0] = (unsigned char)value;
+    bytes[1] = (unsigned char)(value >> 8);
+    bytes[2] = (unsigned char)(value >> 16);
+    bytes[3] = (unsigned char)(value >> 24);
+}
+
+// fields of a stream, the pointers point into it
+typedef struct posit8_stream_info
+{
+    unsigned count;
+    unsigned block_size;
+    unsigned num_blocks;
+    const unsigned char *lengths;       // 256 code lengths
+    const unsigned char *block_offsets; // num_blocks + 1 little endian uint32
+    const unsigned char *payload;
+    size_t size;                        // of the whole stream
+} posit8_stream_info;
+
+// Checks the header and the block offsets of a stream of size bytes, the payload offsets are the
+// block offsets without POSIT8_CODEC_STORED.
+POSIT8_FUNC bool parsePosit8Stream(const unsigned char *stream, size_t size, posit8_stream_info *info)
+{
+    if (size < POSIT8_CODEC_HEADER_SIZE || readPosit8StreamU32(stream) != POSIT8_CODEC_MAGIC)
+    {
+        return false;
+    }
+    info->count = readPosit8StreamU32(stream + 4);
+    info->block_size = readPosit8StreamU32(stream + 8);
+    info->num_blocks = readPosit8StreamU32(stream + 12);
+    info->lengths = stream + 16;
+    info->block_offsets = stream + POSIT8_CODEC_HEADER_SIZE;
+    if (info->block_size == 0 || info->num_blocks != (info->count + (posit8_u64)info->block_size - 1) / info->block_size ||
+        size - POSIT8_CODEC_HEADER_SIZE < 4 * ((size_t)info->num_blocks + 1))
+    {
+        return false;
+    }
+    info->payload = info->block_offsets + 4 * ((size_t)info->num_blocks + 1);
+    info->size = size;
+
+    size_t payload_size = size - (info->payload - stream);
+    unsigned previous = 0;
+    for (unsigned b = 0; b <= info->num_blocks; b++)
+    {
+        unsigned offset = readPosit8StreamU32(info->block_offsets + 4 * (size_t)b) & ~POSIT8_CODEC_STORED;
+        if (offset < previous || offset > payload_size)
+        {
+            return false;
+        }
+        previous = offset;
+    }
+    return true;
+}
+
+// Largest stream encodePosit8Stream writes for count values, all blocks stored.
+POSIT8_FUNC size_t posit8StreamBound(size_t count, unsigned block_size)
+{
+    size_t num_blocks = (count + block_size - 1) / block_size;
+    return POSIT8_CODEC_HEADER_SIZE + 4 * (num_blocks + 1) + count;
+}
+
+// Huffman code lengths of at most POSIT8_CODEC_MAX_LENGTH bits for the code frequencies.
+POSIT8_FUNC void posit8CodeLengths(const posit8_u64 *frequencies, unsigned char *lengths)
+{
+    // tree of up to 511 nodes, the leaves are the codes that occur
+    posit8_u64 weight[511];
+    int parent[511];
+    bool active[511];
+    int leaf_node[256];
+    int nodes = 0;
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+        lengths[symbol] = 0;
+        leaf_node[symbol] = -1;
+        if (frequencies[symbol] > 0)
+        {
+            leaf_node[symbol] = nodes;
+            weight[nodes] = frequencies[symbol];
+            parent[nodes] = -1;
+            active[nodes] = true;
+            nodes++;
+        }
+    }
+    if (nodes == 1)
+    {
+        for (int symbol = 0; symbol < 256; symbol++)
+        {
+            lengths[symbol] = leaf_node[symbol] >= 0 ? 1 : 0;
+        }
+        return;
+    }
+
+    // join the two lightest nodes until one is left
+    for (int remaining = nodes; remaining > 1; remaining--)
+    {
+        int first = -1, second = -1;
+        for (int n = 0; n < nodes; n++)
+        {
+            if (!active[n])
+            {
+                continue;
+            }
+            if (first < 0 || weight[n] < weight[first])
+            {
+                second = first;
+                first = n;
+            }
+            else if (second < 0 || weight[n] < weight[second])
+            {
+                second = n;
+            }
+        }
+        weight[nodes] = weight[first] + weight[second];
+        parent[nodes] = -1;
+        active[nodes] = true;
+        parent[first] = parent[second] = nodes;
+        active[first] = active[second] = false;
+        nodes++;
+    }
+
+    // depth of every leaf, limited to the table size
+    const unsigned kraft_one = 1u << POSIT8_CODEC_MAX_LENGTH;
+    unsigned kraft = 0;
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+        if (leaf_node[symbol] < 0)
+        {
+            continue;
+        }
+        int depth = 0;
+        for (int n = leaf_node[symbol]; parent[n] >= 0; n = parent[n])
+        {
+            depth++;
+        }
+        lengths[symbol] = depth > POSIT8_CODEC_MAX_LENGTH ? POSIT8_CODEC_MAX_LENGTH : depth;
+        kraft += kraft_one >> lengths[symbol];
+    }
+
+    // limiting can break the Kraft inequality, lengthen the rarest of the longest codes below the limit
+    while (kraft > kraft_one)
+    {
+        int best = -1;
+        for (int symbol = 0; symbol < 256; symbol++)
+        {
+            if (lengths[symbol] == 0 || lengths[symbol] >= POSIT8_CODEC_MAX_LENGTH)
+            {
+                continue;
+            }
+            if (best < 0 || lengths[symbol] > lengths[best] ||
+                (lengths[symbol] == lengths[best] && frequencies[symbol] < frequencies[best]))
+            {
+                best = symbol;
+            }
+        }
+        lengths[best]++;
+        kraft -= kraft_one >> lengths[best];
+    }
+}
+
+// Writes count values (less than POSIT8_CODEC_STORED) as a stream of blocks with block_size values
+// to out, which has room for posit8StreamBound(count, block_size) bytes. Returns the size of the stream.
+POSIT8_FUNC size_t encodePosit8Stream(const posit8 *in, size_t count, unsigned block_size, unsigned char *out)
+{
+    posit8_u64 frequencies[256] = {0};
+    for (size_t i = 0; i < count; i++)
+    {
+        frequencies[in[i]]++;
+    }
+    unsigned char *lengths = out + 16;
+    posit8CodeLengths(frequencies, lengths);
+
+    // canonical codes, see buildPosit8DecodeTable
+    unsigned codes[256] = {0};
+    unsigned code = 0;
+    for (int length = 1; length <= POSIT8_CODEC_MAX_LENGTH; length++)
+    {
+        for (int symbol = 0; symbol < 256; symbol++)
+        {
+            if (lengths[symbol] == length)
+            {
+                codes[symbol] = code++;
+            }
+        }
+        code <<= 1;
+    }
+
+    unsigned num_blocks = (unsigned)((count + block_size - 1) / block_size);
+    writePosit8StreamU32(out, POSIT8_CODEC_MAGIC);
+    writePosit8StreamU32(out + 4, (unsigned)count);
+    writePosit8StreamU32(out + 8, block_size);
+    writePosit8StreamU32(out + 12, num_blocks);
+    unsigned char *block_offsets = out + POSIT8_CODEC_HEADER_SIZE;
+    unsigned char *payload = block_offsets + 4 * ((size_t)num_blocks + 1);
+
+    size_t position = 0;
+    for (unsigned b = 0; b < num_blocks; b++)
+    {
+        size_t first = (size_t)b * block_size;
+        size_t end = first + block_size < count ? first + block_size : count;
+
+        // bits are collected from the most significant bit on and written bytewise. the codes stop
+        // once they are as long as the values, which are stored instead
+        const size_t start = position;
+        const size_t stored_end = start + (end - first);
+        posit8_u64 bits = 0;
+        int used = 0;
+        for (size_t i = first; i < end && position < stored_end; i++)
+        {
+            int length = lengths[in[i]];
+            bits |= (posit8_u64)codes[in[i]] << (64 - used - length);
+            used += length;
+            while (used >= 8 && position < stored_end)
+            {
+                payload[position++] = (unsigned char)(bits >> 56);
+                bits <<= 8;
+                used -= 8;
+            }
+        }
+        if (used > 0 && position < stored_end)
+        {
+            payload[position++] = (unsigned char)(bits >> 56);
+        }
+
+        bool stored = position >= stored_end;
+        if (stored)
+        {
+            for (size_t i = first; i < end; i++)
+            {
+                payload[start + i - first] = in[i];
+            }
+            position = stored_end;
+        }
+        writePosit8StreamU32(block_offsets + 4 * (size_t)b, (unsigned)start | (stored ? POSIT8_CODEC_STORED : 0));
+    }
+    writePosit8StreamU32(block_offsets + 4 * (size_t)num_blocks, (unsigned)position);
+    return (payload - out) + position;
+}
+
+// Decodes a whole stream to out, which has room for capacity values. Returns the number of values
+// or -1 for a malformed stream.
+POSIT8_FUNC long long decodePosit8Stream(const unsigned char *stream, size_t size, posit8 *out, size_t capacity)
+{
+    posit8_stream_info info;
+    unsigned short table[POSIT8_CODEC_TABLE_SIZE];
+    if (!parsePosit8Stream(stream, size, &info) || info.count > capacity || !buildPosit8DecodeTable(info.lengths, table))
+    {
+        return -1;
+    }
+    for (unsigned b = 0; b < info.num_blocks; b++)
+    {
+        unsigned entry = readPosit8StreamU32(info.block_offsets + 4 * (size_t)b);
+        unsigned offset = entry & ~POSIT8_CODEC_STORED;
+        unsigned next_offset = readPosit8StreamU32(info.block_offsets + 4 * ((size_t)b + 1)) & ~POSIT8_CODEC_STORED;
+        size_t first = (size_t)b * info.block_size;
+        unsigned values = info.count - first < info.block_size ? (unsigned)(info.count - first) : info.block_size;
+        if (!decodePosit8Block(info.payload + offset, next_offset - offset, values, (entry & POSIT8_CODEC_STORED) != 0, table, out + first))
+        {
+            return -1;
+        }
+    }
+    return info.count;
+}
+
+#endif
+
+#endif
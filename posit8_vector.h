@@ -0,0 +1,84 @@
+// Vectors of 4, 8 and 16 posit8 values for C and OpenCL C (see posit8.h).
+//
+// On the devices the types are the built-in uchar vectors, so a kernel moves 16 posits with a single
+// vload16 and the element-wise operations get an unrolled copy of the scalar operator per lane. The
+// host compiles the same functions with the GCC vector extension, so the tests check every lane
+// against the scalar routines.
+#ifndef POSIT8_VECTOR_H
+#define POSIT8_VECTOR_H
+
+#include "posit8.h"
+
+#ifdef POSIT8_OPENCL
+typedef uchar4 posit8x4;
+typedef uchar8 posit8x8;
+typedef uchar16 posit8x16;
+#define POSIT8_VECTOR_UNROLL _Pragma("unroll")
+#else
+typedef unsigned char posit8x4 __attribute__((vector_size(4)));
+typedef unsigned char posit8x8 __attribute__((vector_size(8)));
+typedef unsigned char posit8x16 __attribute__((vector_size(16)));
+#define POSIT8_VECTOR_UNROLL
+#endif
+
+// element-wise version of a binary posit8 operation
+#define POSIT8_VECTOR_OPERATION(operation, n)                                               \
+    POSIT8_FUNC void operation##Posit8x##n(posit8x##n a, posit8x##n b, posit8x##n *result) \
+    {                                                                                       \
+        posit8x##n out;                                                                     \
+        posit8 *elementsA = (posit8 *)&a;                                                   \
+        posit8 *elementsB = (posit8 *)&b;                                                   \
+        posit8 *elementsOut = (posit8 *)&out;                                               \
+        POSIT8_VECTOR_UNROLL                                                                \
+        for (int i = 0; i < n; i++)                                                         \
+        {                                                                                   \
+            operation##Posit8(elementsA[i], elementsB[i], &elementsOut[i]);                 \
+        }                                                                                   \
+        *result = out;                                                                      \
+    }
+
+// the sigmoid approximation only needs bit operations, which work on whole vectors
+#define POSIT8_VECTOR_SIGMOID(n)                           \
+    POSIT8_FUNC void sigmoidPosit8x##n(posit8x##n *x)      \
+    {                                                      \
+        *x = *x ^ (posit8)(1 << 7);                        \
+        *x >>= 2;                                          \
+    }
+
+POSIT8_VECTOR_OPERATION(add, 4)
+POSIT8_VECTOR_OPERATION(sub, 4)
+POSIT8_VECTOR_OPERATION(mult, 4)
+POSIT8_VECTOR_OPERATION(div, 4)
+POSIT8_VECTOR_SIGMOID(4)
+POSIT8_VECTOR_OPERATION(add, 8)
+POSIT8_VECTOR_OPERATION(sub, 8)
+POSIT8_VECTOR_OPERATION(mult, 8)
+POSIT8_VECTOR_OPERATION(div, 8)
+POSIT8_VECTOR_SIGMOID(8)
+POSIT8_VECTOR_OPERATION(add, 16)
+POSIT8_VECTOR_OPERATION(sub, 16)
+POSIT8_VECTOR_OPERATION(mult, 16)
+POSIT8_VECTOR_OPERATION(div, 16)
+POSIT8_VECTOR_SIGMOID(16)
+
+#if POSIT8_HAS_QUIRE
+// adds the products of all element pairs to the quire, the vector version of fdpPosit8.
+// the quire is exact, so the order of the products does not change the result
+#define POSIT8_VECTOR_FDP(n)                                              \
+    POSIT8_FUNC void fdpPosit8x##n(quire8 *q, posit8x##n a, posit8x##n b) \
+    {                                                                     \
+        posit8 *elementsA = (posit8 *)&a;                                 \
+        posit8 *elementsB = (posit8 *)&b;                                 \
+        POSIT8_VECTOR_UNROLL                                              \
+        for (int i = 0; i < n; i++)                                       \
+        {                                                                 \
+            fdpPosit8(q, elementsA[i], elementsB[i]);                     \
+        }                                                                 \
+    }
+
+POSIT8_VECTOR_FDP(4)
+POSIT8_VECTOR_FDP(8)
+POSIT8_VECTOR_FDP(16)
+#endif
+
+#endif
@@ -1,707 +1,480 @@
-typedef unsigned char posit8; // posit with 8 bits and exponent size 0
+// the scalar posit8 routines are shared with the host and the tests, the include directory is
+// passed with -I (the host does that when it builds this file at runtime, see -source)
+#include "posit8.h"
+#include "posit8_codec.h"
+#include "posit8_vector.h"
+
+// edge length of the tiles used by matrix_mult_tiled, can be set with -DBLOCK_SIZE=<n> at compile time
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 16
+#endif
+
+// dimensions of the processing element array of matrix_mult_systolic,
+// can be set with -DSYSTOLIC_ROWS=<n> -DSYSTOLIC_COLS=<n> at compile time
+#ifndef SYSTOLIC_ROWS
+#define SYSTOLIC_ROWS 8
+#endif
+#ifndef SYSTOLIC_COLS
+#define SYSTOLIC_COLS 8
+#endif
 
-typedef struct posit_values
+__kernel void matrix_mult(__global const posit8 *A, __global const posit8 *B, int width, __global posit8 *restrict output_matrix)
 {
-    bool sign;
-    int k;
-    unsigned char exp;
-    unsigned char frac;
-    unsigned char fracLength;
-
-    bool inf;
-    bool zero;
-} posit_values;
-
+    // get index of the work item
+    unsigned x = get_global_id(0);
+    unsigned y = get_global_id(1);
 
-int _clz(char c)
-{
-    unsigned int n = 0;
-    if (c == 0)
-        return 8;
+    // accumulate the exact products and round only once at the end
+    quire8 quire = 0;
+    posit8 result = 0x0;
 
-    if ((c & 0xF0) == 0)
-    {
-        n = n + 4;
-        c = c << 4;
-    }
-    if ((c & 0xC0) == 0)
-    {
-        n = n + 2;
-        c = c << 2;
-    }
-    if ((c & 0x80) == 0)
+    for (int i = 0; i < width; i++)
     {
-        n = n + 1;
+        fdpPosit8(&quire, A[x*width + i], B[y+i*width]);
     }
-    return n;
-}
 
-posit8 twosComplement(posit8 input)
-{
-    input = ~input;
-    input = input + 1;
-    return input;
+    quire8ToPosit8(quire, &result);
+    output_matrix[y*width + x] = result;
 }
 
-void extractPositValues(posit8 input, posit_values *output)
+// tiled version of matrix_mult, every work group stages BLOCK_SIZE x BLOCK_SIZE tiles of A and B
+// in local memory so each element is read only width / BLOCK_SIZE times from global memory,
+// width has to be a multiple of BLOCK_SIZE
+__kernel
+__attribute((reqd_work_group_size(BLOCK_SIZE, BLOCK_SIZE, 1)))
+void matrix_mult_tiled(__global const posit8 *A, __global const posit8 *B, int width, __global posit8 *restrict output_matrix)
 {
-    output->exp = 0x0; //allways zero by definition
+    __local posit8 A_local[BLOCK_SIZE][BLOCK_SIZE];
+    __local posit8 B_local[BLOCK_SIZE][BLOCK_SIZE];
 
-    if (input == 0x0)
-    {
-        output->zero = true;
-        output->inf = false;
-        output->sign = false;
-        output->k = 0;
-        output->frac = 0x0;
-        output->fracLength = 0;
-    }
-    else if (input == 0x80)
-    {
-        output->zero = false;
-        output->inf = true;
-        output->sign = true;
-        output->k = 0;
-        output->frac = 0x0;
-        output->fracLength = 0;
-    }
-    else
-    {
-        output->sign = input >> 7;
-        // if negative make two's complement
-        if (output->sign)
-        {
-            input = twosComplement(input);
-        }
+    // get index of the work item
+    unsigned x = get_global_id(0);
+    unsigned y = get_global_id(1);
 
-        // regime bits consisting of zeros
-        int regime_bits = _clz(input << 1);
-        output->k = -1 * regime_bits;
+    unsigned local_x = get_local_id(0);
+    unsigned local_y = get_local_id(1);
 
-        if (regime_bits == 0)
-        {
-            // regime bits consisting of ones
-            unsigned char temp = ~(input << 1); // make bitshift before inverting for all-1-case
-            regime_bits = _clz(temp);
-            output->k = regime_bits - 1;
-        }
+    // first row of A and first column of B used by this work group
+    unsigned block_x = get_group_id(0) * BLOCK_SIZE;
+    unsigned block_y = get_group_id(1) * BLOCK_SIZE;
 
-        // flush sign and regime
-        if (regime_bits < 7)
-        {
-            output->fracLength = 8 - (regime_bits + 2); //mask all the regime bits (regime_bits + 1) + the sign bit (1)
-        }
-        else
-        {
-            output->fracLength = 0;
-        }
-        if (output->fracLength > 0)
-        {
-            unsigned char mask = ((1 << output->fracLength) - 1);
-            output->frac = input & mask;
-        }
-        else
-        {
-            output->frac = 0x0;
-        }
-    }
-}
+    quire8 quire = 0;
+    posit8 result = 0x0;
 
-void posit8ToDouble(posit8 posit, double *output)
-{
-    posit_values pval;
-    extractPositValues(posit, &pval);
-    double fraction_max = pow(2, pval.fracLength);
-    double fracVal = 1 + ((double)pval.frac / fraction_max);
-    if (posit == 0x0)
+    for (int i = 0; i < width; i += BLOCK_SIZE)
     {
-        *output = 0;
-    }
-    else
-    {
-        *output = pow(-1, pval.sign) * pow(2, pval.k) * fracVal;
-    }
-}
+        // every work item loads one element of each tile
+        A_local[local_y][local_x] = A[(block_x + local_y)*width + i + local_x];
+        B_local[local_y][local_x] = B[(i + local_y)*width + block_y + local_x];
 
-char convertFraction(double doubleFraction, unsigned int fracLength)
-{
-    char positFraction = 0x0;
-    unsigned int fracCounter = fracLength;
-    double temp = 1;
-    while (fracCounter > 0)
-    {
-        temp /= 2;
+        barrier(CLK_LOCAL_MEM_FENCE);
 
-        if (doubleFraction >= temp)
-        {
-            // shift in 1
-            positFraction <<= 1;
-            positFraction += 1;
-            doubleFraction -= temp;
-        }
-        else
+        #pragma unroll
+        for (int k = 0; k < BLOCK_SIZE; k++)
         {
-            // shift in 0
-            positFraction <<= 1;
+            fdpPosit8(&quire, A_local[local_x][k], B_local[k][local_y]);
         }
-        fracCounter--;
+
+        barrier(CLK_LOCAL_MEM_FENCE);
     }
-    return positFraction;
+
+    quire8ToPosit8(quire, &result);
+    output_matrix[y*width + x] = result;
 }
 
-void doubleToPosit8(double doubleInput, posit8 *out)
+// dot product of a row of A and a column of B for the general kernels. a row major A has the row
+// in consecutive elements, so 16 of them come with one vload16, like B if it is column major;
+// the remaining elements of a strided matrix are gathered into the vector one by one
+void generalDotPosit8(__global const posit8 *restrict A, __global const posit8 *restrict B, int row, int col, int K, int lda, int ldb,
+                      int a_col_major, int b_col_major, quire8 *quire)
 {
-    char output = 0x0;
-    unsigned int sign;
-    unsigned int regimeLength;
-    double tempDoubleInput;
-    unsigned int regimeIsOnes;
-    // extract sign
-    (doubleInput >= 0) ? (sign = 0) : (sign = 1);
-
-    if (doubleInput == 0)
-    {
-        // check for zero
-        output = 0;
-    }
-    else if (isinf(doubleInput) || isnan(doubleInput))
-    {
-        // check for infinity
-        output = 0x80;
-    }
-    else if (doubleInput >= 64)
-    {
-        // check for maxpos
-        output = 0x7F;
-    }
-    else if (doubleInput <= -64)
-    {
-        // check for minpos
-        output = 0x81;
-    }
-    else if (doubleInput <= 0.015625 && !sign)
-    {
-        // check for +minpos
-        output = 0x1;
-    }
-    else if (doubleInput >= -0.015625 && sign)
-    {
-        // check for -minpos
-        output = 0xFF;
-    }
-    else
+    int k = 0;
+    if (!a_col_major)
     {
-        if (sign)
+        for (; k + 16 <= K; k += 16)
         {
-            // Make negative numbers positive for easier computation
-            doubleInput = -doubleInput;
-        }
-
-        tempDoubleInput = doubleInput;
-
-        // check if regime is composed of ones
-        if (doubleInput > 1 || doubleInput < -1)
-        {
-            regimeIsOnes = 1;
-            regimeLength = 1; // because k = m - 1 we need to add one
-            while (tempDoubleInput >= 2)
+            posit8x16 a = vload16(0, A + row*lda + k);
+            posit8x16 b;
+            if (b_col_major)
             {
-                tempDoubleInput /= 2;
-                regimeLength++;
+                b = vload16(0, B + col*ldb + k);
             }
-        }
-        // regime is composed of zeros
-        else
-        {
-            regimeIsOnes = 0;
-            regimeLength = 0; // because k = m
-            while (tempDoubleInput < 1)
+            else
             {
-                tempDoubleInput *= 2;
-                regimeLength++;
+                posit8 column[16];
+                #pragma unroll
+                for (int i = 0; i < 16; i++)
+                {
+                    column[i] = B[(k + i)*ldb + col];
+                }
+                b = vload16(0, column);
             }
-        }
-
-        double doubleFraction = tempDoubleInput - 1; // remove hidden bit (1.0101010)
-        unsigned int fracLength = 6 - regimeLength;
-        char positFraction = convertFraction(doubleFraction, fracLength);
-
-        output = 0x0;
-
-        for (int i = 0; i < regimeLength; i++)
-        {
-            output = (output << 1) + regimeIsOnes;
-        }
-        output = (output << 1) + !regimeIsOnes;
-        output = (output << fracLength);
-        output |= positFraction;
-
-        if (sign)
-        {
-            output = twosComplement(output);
+            fdpPosit8x16(quire, a, b);
         }
     }
-    *out = output;
-}
-
 
-char kToRegime(int k)
-{
-    if (k >= 6)
-    {
-        // regime is only 1s
-        return (1 << 7) - 1;
-    }
-    if (k <= -7)
+    for (; k < K; k++)
     {
-        // regime is only 0s
-        return 0x0;
+        posit8 a = a_col_major ? A[k*lda + row] : A[row*lda + k];
+        posit8 b = b_col_major ? B[col*ldb + k] : B[k*ldb + col];
+        fdpPosit8(quire, a, b);
     }
-    if (k >= 0)
-    {
-        // k is positive, regime consists of 1s ending in 0
-        return (1 << (k + 2)) - 2;
-    }    
-    // k is negative and regime ends therefore with 1
-    return 0x1;    
 }
 
-int regimeLengthFromK(int k, int positSize)
+// general matrix multiplication C = A * B for an M x K matrix A and a K x N matrix B.
+// every matrix is stored row major or, if its *_col_major flag is set, column major, and
+// lda, ldb and ldc are the distances between two consecutive rows (or columns) of A, B and C,
+// so submatrices of larger matrices can be used. expects a global size of N x M.
+__kernel void matrix_mult_general(__global const posit8 *restrict A, __global const posit8 *restrict B, __global posit8 *restrict C,
+                                  int M, int N, int K, int lda, int ldb, int ldc,
+                                  int a_col_major, int b_col_major, int c_col_major)
 {
-    int result = 0;
+    // get index of the work item
+    int col = get_global_id(0);
+    int row = get_global_id(1);
 
-    if (k >= 0)
-    {
-        result = k + 2;
-    }
-    else if (k < 0)
-    {
-        result = -k + 1;
-    }
+    quire8 quire = 0;
+    posit8 result = 0x0;
 
-    if (result > positSize - 1)
-    {
-        result = positSize - 1;
-    }
-    return result;
-}
+    generalDotPosit8(A, B, row, col, K, lda, ldb, a_col_major, b_col_major, &quire);
 
-void addHiddenBitToFraction(posit_values *a)
-{
-    char hiddenBit = 0x1;
-    hiddenBit <<= a->fracLength;
-    a->frac |= hiddenBit;
+    quire8ToPosit8(quire, &result);
+    C[c_col_major ? col*ldc + row : row*ldc + col] = result;
 }
 
-void multPosit8(posit8 a, posit8 b, posit8 *result)
+// matrix_mult_general with a fused epilogue, C = activation((A * B + bias) * scale) with one bias
+// value per column of C (NULL for none) and an activation from POSIT8_ACTIVATION_*. A whole layer
+// runs in one pass, the product is never written out and read back
+__kernel void matrix_mult_general_fused(__global const posit8 *restrict A, __global const posit8 *restrict B, __global posit8 *restrict C,
+                                        int M, int N, int K, int lda, int ldb, int ldc,
+                                        int a_col_major, int b_col_major, int c_col_major,
+                                        __global const posit8 *restrict bias, posit8 scale, int activation)
 {
-    *result = 0x0;
-    if (a == 0x0)
-    {
-        *result = 0x0;
-    }
-    else if (b == 0x0)
-    {
-        *result = 0x0;
-    }
-    else if (a == 0x80 || b == 0x80)
-    {
-        *result = 0x80;
-    }
-    else
-    {
-        // extracting posit values
-        posit_values valuesA;
-        extractPositValues(a, &valuesA);
-        posit_values valuesB;
-        extractPositValues(b, &valuesB);
-        bool sign = valuesA.sign ^ valuesB.sign;
-
-        // adding scales of a and b
-        int newK = valuesA.k + valuesB.k;
-
-        // adding hidden bit to fraction
-        addHiddenBitToFraction(&valuesA);
-        addHiddenBitToFraction(&valuesB);
+    // get index of the work item
+    int col = get_global_id(0);
+    int row = get_global_id(1);
 
-        // keeping track of shift value for position of hidden bit
-        int fracLength;
+    quire8 quire = 0;
 
-        // shifting the mantissa of the smaller factor so both are of equal scaling
-        if (valuesA.fracLength > valuesB.fracLength)
-        {
-            valuesB.frac <<= valuesA.fracLength - valuesB.fracLength;
-            //fracLength = 2 * valuesA.fracLength;
-            fracLength = valuesA.fracLength << 1;
-        }
-        else
-        {
-            valuesA.frac <<= valuesB.fracLength - valuesA.fracLength;
-            //fracLength = 2 * valuesB.fracLength;
-            fracLength = valuesB.fracLength << 1;
-        }
+    generalDotPosit8(A, B, row, col, K, lda, ldb, a_col_major, b_col_major, &quire);
 
-        // calculating product of aligned mantissas
-        unsigned int intResult = valuesA.frac * valuesB.frac;
-
-        {
-            if (intResult >> fracLength + 1 > 0)
-            {
-                newK++;
-                fracLength++;
-            }
+    posit8 b = bias ? bias[col] : 0x0;
+    C[c_col_major ? col*ldc + row : row*ldc + col] = epiloguePosit8(quire, b, scale, activation);
+}
 
-            if (fracLength > 0)
-            {
-                // mask hidden bit
-                intResult &= 0xffffffff >> 32 - fracLength;
-            }
-            else
-            {
-                intResult = 0x0;
-            }
-        }
+// matrix_mult_general for posit<POSIT_NBITS, POSIT_ES>, only built if the format is set at compile
+// time with -DPOSIT_NBITS=<n> -DPOSIT_ES=<es> (the host passes both for -posit with -source).
+// Products go exactly into an unpacked accumulator that is rounded once, like the quire above
+#ifdef POSIT_NBITS
+#include "positn.h"
+
+#ifndef POSIT_ES
+#define POSIT_ES 0
+#endif
+
+#if POSIT_NBITS <= 8
+typedef uchar positn_storage;
+#elif POSIT_NBITS <= 16
+typedef ushort positn_storage;
+#else
+typedef uint positn_storage;
+#endif
+
+__kernel void matrix_mult_general_positn(__global const positn_storage *restrict A, __global const positn_storage *restrict B,
+                                         __global positn_storage *restrict C,
+                                         int M, int N, int K, int lda, int ldb, int ldc,
+                                         int a_col_major, int b_col_major, int c_col_major)
+{
+    // get index of the work item
+    int col = get_global_id(0);
+    int row = get_global_id(1);
 
-        int newRegimeLength = regimeLengthFromK(newK, 8);
-        int resultFracLength = 8 - newRegimeLength - 1;
+    positn_unpacked acc = zeroPositN();
 
-        unsigned int carryCondition = intResult & 0xffffffff >> 32 - (fracLength - resultFracLength);
-        bool carryBit = 0;
+    for (int k = 0; k < K; k++)
+    {
+        positn_storage a = a_col_major ? A[k*lda + row] : A[row*lda + k];
+        positn_storage b = b_col_major ? B[col*ldb + k] : B[k*ldb + col];
+        fdpPositN(&acc, a, b, POSIT_NBITS, POSIT_ES);
+    }
 
-        // check if rest of mantissa that is not used in new posit is bigger than (0.)100
-        // if so carry bit is one and will be added in the end
-        if ((fracLength - resultFracLength) > 1 && carryCondition > (0x1 << (fracLength - resultFracLength) - 1))
-        {
-            carryBit = 1;
-        }
+    C[c_col_major ? col*ldc + row : row*ldc + col] = (positn_storage)roundPositN(acc, POSIT_NBITS, POSIT_ES);
+}
+#endif
 
-        // determine new regime length
-        newRegimeLength = regimeLengthFromK(newK, 8);
+// one element of a matrix in a batch of small row major matrices, shared by the batched kernels
+void batchedDotPosit8(__global const posit8 *restrict A, __global const posit8 *restrict B, __global posit8 *restrict C,
+                      int row, int col, int K, int lda, int ldb, int ldc)
+{
+    quire8 quire = 0;
+    posit8 result = 0x0;
 
-        // transform k value to regime bits
-        char newRegime = kToRegime(newK);
+    for (int k = 0; k < K; k++)
+    {
+        fdpPosit8(&quire, A[row*lda + k], B[k*ldb + col]);
+    }
 
-        // calculate length of mantissa bits
-        resultFracLength = 8 - newRegimeLength - 1;
-        int fracShift = fracLength - resultFracLength;
-        unsigned char newFrac;
-        if (fracShift > 0)
-        {
-            newFrac = intResult >> fracShift;
-        }
-        else
-        {
-            newFrac = intResult << -fracShift;
-        }
+    quire8ToPosit8(quire, &result);
+    C[row*ldc + col] = result;
+}
 
-        *result |= newRegime << resultFracLength;
+// batched version of matrix_mult_general for many independent row major products C_i = A_i * B_i
+// in one launch. matrix i starts stride_a * i, stride_b * i and stride_c * i elements into A, B and C.
+// expects a global size of N x M x batch_count, the work group size should cover whole matrices
+// so a group never mixes products.
+__kernel void matrix_mult_batched(__global const posit8 *restrict A, __global const posit8 *restrict B, __global posit8 *restrict C,
+                                  int M, int N, int K, int lda, int ldb, int ldc,
+                                  int stride_a, int stride_b, int stride_c)
+{
+    int col = get_global_id(0);
+    int row = get_global_id(1);
+    int batch = get_global_id(2);
 
-        if (resultFracLength > 0)
-        {
-            *result |= newFrac;
-        }
+    batchedDotPosit8(A + batch*stride_a, B + batch*stride_b, C + batch*stride_c, row, col, K, lda, ldb, ldc);
+}
 
-        if (*result != 0x7f && (carryBit || ((*result & 0x1) == 1 && carryCondition == (0x1 << (fracLength - resultFracLength) - 1))))
-        {
-            *result += 1;
-        }
+// same as matrix_mult_batched, but matrix i starts at offsets[3*i], offsets[3*i + 1] and offsets[3*i + 2]
+// in A, B and C. this is the pointer array layout, the matrices can be scattered or shared between products.
+__kernel void matrix_mult_batched_offsets(__global const posit8 *restrict A, __global const posit8 *restrict B, __global posit8 *restrict C,
+                                          __global const int *restrict offsets,
+                                          int M, int N, int K, int lda, int ldb, int ldc)
+{
+    int col = get_global_id(0);
+    int row = get_global_id(1);
+    int batch = get_global_id(2);
 
-        // per definition posits never drop to zero
-        if (*result == 0x0)
-        {
-            *result = 0x1;
-        }
-        if (sign)
-        {
-            *result = twosComplement(*result);
-        }
-    }
+    batchedDotPosit8(A + offsets[3*batch], B + offsets[3*batch + 1], C + offsets[3*batch + 2], row, col, K, lda, ldb, ldc);
 }
 
-void divPosit8(posit8 a, posit8 b, posit8 *result)
+// decodes a posit8_codec.h stream in front of the multiplication kernels, so matrices cross the bus compressed.
+// payload and block_offsets are the parts of the stream after the code lengths, table is their decode table
+// (buildPosit8DecodeTable). one work item per block, the work group shares the table in local memory.
+// a block that does not decode sets *error (cleared by the host), no block reads or writes outside the buffers.
+__kernel void decode_posit8_blocks(__global const uchar *restrict payload, __global const uint *restrict block_offsets,
+                                   __global const ushort *restrict table, uint count, uint block_size,
+                                   __global posit8 *restrict out, __global int *restrict error)
 {
-    *result = 0x0;
-    if (a == 0x0)
+    __local ushort local_table[POSIT8_CODEC_TABLE_SIZE];
+    for (int i = get_local_id(0); i < POSIT8_CODEC_TABLE_SIZE; i += get_local_size(0))
     {
-        *result = 0x0;
+        local_table[i] = table[i];
     }
-    else if (b == 0x0)
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    uint block = get_global_id(0);
+    if ((ulong)block * block_size >= count)
     {
-        *result = NAN;
+        return;
     }
-    else if (a == 0x80 || b == 0x80)
+    uint first = block * block_size;
+    uint values = min(block_size, count - first);
+    uint offset = block_offsets[block] & ~POSIT8_CODEC_STORED;
+    uint next_offset = block_offsets[block + 1] & ~POSIT8_CODEC_STORED;
+    bool stored = (block_offsets[block] & POSIT8_CODEC_STORED) != 0;
+    if (!decodePosit8Block(payload + offset, next_offset - offset, values, stored, local_table, out + first))
     {
-        *result = 0x80;
+        *error = 1;
     }
-    else
-    {
-        // extracting posit values
-        posit_values valuesA;
-        extractPositValues(a, &valuesA);
-        posit_values valuesB;
-        extractPositValues(b, &valuesB);
-        bool sign = valuesA.sign ^ valuesB.sign;
-
-        // subtracting scales of a and b
-        int newK = valuesA.k - valuesB.k;
+}
 
-        // adding hidden bit to fraction
-        addHiddenBitToFraction(&valuesA);
-        addHiddenBitToFraction(&valuesB);
+// systolic array version of matrix_mult: single work item kernels connected by channels.
+// systolic_feed_a and systolic_feed_b stream one column of an A block and one row of a B block
+// per cycle into the array, matrix_mult_systolic passes them from PE to PE and every PE
+// accumulates one output element in its own quire. width has to be a multiple of
+// SYSTOLIC_ROWS and SYSTOLIC_COLS and all three kernels have to run concurrently.
+// channels only exist in the Intel FPGA compiler, other OpenCL compilers build the kernels above only.
+#if defined(INTELFPGA_CL) || defined(cl_intel_channels)
+#pragma OPENCL EXTENSION cl_intel_channels : enable
 
-        valuesB.frac <<= 7 - valuesB.fracLength;
-        valuesA.frac <<= 7 - valuesA.fracLength;
+typedef struct systolic_a_vector
+{
+    posit8 data[SYSTOLIC_ROWS];
+} systolic_a_vector;
 
-        unsigned int dividend = valuesA.frac << 7;
+typedef struct systolic_b_vector
+{
+    posit8 data[SYSTOLIC_COLS];
+} systolic_b_vector;
 
-        unsigned int quot = dividend / valuesB.frac;
-        unsigned int rem = dividend % valuesB.frac;
+channel systolic_a_vector systolic_a_channel __attribute__((depth(64)));
+channel systolic_b_vector systolic_b_channel __attribute__((depth(64)));
 
-        if (quot != 0)
+__kernel
+__attribute__((max_global_work_dim(0)))
+void systolic_feed_a(__global const posit8 *restrict A, int width)
+{
+    for (int row = 0; row < width; row += SYSTOLIC_ROWS)
+    {
+        // the block of rows is streamed again for every block of columns
+        for (int col = 0; col < width; col += SYSTOLIC_COLS)
         {
-            bool rcarry = quot >> 7; // this is the hidden bit (7th bit) , extreme right bit is bit 0
-            if (!rcarry)
+            for (int i = 0; i < width; i++)
             {
-                newK--;
-                quot <<= 1;
-            }
-        }
-
-        // determine new regime length
-        unsigned int newRegimeLength = regimeLengthFromK(newK, 8);
-
-        // transform k value to regime bits
-        char newRegime = kToRegime(newK);
-
-        int resultFracLength = 8 - newRegimeLength - 1;
+                systolic_a_vector a;
 
-        newRegime <<= resultFracLength;
-
-        *result = newRegime;
-
-        int scale;
-        if (newK < 0)
-        {
-            scale = -newK;
-        }
-        else
-        {
-            scale = newK + 1;
-        }
-
-        quot &= 0x7F;
-        unsigned char newFrac = quot;
-        newFrac >>= scale + 1;
-
-        *result |= newFrac;
-
-        bool guard = (bool)(0x1 & quot >> scale);
-        if (guard)
-        {
-            bool roundSticky = (((1 << scale) - 1) & quot) ? 1 : 0;
-            if (rem > 0 || roundSticky || ((*result & 0x1) == 1 && !roundSticky))
-            {
-                *result += 1;
+                #pragma unroll
+                for (int r = 0; r < SYSTOLIC_ROWS; r++)
+                {
+                    a.data[r] = A[(row + r)*width + i];
+                }
+                write_channel_intel(systolic_a_channel, a);
             }
         }
-
-        if (*result == 0x0)
-        {
-            *result = 0x1;
-        }
-
-        if (sign)
-        {
-            *result = twosComplement(*result);
-        }
     }
 }
 
-void addPosit8(posit8 a, posit8 b, posit8 *result)
+__kernel
+__attribute__((max_global_work_dim(0)))
+void systolic_feed_b(__global const posit8 *restrict B, int width)
 {
-    *result = 0x0;
-    if (a == 0x0)
-    {
-        *result = b;
-    }
-    else if (b == 0x0)
+    for (int row = 0; row < width; row += SYSTOLIC_ROWS)
     {
-        *result = a;
-    }
-    else if (a == 0x80 || b == 0x80)
-    {
-        *result = 0x80;
-    }
-    else if (twosComplement(a) == b)
-    {
-        *result = 0x0;
-    }
-    else
-    {
-
-        posit_values valuesA;
-        extractPositValues(a, &valuesA);
-        posit_values valuesB;
-        extractPositValues(b, &valuesB);
-
-        bool newSign = 0;
-
-        posit8 compA = a;
-        if (valuesA.sign == 1)
+        for (int col = 0; col < width; col += SYSTOLIC_COLS)
         {
-            compA = twosComplement(a);
-        }
-
-        posit8 compB = b;
-        if (valuesB.sign == 1)
-        {
-            compB = twosComplement(b);
-        }
-        newSign = (compA > compB) ? valuesA.sign : valuesB.sign;
-
-        // compute scale factor
-        int newK = valuesA.k;
-        addHiddenBitToFraction(&valuesA);
-        addHiddenBitToFraction(&valuesB);
+            for (int i = 0; i < width; i++)
+            {
+                systolic_b_vector b;
 
-        if (valuesA.k > valuesB.k)
-        {
-            valuesB.fracLength += valuesA.k - valuesB.k;
-            newK = valuesA.k;
-        }
-        else if (valuesA.k < valuesB.k)
-        {
-            valuesA.fracLength += valuesB.k - valuesA.k;
-            newK = valuesB.k;
+                #pragma unroll
+                for (int c = 0; c < SYSTOLIC_COLS; c++)
+                {
+                    b.data[c] = B[i*width + col + c];
+                }
+                write_channel_intel(systolic_b_channel, b);
+            }
         }
+    }
+}
 
-        int fracLength;
-        unsigned int fracA, fracB;
-        if (valuesA.fracLength > valuesB.fracLength)
-        {
-            fracB = valuesB.frac << valuesA.fracLength - valuesB.fracLength;
-            fracA = valuesA.frac;
-            fracLength = valuesA.fracLength;
-        }
-        else
+__kernel
+__attribute__((max_global_work_dim(0)))
+void matrix_mult_systolic(int width, __global posit8 *restrict output_matrix)
+{
+    for (int row = 0; row < width; row += SYSTOLIC_ROWS)
+    {
+        for (int col = 0; col < width; col += SYSTOLIC_COLS)
         {
-            fracA = valuesA.frac << valuesB.fracLength - valuesA.fracLength;
-            fracB = valuesB.frac;
-            fracLength = valuesB.fracLength;
-        }
-        unsigned int tempFrac;
+            quire8 quire[SYSTOLIC_ROWS][SYSTOLIC_COLS];
 
-        if (valuesA.sign == valuesB.sign)
-        {
-            tempFrac = fracA + fracB;
-        }
-        else
-        {
-            if (fracA > fracB)
-            {
-                tempFrac = fracA - fracB;
-            }
+            // operands currently held by each PE, zero posits do not change the quire
+            posit8 a_reg[SYSTOLIC_ROWS][SYSTOLIC_COLS];
+            posit8 b_reg[SYSTOLIC_ROWS][SYSTOLIC_COLS];
 
-            else
-            {
-                tempFrac = fracB - fracA;
-            }
-        }
+            // input delay lines, row r of A and column c of B enter the array r and c cycles late
+            posit8 a_skew[SYSTOLIC_ROWS][SYSTOLIC_ROWS];
+            posit8 b_skew[SYSTOLIC_COLS][SYSTOLIC_COLS];
 
-        {
-            if (tempFrac >> fracLength + 1 > 0)
+            #pragma unroll
+            for (int r = 0; r < SYSTOLIC_ROWS; r++)
             {
-                newK++;
-                fracLength++;
+                #pragma unroll
+                for (int c = 0; c < SYSTOLIC_COLS; c++)
+                {
+                    quire[r][c] = 0;
+                    a_reg[r][c] = 0x0;
+                    b_reg[r][c] = 0x0;
+                }
+                #pragma unroll
+                for (int d = 0; d < SYSTOLIC_ROWS; d++)
+                {
+                    a_skew[r][d] = 0x0;
+                }
             }
-            else
+            #pragma unroll
+            for (int c = 0; c < SYSTOLIC_COLS; c++)
             {
-                while (tempFrac >> fracLength == 0 && fracLength > 0)
+                #pragma unroll
+                for (int d = 0; d < SYSTOLIC_COLS; d++)
                 {
-                    newK--;
-                    fracLength--;
+                    b_skew[c][d] = 0x0;
                 }
             }
 
-            if (fracLength > 0)
+            // the last operands reach PE (SYSTOLIC_ROWS - 1, SYSTOLIC_COLS - 1) after the array is drained
+            for (int t = 0; t < width + SYSTOLIC_ROWS + SYSTOLIC_COLS - 2; t++)
             {
-                // mask hidden bit
-                tempFrac &= 0xffffffff >> 32 - fracLength;
-            }
-            else
-            {
-                tempFrac = 0x0;
-            }
-        }
+                systolic_a_vector a;
+                systolic_b_vector b;
 
-        int newRegimeLength = regimeLengthFromK(newK, 8);
-        int resultFracLength = 8 - newRegimeLength - 1;
-        int fractionShiftValue = fracLength - resultFracLength;
+                #pragma unroll
+                for (int r = 0; r < SYSTOLIC_ROWS; r++)
+                {
+                    a.data[r] = 0x0;
+                }
+                #pragma unroll
+                for (int c = 0; c < SYSTOLIC_COLS; c++)
+                {
+                    b.data[c] = 0x0;
+                }
 
-        unsigned int cond = tempFrac & (0xffffffff >> 32 - (fracLength - resultFracLength));
+                if (t < width)
+                {
+                    a = read_channel_intel(systolic_a_channel);
+                    b = read_channel_intel(systolic_b_channel);
+                }
 
-        bool carryBit = 0;
-        if ((fracLength - resultFracLength) > 0 && cond > (0x1 << (fracLength - resultFracLength) - 1))
-        {
-            carryBit = 1;
-        }
-        char newRegime = kToRegime(newK);
-        unsigned char newFrac = tempFrac;
+                // shift the delay lines and the operands one PE to the right and down
+                #pragma unroll
+                for (int r = 0; r < SYSTOLIC_ROWS; r++)
+                {
+                    #pragma unroll
+                    for (int d = SYSTOLIC_ROWS - 1; d > 0; d--)
+                    {
+                        a_skew[r][d] = a_skew[r][d - 1];
+                    }
+                    a_skew[r][0] = a.data[r];
+
+                    #pragma unroll
+                    for (int c = SYSTOLIC_COLS - 1; c > 0; c--)
+                    {
+                        a_reg[r][c] = a_reg[r][c - 1];
+                    }
+                    a_reg[r][0] = a_skew[r][r];
+                }
 
-        *result = 0x0 << 7;
-        *result |= newRegime << resultFracLength;
+                #pragma unroll
+                for (int c = 0; c < SYSTOLIC_COLS; c++)
+                {
+                    #pragma unroll
+                    for (int d = SYSTOLIC_COLS - 1; d > 0; d--)
+                    {
+                        b_skew[c][d] = b_skew[c][d - 1];
+                    }
+                    b_skew[c][0] = b.data[c];
+
+                    #pragma unroll
+                    for (int r = SYSTOLIC_ROWS - 1; r > 0; r--)
+                    {
+                        b_reg[r][c] = b_reg[r - 1][c];
+                    }
+                    b_reg[0][c] = b_skew[c][c];
+                }
 
-        if (resultFracLength > 0)
-        {
-            if (fractionShiftValue > 0)
-            {
-                *result |= (tempFrac >> fractionShiftValue);
+                // every PE multiplies its operands and accumulates into its own quire
+                #pragma unroll
+                for (int r = 0; r < SYSTOLIC_ROWS; r++)
+                {
+                    #pragma unroll
+                    for (int c = 0; c < SYSTOLIC_COLS; c++)
+                    {
+                        fdpPosit8(&quire[r][c], a_reg[r][c], b_reg[r][c]);
+                    }
+                }
             }
-            else
+
+            #pragma unroll
+            for (int r = 0; r < SYSTOLIC_ROWS; r++)
             {
-                *result |= (tempFrac << -fractionShiftValue);
+                #pragma unroll
+                for (int c = 0; c < SYSTOLIC_COLS; c++)
+                {
+                    posit8 result = 0x0;
+                    quire8ToPosit8(quire[r][c], &result);
+                    output_matrix[(col + c)*width + row + r] = result;
+                }
             }
         }
-
-        if (carryBit || (((*result & 0x1) == 1 && cond == (0x1 << (fracLength - resultFracLength) - 1)) && *result != 0x7f))
-        {
-            *result += 1;
-        }
-
-        if (newSign == 1)
-        {
-            *result = twosComplement(*result);
-        }
     }
 }
 
-void subPosit8(posit8 a, posit8 b, posit8 *result)
-{
-    *result = 0x0;
-    posit8 negative = twosComplement(b);
-    addPosit8(a, negative, result);
-}
-
-void sigmoidPosit8(posit8 *x)
-{
-    *x = *x ^ (1 << 7);
-    *x >>= 2;
-}
-
-__kernel void matrix_mult(__global const posit8 *A, __global const posit8 *B, int width, __global posit8 *restrict output_matrix)
-{
-    // get index of the work item
-    unsigned x = get_global_id(0);
-    unsigned y = get_global_id(1);
-
-    posit8 result = 0x0;
-    posit8 temp = 0x0;
-
-    for (int i = 0; i < width; i++)
-    {
-        multPosit8(A[x*width + i], B[y+i*width], &temp);
-        addPosit8(result, temp, &result);
-    }
-
-    output_matrix[y*width + x] = result;    
-}
+#endif
@@ -0,0 +1,42 @@
+#ifndef CPU_GEMM_H
+#define CPU_GEMM_H
+
+#include <stddef.h>
+
+// Multithreaded posit8 matrix multiplication on the host. Used when no OpenCL device is available
+// and as reference for device results: like the kernels it sums all products exactly in a quire
+// and rounds once, so the results are bit identical to matrix_mult_general.
+
+// shape and storage layout of a general multiplication C = A * B with A of size M x K and B of size K x N,
+// ld* are the distances between consecutive rows (or columns for column major matrices)
+typedef struct gemm_params
+{
+    unsigned M;
+    unsigned N;
+    unsigned K;
+    unsigned lda;
+    unsigned ldb;
+    unsigned ldc;
+    bool a_col_major;
+    bool b_col_major;
+    bool c_col_major;
+} gemm_params;
+
+// fused epilogue C = activation((A * B + bias) * scale) like matrix_mult_general_fused, see epiloguePosit8
+typedef struct gemm_epilogue
+{
+    const unsigned char *bias; // one posit8 per column of C, NULL for none
+    unsigned char scale;       // posit8, 0x40 is 1.0
+    int activation;            // POSIT8_ACTIVATION_NONE, _RELU or _SIGMOID
+} gemm_epilogue;
+
+// Computes C = A * B on num_threads threads, 0 uses one thread per core. With an epilogue the
+// results go through it before they are stored, like matrix_mult_general_fused.
+void cpuGemmPosit8(const unsigned char *A, const unsigned char *B, unsigned char *C, const gemm_params &params, unsigned num_threads,
+                   const gemm_epilogue *epilogue = NULL);
+
+// Computes C = A * B for posit<nbits, es> (see positn.h), the elements are the smallest unsigned
+// integers that hold nbits (1, 2 or 4 bytes). Bit identical to matrix_mult_general_positn.
+void cpuGemmPositN(const void *A, const void *B, void *C, const gemm_params &params, int nbits, int es, unsigned num_threads);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef GEMM_SERVICE_H
+#define GEMM_SERVICE_H
+
+// Local socket protocol of the persistent posit8 GEMM service (host -serve=<socket>). The service
+// sets up the device once and answers any number of requests, a client connection can send several
+// requests one after the other. All fields are uint32 in host byte order, the socket is local.
+//
+//   request:  GEMM_SERVICE_MAGIC, M, N, K, flags (GEMM_SERVICE_*_COL_MAJOR), then A and B
+//   response: status (GEMM_SERVICE_OK or GEMM_SERVICE_INVALID), then C if the status is GEMM_SERVICE_OK
+//
+// The matrices are tightly packed posit8 in the storage order given by the flags, so every leading
+// dimension is the length of a row or column.
+
+#include <signal.h>
+#include "cpu_gemm.h"
+
+#define GEMM_SERVICE_MAGIC 0x4D473850 // "P8GM"
+#define GEMM_SERVICE_A_COL_MAJOR 0x1
+#define GEMM_SERVICE_B_COL_MAJOR 0x2
+#define GEMM_SERVICE_C_COL_MAJOR 0x4
+
+#define GEMM_SERVICE_OK 0
+#define GEMM_SERVICE_INVALID 1
+
+// largest matrix the service accepts, in elements
+#define GEMM_SERVICE_MAX_ELEMENTS (1u << 28)
+
+// the service drops a client that neither sends nor reads for this long
+#define GEMM_SERVICE_TIMEOUT_SECONDS 10
+
+// Set by the signal handler of the service. Reads and writes interrupted by a signal give up once it
+// is set, so the service stops even while a client is connected.
+extern volatile sig_atomic_t gemmServiceStopped;
+
+// Socket bound to path (a stale socket is replaced, any other file is kept), -1 on errors.
+int listenGemmService(const char *path);
+// Next client connection with send and receive timeouts, -1 if a signal interrupted the wait.
+int acceptGemmClient(int listen_fd);
+// Connection to the service at path, -1 on errors.
+int connectGemmService(const char *path);
+
+// Service side. readGemmRequest fails on a closed connection or a malformed header, params gets the
+// packed shape and the caller reads A and B with readAll.
+bool readGemmRequest(int fd, gemm_params &params);
+bool writeGemmResult(int fd, unsigned status, const gemm_params &params, const unsigned char *C);
+
+// Client side, C = A * B on the service. Returns false if the connection fails or the service rejects the request.
+bool requestGemm(int fd, const gemm_params &params, const unsigned char *A, const unsigned char *B, unsigned char *C);
+
+// Packed shape for M, N, K and the layout flags.
+gemm_params packedGemmParams(unsigned M, unsigned N, unsigned K, unsigned flags);
+
+bool readAll(int fd, void *data, size_t size);
+bool writeAll(int fd, const void *data, size_t size);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef MLP_H
+#define MLP_H
+
+// Multi-layer perceptron with posit8 weights. Every layer computes
+// Y = activation((X * W + bias) * scale) for a batch of row vectors X, which is one pass of
+// matrix_mult_general_fused on the device or cpuGemmPosit8 with an epilogue on the host.
+//
+// Model files are little endian binaries:
+//   "P8MLP\0\0\0", uint32 number of layers, then for every layer
+//   uint32 inputs, uint32 outputs, uint32 activation (POSIT8_ACTIVATION_*), uint8 scale,
+//   inputs * outputs weights (row major, one row per input) and outputs bias values, all posit8
+// Compressed models start with "P8MLPZ\0\0" and store the weights of every layer as uint32 size
+// followed by a posit8_codec.h stream of that size.
+
+#include <string>
+#include <vector>
+
+typedef struct mlp_layer
+{
+    unsigned inputs;
+    unsigned outputs;
+    int activation;
+    unsigned char scale;
+    std::vector<unsigned char> weights; // inputs x outputs, row major
+    std::vector<unsigned char> bias;    // outputs
+} mlp_layer;
+
+typedef struct mlp_model
+{
+    std::vector<mlp_layer> layers;
+} mlp_model;
+
+bool loadMlp(const std::string &path, mlp_model &model);
+bool saveMlp(const std::string &path, const mlp_model &model, bool compressed = false);
+
+// Random model with the given layer widths (sizes[0] inputs), sigmoid on the hidden layers and no
+// activation on the last one. Weights are uniform in +-1/sqrt(inputs), so activations keep their range.
+void randomMlp(const std::vector<unsigned> &sizes, mlp_model &model);
+
+// Runs a batch of rows input vectors through the model on the host, output gets rows x outputs of the last layer.
+void cpuMlpForward(const mlp_model &model, const unsigned char *input, unsigned rows, std::vector<unsigned char> &output, unsigned num_threads);
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef OPENCL_UTILS_H
+#define OPENCL_UTILS_H
+
+// Host side OpenCL helpers. Covers the part of the Intel FPGA AOCLUtils library the host uses,
+// so it builds against any OpenCL 1.2 implementation without the external ../common tree.
+
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "CL/opencl.h"
+
+// Has to be defined by the application, called by checkError before the process exits.
+void cleanup();
+
+namespace ocl_utils
+{
+
+// Array allocated with the alignment the Intel FPGA runtime needs for DMA transfers (64 bytes),
+// freed when it goes out of scope or is reset.
+template <typename T>
+class scoped_aligned_ptr
+{
+  public:
+    scoped_aligned_ptr() : ptr(NULL) {}
+    explicit scoped_aligned_ptr(size_t count) : ptr(NULL) { reset(count); }
+    ~scoped_aligned_ptr() { reset(); }
+
+    void reset()
+    {
+        free(ptr);
+        ptr = NULL;
+    }
+
+    void reset(size_t count)
+    {
+        reset();
+        if (posix_memalign((void **)&ptr, ALIGNMENT, count * sizeof(T) > 0 ? count * sizeof(T) : 1) != 0)
+        {
+            ptr = NULL;
+        }
+    }
+
+    T *get() const { return ptr; }
+    operator T *() const { return ptr; }
+
+    T *release()
+    {
+        T *released = ptr;
+        ptr = NULL;
+        return released;
+    }
+
+    static const size_t ALIGNMENT = 64;
+
+  private:
+    scoped_aligned_ptr(const scoped_aligned_ptr &);
+    scoped_aligned_ptr &operator=(const scoped_aligned_ptr &);
+
+    T *ptr;
+};
+
+// Array allocated with new[], deleted when it goes out of scope or is reset.
+template <typename T>
+class scoped_array
+{
+  public:
+    scoped_array() : ptr(NULL) {}
+    explicit scoped_array(T *ptr) : ptr(ptr) {}
+    explicit scoped_array(size_t count) : ptr(new T[count]) {}
+    ~scoped_array() { delete[] ptr; }
+
+    void reset(T *new_ptr = NULL)
+    {
+        delete[] ptr;
+        ptr = new_ptr;
+    }
+
+    void reset(size_t count) { reset(new T[count]); }
+
+    T *get() const { return ptr; }
+    operator T *() const { return ptr; }
+
+    T *release()
+    {
+        T *released = ptr;
+        ptr = NULL;
+        return released;
+    }
+
+  private:
+    scoped_array(const scoped_array &);
+    scoped_array &operator=(const scoped_array &);
+
+    T *ptr;
+};
+
+// Pool of device visible host memory for zero copy transfers. Every buffer wraps 64 byte aligned
+// host memory (CL_MEM_USE_HOST_PTR), so producers write posit data straight into the memory the
+// kernels read and the runtime can use it for DMA or, with shared memory, without any copy.
+// OpenCL needs the host memory of a buffer to be unmapped while kernels use it: unmap hands a
+// buffer to the device, map hands it back. Released buffers are kept and reused for later requests.
+typedef struct host_buffer
+{
+    cl_mem buf;  // buffer for the kernel arguments
+    void *ptr;   // aligned host memory behind buf, only accessed by the host while mapped
+    size_t size; // bytes, a multiple of the alignment
+    bool mapped;
+    bool in_use;
+} host_buffer;
+
+class host_buffer_pool
+{
+  public:
+    host_buffer_pool(cl_context context, cl_command_queue queue) : context(context), queue(queue) {}
+    ~host_buffer_pool();
+
+    // Mapped buffer of at least size bytes, the smallest free one of the pool or a new one.
+    host_buffer *acquire(size_t size);
+    // Makes the host writes visible to the device, kernels can use buf after event.
+    void unmap(host_buffer *buffer, cl_uint num_wait_events, const cl_event *wait_events, cl_event *event);
+    // Blocks until the device writes are visible at ptr, e.g. after the kernel event.
+    void map(host_buffer *buffer, cl_uint num_wait_events, const cl_event *wait_events);
+    // Returns the buffer to the pool, it stays allocated.
+    void release(host_buffer *buffer);
+
+    size_t allocatedBytes() const;
+
+    static const size_t ALIGNMENT = 64;
+
+  private:
+    host_buffer_pool(const host_buffer_pool &);
+    host_buffer_pool &operator=(const host_buffer_pool &);
+
+    cl_context context;
+    cl_command_queue queue;
+    std::vector<host_buffer *> buffers;
+};
+
+// Prints the message with the OpenCL error name, calls cleanup() and exits if error is not CL_SUCCESS.
+void _checkError(int line, const char *file, cl_int error, const char *msg, ...);
+#define checkError(status, ...) _checkError(__LINE__, __FILE__, status, __VA_ARGS__)
+
+const char *getErrorString(cl_int error);
+
+// Changes the working directory to the directory of the executable, so relative paths of the
+// kernel binary or source work independent of where the host is started from.
+bool setCwdToExeDir();
+
+// First platform whose name contains search (case insensitive), an empty search matches the first platform.
+// Returns NULL if there is no such platform.
+cl_platform_id findPlatform(const char *search);
+
+// Devices of the given type on the platform, the caller frees the array with delete[].
+// Returns NULL and sets num_devices to 0 if the platform has no such device.
+cl_device_id *getDevices(cl_platform_id platform, cl_device_type device_type, cl_uint *num_devices);
+
+std::string getPlatformName(cl_platform_id platform);
+std::string getDeviceName(cl_device_id device);
+
+bool fileExists(const char *file_name);
+
+// prefix.aocx, the name aoc gives the compiled kernels, empty (after printing an error) if it does not exist.
+std::string getBoardBinaryFile(const char *prefix, cl_device_id device);
+
+// Program from an offline compiled binary, e.g. an .aocx file, for all devices.
+cl_program createProgramFromBinary(cl_context context, const char *binary_file_name, const cl_device_id *devices, unsigned num_devices);
+
+// Program from OpenCL C source, for runtimes that compile kernels on the fly (e.g. PoCL on a CPU).
+cl_program createProgramFromSource(cl_context context, const char *source_file_name);
+
+// Builds the program and prints the build log of the first device if that fails.
+cl_int buildProgram(cl_program program, cl_uint num_devices, const cl_device_id *devices, const char *options);
+
+void oclContextCallback(const char *errinfo, const void *, size_t, void *);
+
+// Time between the start and the end of the command in ns, the queue needs profiling enabled.
+cl_ulong getStartEndTime(cl_event event);
+cl_ulong getStartEndTime(cl_event event, cl_profiling_info start, cl_profiling_info end);
+
+// Monotonic wall clock time in seconds.
+double getCurrentTimestamp();
+
+} // namespace ocl_utils
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef TENSOR_FILE_H
+#define TENSOR_FILE_H
+
+// Binary container for posit tensors that is used through mmap, so loading a matrix neither parses
+// nor copies it: the pages are read from the file when the host or a device transfer first touches
+// them and the kernel can drop them again under memory pressure, so tensors may be larger than RAM.
+//
+// Little endian header of TENSOR_FILE_HEADER_SIZE bytes:
+//   char[8] "P8TENSOR", uint32 version (1), uint32 nbits, uint32 es, uint32 rank (1 to 4),
+//   uint32 dims[4] (unused dimensions are 1), uint64 data offset, uint64 data size
+// The elements follow at the data offset, a multiple of TENSOR_FILE_ALIGNMENT, in row major order
+// and in the smallest unsigned integer that holds nbits (1 byte for posit<8,0>).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TENSOR_FILE_HEADER_SIZE 64
+#define TENSOR_FILE_ALIGNMENT 4096 // pages, so the data can be mapped and transferred without copies
+#define TENSOR_FILE_MAX_RANK 4
+
+typedef struct tensor_header
+{
+    int nbits;
+    int es;
+    unsigned rank;
+    unsigned dims[TENSOR_FILE_MAX_RANK];
+    uint64_t data_offset;
+    uint64_t data_size;
+} tensor_header;
+
+typedef struct mapped_tensor
+{
+    tensor_header header;
+    unsigned char *data; // data_size bytes, read only unless created by createTensorFile
+    void *map;
+    size_t map_size;
+    bool writable;
+    char *path;      // of a created file, which is written to temp_path until finishTensorFile
+    char *temp_path;
+} mapped_tensor;
+
+// Bytes per element, 1, 2 or 4.
+size_t tensorElementSize(const tensor_header &header);
+size_t tensorElements(const tensor_header &header);
+
+// Maps an existing tensor file read only. Returns false and prints the reason on errors.
+bool mapTensorFile(const char *path, mapped_tensor &tensor);
+
+// Creates a tensor file of the given format and shape next to path and maps it writable, the caller
+// fills tensor.data. A file at path is only replaced by finishTensorFile.
+bool createTensorFile(const char *path, int nbits, int es, unsigned rank, const unsigned *dims, mapped_tensor &tensor);
+
+// Writes the data of a created tensor back and renames it to its path. Returns false and prints the reason on errors.
+bool finishTensorFile(mapped_tensor &tensor);
+
+// Unmaps the tensor, a created file that was not finished is removed.
+void closeTensorFile(mapped_tensor &tensor);
+
+#endif
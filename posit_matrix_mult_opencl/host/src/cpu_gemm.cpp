@@ -0,0 +1,361 @@
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include "cpu_gemm.h"
+#include "posit8.h"
+#include "positn.h"
+
+// Every posit8 value is a multiple of 2^-6 with a magnitude of at most 2^6, so it is stored
+// as value * 64 in an int16 and the product of two of them is exactly the quire of the device
+// kernels (value * 2^12). KC products fit into an int32, those partial sums go into int64 quires.
+
+// rows of A and columns of B per register block of the micro kernel
+#define CPU_GEMM_MR 4
+#define CPU_GEMM_NR 8
+// rows of A per task, one packed block of A stays in L1/L2 while it is multiplied with all of B
+#define CPU_GEMM_MC 64
+// depth of the int32 partial sums, KC * 2^24 has to stay below 2^31
+#define CPU_GEMM_KC 64
+
+#define POSIT8_NAR 0x80
+
+namespace
+{
+
+// posit8 in units of 2^-6, NaR is handled separately and maps to 0
+int16_t posit8ToFixed(unsigned char p)
+{
+    if (p == 0x0 || p == POSIT8_NAR)
+    {
+        return 0;
+    }
+
+    // value * 64 = significand * 2^(k + 6 - 7), the lsb of every posit8 is at least 2^-6 so this is exact
+    posit8_decoded decoded = decodePosit8(p);
+    int16_t fixed = (decoded.significand << (decoded.scale + 6)) >> 7;
+    return decoded.sign ? -fixed : fixed;
+}
+
+struct fixed_table
+{
+    int16_t value[256];
+
+    fixed_table()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            value[i] = posit8ToFixed(i);
+        }
+    }
+};
+
+const fixed_table fixedTable;
+
+// Persistent worker threads, run() hands out task indices until all tasks are done.
+class ThreadPool
+{
+  public:
+    explicit ThreadPool(unsigned num_threads) : tasks(0), generation(0), stopping(false)
+    {
+        // the calling thread works as well, so one thread less is started
+        for (unsigned i = 1; i < num_threads; i++)
+        {
+            workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            workers[i].join();
+        }
+    }
+
+    unsigned size() const { return workers.size() + 1; }
+
+    void run(unsigned num_tasks, const std::function<void(unsigned)> &task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = &task;
+            tasks = num_tasks;
+            next_task = 0;
+            busy_workers = workers.size();
+            generation++;
+        }
+        wake.notify_all();
+
+        processTasks(task);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busy_workers == 0; });
+    }
+
+  private:
+    void processTasks(const std::function<void(unsigned)> &task)
+    {
+        for (unsigned i = next_task++; i < tasks; i = next_task++)
+        {
+            task(i);
+        }
+    }
+
+    void workerLoop()
+    {
+        unsigned seen_generation = 0;
+        while (true)
+        {
+            const std::function<void(unsigned)> *task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen_generation; });
+                if (stopping)
+                {
+                    return;
+                }
+                seen_generation = generation;
+                task = current;
+            }
+
+            processTasks(*task);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy_workers == 0)
+            {
+                done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(unsigned)> *current;
+    unsigned tasks;
+    std::atomic<unsigned> next_task;
+    unsigned busy_workers;
+    unsigned generation;
+    bool stopping;
+};
+
+ThreadPool &getThreadPool(unsigned num_threads)
+{
+    static ThreadPool *pool = NULL;
+    if (num_threads == 0)
+    {
+        num_threads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    }
+    if (pool == NULL || pool->size() != num_threads)
+    {
+        delete pool;
+        pool = new ThreadPool(num_threads);
+    }
+    return *pool;
+}
+
+// C[MR x NR] += A[MR x depth] * B[depth x NR] for packed strips of A (k major, MR values per k)
+// and B (k major, NR values per k). the int32 sums restart every KC steps so they can not overflow
+void microKernel(const int16_t *a, const int16_t *b, unsigned depth, int64_t quire[CPU_GEMM_MR][CPU_GEMM_NR])
+{
+    for (unsigned k0 = 0; k0 < depth; k0 += CPU_GEMM_KC)
+    {
+        unsigned k_end = k0 + CPU_GEMM_KC < depth ? k0 + CPU_GEMM_KC : depth;
+        int32_t sum[CPU_GEMM_MR][CPU_GEMM_NR] = {};
+
+        for (unsigned k = k0; k < k_end; k++)
+        {
+            for (unsigned r = 0; r < CPU_GEMM_MR; r++)
+            {
+                int32_t a_value = a[k * CPU_GEMM_MR + r];
+                for (unsigned c = 0; c < CPU_GEMM_NR; c++)
+                {
+                    sum[r][c] += a_value * b[k * CPU_GEMM_NR + c];
+                }
+            }
+        }
+
+        for (unsigned r = 0; r < CPU_GEMM_MR; r++)
+        {
+            for (unsigned c = 0; c < CPU_GEMM_NR; c++)
+            {
+                quire[r][c] += sum[r][c];
+            }
+        }
+    }
+}
+
+// C = A * B for one element type of the generic formats. B is decoded once column by column and
+// every task decodes its block of MC rows of A, so the inner loop only multiplies and adds
+template <typename T>
+void gemmPositN(const T *A, const T *B, T *C, const gemm_params &params, int nbits, int es, unsigned num_threads)
+{
+    const unsigned M = params.M, N = params.N, K = params.K;
+    const size_t a_row = params.a_col_major ? 1 : params.lda, a_col = params.a_col_major ? params.lda : 1;
+    const size_t b_row = params.b_col_major ? 1 : params.ldb, b_col = params.b_col_major ? params.ldb : 1;
+    const size_t c_row = params.c_col_major ? 1 : params.ldc, c_col = params.c_col_major ? params.ldc : 1;
+
+    std::vector<positn_unpacked> decoded_b((size_t)N * K);
+    for (unsigned n = 0; n < N; n++)
+    {
+        for (unsigned k = 0; k < K; k++)
+        {
+            decoded_b[(size_t)n * K + k] = decodePositN(B[k * b_row + n * b_col], nbits, es);
+        }
+    }
+
+    ThreadPool &pool = getThreadPool(num_threads);
+    const unsigned num_blocks = (M + CPU_GEMM_MC - 1) / CPU_GEMM_MC;
+
+    pool.run(num_blocks, [&](unsigned block) {
+        const unsigned m0 = block * CPU_GEMM_MC;
+        const unsigned rows = M - m0 < CPU_GEMM_MC ? M - m0 : CPU_GEMM_MC;
+
+        std::vector<positn_unpacked> decoded_a((size_t)rows * K);
+        for (unsigned r = 0; r < rows; r++)
+        {
+            for (unsigned k = 0; k < K; k++)
+            {
+                decoded_a[(size_t)r * K + k] = decodePositN(A[(m0 + r) * a_row + k * a_col], nbits, es);
+            }
+        }
+
+        for (unsigned r = 0; r < rows; r++)
+        {
+            const positn_unpacked *a = &decoded_a[(size_t)r * K];
+            for (unsigned n = 0; n < N; n++)
+            {
+                const positn_unpacked *b = &decoded_b[(size_t)n * K];
+                positn_unpacked acc = zeroPositN();
+                for (unsigned k = 0; k < K; k++)
+                {
+                    acc = addUnpackedPositN(acc, multUnpackedPositN(a[k], b[k]));
+                }
+                C[(m0 + r) * c_row + n * c_col] = (T)roundPositN(acc, nbits, es);
+            }
+        }
+    });
+}
+
+} // namespace
+
+void cpuGemmPosit8(const unsigned char *A, const unsigned char *B, unsigned char *C, const gemm_params &params, unsigned num_threads,
+                   const gemm_epilogue *epilogue)
+{
+    const unsigned M = params.M, N = params.N, K = params.K;
+    if (M == 0 || N == 0)
+    {
+        return;
+    }
+
+    // element strides along rows and columns of each matrix
+    const size_t a_row = params.a_col_major ? 1 : params.lda, a_col = params.a_col_major ? params.lda : 1;
+    const size_t b_row = params.b_col_major ? 1 : params.ldb, b_col = params.b_col_major ? params.ldb : 1;
+    const size_t c_row = params.c_col_major ? 1 : params.ldc, c_col = params.c_col_major ? params.ldc : 1;
+
+    // pack all of B once into strips of NR columns, zero padded at the right edge.
+    // a NaR anywhere in a column of B makes the whole column of C NaR, like in the kernels
+    const unsigned num_strips = (N + CPU_GEMM_NR - 1) / CPU_GEMM_NR;
+    std::vector<int16_t> packed_b((size_t)num_strips * K * CPU_GEMM_NR, 0);
+    std::vector<bool> nar_col(N, false);
+    for (unsigned n = 0; n < N; n++)
+    {
+        int16_t *strip = &packed_b[(size_t)(n / CPU_GEMM_NR) * K * CPU_GEMM_NR];
+        for (unsigned k = 0; k < K; k++)
+        {
+            unsigned char b = B[k * b_row + n * b_col];
+            strip[k * CPU_GEMM_NR + n % CPU_GEMM_NR] = fixedTable.value[b];
+            if (b == POSIT8_NAR)
+            {
+                nar_col[n] = true;
+            }
+        }
+    }
+
+    ThreadPool &pool = getThreadPool(num_threads);
+    const unsigned num_blocks = (M + CPU_GEMM_MC - 1) / CPU_GEMM_MC;
+
+    pool.run(num_blocks, [&](unsigned block) {
+        const unsigned m0 = block * CPU_GEMM_MC;
+        const unsigned rows = M - m0 < CPU_GEMM_MC ? M - m0 : CPU_GEMM_MC;
+
+        // pack the rows of this block into strips of MR rows, zero padded at the bottom edge
+        std::vector<int16_t> packed_a((size_t)CPU_GEMM_MC * K, 0);
+        bool nar_row[CPU_GEMM_MC] = {};
+        for (unsigned r = 0; r < rows; r++)
+        {
+            int16_t *strip = &packed_a[(size_t)(r / CPU_GEMM_MR) * K * CPU_GEMM_MR];
+            for (unsigned k = 0; k < K; k++)
+            {
+                unsigned char a = A[(m0 + r) * a_row + k * a_col];
+                strip[k * CPU_GEMM_MR + r % CPU_GEMM_MR] = fixedTable.value[a];
+                if (a == POSIT8_NAR)
+                {
+                    nar_row[r] = true;
+                }
+            }
+        }
+
+        for (unsigned s = 0; s < num_strips; s++)
+        {
+            const int16_t *b_strip = &packed_b[(size_t)s * K * CPU_GEMM_NR];
+            for (unsigned r0 = 0; r0 < rows; r0 += CPU_GEMM_MR)
+            {
+                int64_t quire[CPU_GEMM_MR][CPU_GEMM_NR] = {};
+                microKernel(&packed_a[(size_t)(r0 / CPU_GEMM_MR) * K * CPU_GEMM_MR], b_strip, K, quire);
+
+                for (unsigned r = r0; r < r0 + CPU_GEMM_MR && r < rows; r++)
+                {
+                    for (unsigned c = 0; c < CPU_GEMM_NR && s * CPU_GEMM_NR + c < N; c++)
+                    {
+                        unsigned n = s * CPU_GEMM_NR + c;
+                        posit8 result = POSIT8_NAR;
+                        if (!nar_row[r] && !nar_col[n])
+                        {
+                            if (epilogue)
+                            {
+                                posit8 bias = epilogue->bias ? epilogue->bias[n] : 0x0;
+                                result = epiloguePosit8(quire[r - r0][c], bias, epilogue->scale, epilogue->activation);
+                            }
+                            else
+                            {
+                                quire8ToPosit8(quire[r - r0][c], &result);
+                            }
+                        }
+                        C[(m0 + r) * c_row + n * c_col] = result;
+                    }
+                }
+            }
+        }
+    });
+}
+
+void cpuGemmPositN(const void *A, const void *B, void *C, const gemm_params &params, int nbits, int es, unsigned num_threads)
+{
+    if (params.M == 0 || params.N == 0)
+    {
+        return;
+    }
+    if (nbits <= 8)
+    {
+        gemmPositN((const uint8_t *)A, (const uint8_t *)B, (uint8_t *)C, params, nbits, es, num_threads);
+    }
+    else if (nbits <= 16)
+    {
+        gemmPositN((const uint16_t *)A, (const uint16_t *)B, (uint16_t *)C, params, nbits, es, num_threads);
+    }
+    else
+    {
+        gemmPositN((const uint32_t *)A, (const uint32_t *)B, (uint32_t *)C, params, nbits, es, num_threads);
+    }
+}
@@ -0,0 +1,180 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "gemm_service.h"
+
+volatile sig_atomic_t gemmServiceStopped = 0;
+
+namespace
+{
+
+bool socketAddress(const char *path, sockaddr_un &address)
+{
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        printf("ERROR: Socket path %s is too long.\n", path);
+        return false;
+    }
+    strcpy(address.sun_path, path);
+    return true;
+}
+
+} // namespace
+
+int listenGemmService(const char *path)
+{
+    sockaddr_un address;
+    if (!socketAddress(path, address))
+    {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    // only a stale socket is replaced, never another kind of file
+    struct stat info;
+    if (lstat(path, &info) == 0)
+    {
+        if (!S_ISSOCK(info.st_mode))
+        {
+            printf("ERROR: %s exists and is not a socket.\n", path);
+            close(fd);
+            return -1;
+        }
+        unlink(path);
+    }
+    if (bind(fd, (sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 16) != 0)
+    {
+        printf("ERROR: Can not listen on %s: %s.\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int acceptGemmClient(int listen_fd)
+{
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd >= 0)
+    {
+        // a client that stops sending or reading is dropped, so it can not hold up the others
+        struct timeval timeout = {GEMM_SERVICE_TIMEOUT_SECONDS, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    }
+    return fd;
+}
+
+int connectGemmService(const char *path)
+{
+    sockaddr_un address;
+    if (!socketAddress(path, address))
+    {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0)
+    {
+        printf("ERROR: Can not connect to %s: %s.\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool readAll(int fd, void *data, size_t size)
+{
+    unsigned char *bytes = (unsigned char *)data;
+    while (size > 0)
+    {
+        ssize_t count = read(fd, bytes, size);
+        if (count < 0 && errno == EINTR && !gemmServiceStopped)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return false;
+        }
+        bytes += count;
+        size -= count;
+    }
+    return true;
+}
+
+bool writeAll(int fd, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    while (size > 0)
+    {
+        // no SIGPIPE if the other side is gone
+        ssize_t count = send(fd, bytes, size, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR && !gemmServiceStopped)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            return false;
+        }
+        bytes += count;
+        size -= count;
+    }
+    return true;
+}
+
+gemm_params packedGemmParams(unsigned M, unsigned N, unsigned K, unsigned flags)
+{
+    gemm_params params;
+    params.M = M;
+    params.N = N;
+    params.K = K;
+    params.a_col_major = flags & GEMM_SERVICE_A_COL_MAJOR;
+    params.b_col_major = flags & GEMM_SERVICE_B_COL_MAJOR;
+    params.c_col_major = flags & GEMM_SERVICE_C_COL_MAJOR;
+    params.lda = params.a_col_major ? M : K;
+    params.ldb = params.b_col_major ? K : N;
+    params.ldc = params.c_col_major ? M : N;
+    return params;
+}
+
+bool readGemmRequest(int fd, gemm_params &params)
+{
+    uint32_t header[5];
+    if (!readAll(fd, header, sizeof(header)) || header[0] != GEMM_SERVICE_MAGIC)
+    {
+        return false;
+    }
+    params = packedGemmParams(header[1], header[2], header[3], header[4]);
+    return true;
+}
+
+bool writeGemmResult(int fd, unsigned status, const gemm_params &params, const unsigned char *C)
+{
+    uint32_t status_field = status;
+    return writeAll(fd, &status_field, sizeof(status_field)) && (status != GEMM_SERVICE_OK || writeAll(fd, C, (size_t)params.M * params.N));
+}
+
+bool requestGemm(int fd, const gemm_params &params, const unsigned char *A, const unsigned char *B, unsigned char *C)
+{
+    uint32_t header[5] = {GEMM_SERVICE_MAGIC, params.M, params.N, params.K, 0};
+    header[4] = (params.a_col_major ? GEMM_SERVICE_A_COL_MAJOR : 0) | (params.b_col_major ? GEMM_SERVICE_B_COL_MAJOR : 0) |
+                (params.c_col_major ? GEMM_SERVICE_C_COL_MAJOR : 0);
+    uint32_t status;
+    return writeAll(fd, header, sizeof(header)) && writeAll(fd, A, (size_t)params.M * params.K) && writeAll(fd, B, (size_t)params.K * params.N) &&
+           readAll(fd, &status, sizeof(status)) && status == GEMM_SERVICE_OK && readAll(fd, C, (size_t)params.M * params.N);
+}
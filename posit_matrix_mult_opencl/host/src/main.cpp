@@ -1,26 +1,54 @@
 #include <assert.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "CL/opencl.h"
-#include "AOCLUtils/aocl_utils.h"
+#include "opencl_utils.h"
+#include "cpu_gemm.h"
+#include "gemm_service.h"
+#include "mlp.h"
+#include "posit8.h"
+#include "posit8_codec.h"
+#include "positn.h"
+#include "tensor_file.h"
 
-using namespace aocl_utils;
+using namespace ocl_utils;
 
 #define STRING_BUFFER_LEN 1024
 
-typedef struct posit_values
-{
-    bool sign;
-    int k;
-    unsigned char exp;
-    unsigned char frac;
-    unsigned char fracLength;
-
-    bool inf;
-    bool zero;
-} posit_values;
+// edge length of the tiles of matrix_mult_tiled, has to match the BLOCK_SIZE the device was compiled with
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 16
+#endif
+
+// dimensions of the PE array of matrix_mult_systolic, have to match the device compilation as well
+#ifndef SYSTOLIC_ROWS
+#define SYSTOLIC_ROWS 8
+#endif
+#ifndef SYSTOLIC_COLS
+#define SYSTOLIC_COLS 8
+#endif
+
+// the calibration launch of runGemm gives every device this many rows of A and is at most
+// CALIBRATION_SIZE deep and wide, so it costs a small fraction of a large multiplication
+#define CALIBRATION_ROWS 64
+#define CALIBRATION_SIZE 512
+
+// platform the host looks for and whether it compiles device.cl at runtime instead of loading device.aocx,
+// both can be changed with -platform= and -source, the portable build sets them for CPU runtimes
+#ifndef DEFAULT_PLATFORM
+#define DEFAULT_PLATFORM "Intel"
+#endif
+#ifndef BUILD_FROM_SOURCE
+#define BUILD_FROM_SOURCE 0
+#endif
 
 double doubleInput = 1.0;
 
@@ -29,10 +57,21 @@ static cl_platform_id platform = NULL;
 static cl_device_id device = NULL;
 static cl_context context = NULL;
 static cl_command_queue queue = NULL;
+static std::vector<cl_device_id> gemmDevices;       // all devices in context, device is the first one
+static std::vector<cl_command_queue> gemmQueues;    // one queue per device, queue is the first one
+static std::vector<double> deviceThroughput;        // relative speed of every device, measured once by runGemm
+static bool throughputMeasured = false;
+static host_buffer_pool *hostPool = NULL;           // zero copy buffers of -zerocopy and -serve, reused between requests
 static cl_kernel doubleToPositKernel = NULL;
 static cl_kernel positToDoubleKernel = NULL;
 static cl_kernel computationKernel = NULL;
 
+// feeder kernels and their queues, only used by the systolic variant
+static cl_kernel feedAKernel = NULL;
+static cl_kernel feedBKernel = NULL;
+static cl_command_queue feedAQueue = NULL;
+static cl_command_queue feedBQueue = NULL;
+
 static cl_program program = NULL;
 static cl_mem output_buf1;
 static cl_mem output_buf2;
@@ -40,10 +79,99 @@ static cl_mem output_buf2;
 static cl_mem input_buf;  // num_devices elements
 static cl_mem output_buf; // num_devices elements
 
-typedef char _posit8;
+// streaming mode: separate queues for transfers and ping-pong buffers, so that writing
+// job i+1, computing job i and reading job i-1 can overlap
+static cl_command_queue writeQueue = NULL;
+static cl_command_queue readQueue = NULL;
+static cl_mem stream_input_buf[2] = {NULL, NULL};
+static cl_mem stream_output_buf[2] = {NULL, NULL};
+
+typedef posit8 _posit8;
+
+static cl_kernel gemmKernel = NULL;           // matrix_mult_general, matrix_mult_general_positn with -posit
+                                              // or matrix_mult_general_fused with an epilogue or -mlp
+static cl_kernel batchedKernel = NULL;        // matrix_mult_batched
+static cl_kernel batchedOffsetsKernel = NULL; // matrix_mult_batched_offsets
+static cl_kernel decodeKernel = NULL;         // decode_posit8_blocks with -compress
 
 unsigned int N = 4; // problem size
 unsigned NUM_ITERATIONS = 1;
+unsigned NUM_STREAM_JOBS = 0; // number of independent jobs in streaming mode, 0 runs a single job
+bool runGemmMode = false;     // run a single rectangular multiplication described by gemm
+gemm_params gemm;
+bool genericPosit = false; // -gemm multiplies posit<positNbits, positEs> instead of posit8 (-posit)
+int positNbits = 8;
+int positEs = 0;
+bool fusedEpilogue = false; // -gemm applies the epilogue (-bias, -scale, -activation) in the kernel
+bool gemmBias = false;      // random bias per column of C
+double gemmScale = 1.0;
+int gemmActivation = POSIT8_ACTIVATION_NONE;
+bool mlpMode = false;     // run a batch of N input vectors through mlpModel (-mlp)
+mlp_model mlpModel;
+std::string mlpSaveFile; // -save-mlp writes the model, empty for none
+unsigned BATCH_COUNT = 0;  // number of independent products in batched mode, 0 disables it
+bool batchOffsets = false; // batched mode uses an offset table instead of fixed strides
+std::string platformName = DEFAULT_PLATFORM;
+bool buildFromSource = BUILD_FROM_SOURCE;
+std::string sourceFile = "../device/device.cl"; // relative to the directory of the executable
+std::string libraryDir = "../..";                // directory of posit8.h, included by device.cl
+bool cpuBackend = false;  // multiply with cpuGemmPosit8, set by -cpu or if there is no OpenCL device
+unsigned NUM_THREADS = 0; // threads of the CPU backend, 0 uses all cores
+unsigned MAX_DEVICES = 0; // -gemm shards over at most this many devices of the platform, 0 uses all
+bool zeroCopy = false;    // -gemm on a single device fills and reads pooled host buffers instead of copying
+bool compressData = false; // -gemm sends B as a posit8_codec.h stream, -save-mlp writes compressed weights
+std::string serviceSocket; // -serve answers GEMM requests on this socket until SIGINT or SIGTERM
+std::string clientSocket;  // -client sends the -gemm multiplication to the service on this socket
+std::string tensorFiles[3];        // -a, -b and -c, empty for random inputs and no output file
+static mapped_tensor gemmTensors[3]; // A and B read from and C written to the tensor files, data is NULL if unused
+static unsigned gemmOutputDims[2];    // stored dimensions of C in the file of -c
+
+enum KernelVariant
+{
+    NAIVE,    // matrix_mult
+    TILED,    // matrix_mult_tiled
+    SYSTOLIC  // systolic_feed_a, systolic_feed_b and matrix_mult_systolic
+};
+KernelVariant kernelVariant = NAIVE;
+
+// benchmark sweep, every combination of the lists is measured (see runBenchmark)
+bool benchMode = false;
+std::vector<std::string> benchVariants;
+std::vector<unsigned> benchSizes;
+std::vector<unsigned> benchBatches;
+std::vector<unsigned> benchIterations;
+unsigned BENCH_RUNS = 10;    // measured runs per configuration, after one warm up run
+bool benchJson = false;      // JSON instead of CSV
+std::string benchOutputFile; // stdout if empty
+
+// measurements of one benchmark configuration, times are means over all runs in ms
+typedef struct bench_result
+{
+    std::string variant;
+    unsigned n;
+    unsigned batch;
+    unsigned iterations;
+    unsigned runs;
+    double kernel_ms;
+    double write_ms;
+    double read_ms;
+    double e2e_p50_ms;
+    double e2e_p90_ms;
+    double e2e_p99_ms;
+    double e2e_min_ms;
+    double e2e_max_ms;
+    double bandwidth_gbs; // bytes written and read per transfer time
+    double gops;          // posit operations per kernel time
+    bool verified;        // output equals cpuGemmPosit8
+} bench_result;
+
+// arguments of matrix_mult_general_fused after the ones of matrix_mult_general
+typedef struct device_epilogue
+{
+    cl_mem bias_buf; // NULL for none
+    _posit8 scale;
+    cl_int activation;
+} device_epilogue;
 static scoped_aligned_ptr<_posit8> input;  // num_devices elements
 static scoped_aligned_ptr<_posit8> output; // num_devices elements
 _posit8 INITIAL_TEMPERATURE = 0x50;        // 01010000: 1,5
@@ -52,27 +180,89 @@ _posit8 INITIAL_TEMPERATURE = 0x50;        // 01010000: 1,5
 bool init();
 void cleanup();
 void init_problem();
-void posit8ToDouble(_posit8 p, double *d);
-int _clz(char c);
-void extractPositValues(_posit8 input, posit_values *output);
-void doubleToPosit8(double doubleInput, _posit8 *out);
+bool parseArguments(int argc, char **argv);
+void runStreaming(unsigned num_jobs);
+void runGemm(const gemm_params &params);
+void runBatched(const gemm_params &params, unsigned batch_count, bool use_offsets);
+void runCpu();
+void runMlp(const mlp_model &model, unsigned rows);
+void runService(const std::string &path);
+bool runClient(const std::string &path, const gemm_params &params);
+void runBenchmark();
+bool selectKernelVariant(KernelVariant variant);
+void enqueueBatchedGemm(cl_mem a_buf, cl_mem b_buf, cl_mem c_buf, cl_mem offsets_buf, const gemm_params &params, unsigned batch_count,
+                        cl_uint num_wait_events, const cl_event *wait_events, cl_event *kernel_event);
+void enqueueGemm(cl_command_queue gemm_queue, cl_mem a_buf, cl_mem b_buf, cl_mem c_buf, const device_epilogue *epilogue, const gemm_params &params,
+                 cl_uint num_wait_events, const cl_event *wait_events, cl_event *kernel_event);
+void enqueueMatrixMult(cl_mem a_buf, cl_mem b_buf, cl_mem out_buf, cl_uint num_wait_events, const cl_event *wait_events, cl_event *kernel_event);
 
 // Entry point.
 int main(int argc, char **argv)
 {
     cl_int status;
 
-    if (argc > 1)
+    if (!parseArguments(argc, argv))
     {
-        sscanf(argv[1], "%d", &N);
+        return -1;
     }
 
-    if (!init())
+    // the client only talks to the service, which owns the device
+    if (!clientSocket.empty())
     {
-        return -1;
+        return runClient(clientSocket, gemm) ? 0 : -1;
+    }
+
+    if (!cpuBackend && !init())
+    {
+        printf("No OpenCL device available, falling back to the CPU backend.\n");
+        cpuBackend = true;
     }
     init_problem();
 
+    if (benchMode)
+    {
+        runBenchmark();
+        cleanup();
+        return 0;
+    }
+    if (mlpMode)
+    {
+        runMlp(mlpModel, N);
+        cleanup();
+        return 0;
+    }
+    if (!serviceSocket.empty())
+    {
+        runService(serviceSocket);
+        cleanup();
+        return 0;
+    }
+    if (cpuBackend)
+    {
+        runCpu();
+        cleanup();
+        return 0;
+    }
+
+    if (NUM_STREAM_JOBS > 0)
+    {
+        runStreaming(NUM_STREAM_JOBS);
+        cleanup();
+        return 0;
+    }
+    if (BATCH_COUNT > 0)
+    {
+        runBatched(gemm, BATCH_COUNT, batchOffsets);
+        cleanup();
+        return 0;
+    }
+    if (runGemmMode)
+    {
+        runGemm(gemm);
+        cleanup();
+        return 0;
+    }
+
     cl_event write_event;
 
     status = clEnqueueWriteBuffer(queue, input_buf, CL_FALSE, 0, N * N * sizeof(_posit8), input, 0, NULL, &write_event);
@@ -84,27 +274,7 @@ int main(int argc, char **argv)
 
     for (unsigned i = 0; i < NUM_ITERATIONS; i++)
     {
-        // Set kernel arguments.
-        unsigned argi = 0;
-
-        size_t global_work_size[2];
-        global_work_size[0] = N;
-        global_work_size[1] = N;
-
-        status = clSetKernelArg(computationKernel, argi++, sizeof(cl_mem), &input_buf);
-        checkError(status, "Failed to set argument %d", argi - 1);
-
-        status = clSetKernelArg(computationKernel, argi++, sizeof(cl_mem), &input_buf);
-        checkError(status, "Failed to set argument %d", argi - 1);
-
-        status = clSetKernelArg(computationKernel, argi++, sizeof(cl_int), (void *)&N);
-        checkError(status, "Failed to set argument %d", argi - 1);
-
-        status = clSetKernelArg(computationKernel, argi++, sizeof(cl_mem), &output_buf);
-        checkError(status, "Failed to set argument %d", argi - 1);
-
-        status = clEnqueueNDRangeKernel(queue, computationKernel, 2, NULL, global_work_size, NULL, 1, &write_event, &kernel_event[i]);
-        checkError(status, "Failed to launch kernel");
+        enqueueMatrixMult(input_buf, input_buf, output_buf, 1, &write_event, &kernel_event[i]);
 
         status = clEnqueueReadBuffer(queue, output_buf, CL_FALSE, 0, N * N * sizeof(_posit8), output, 1, &kernel_event[i], &finish_event);
 
@@ -151,365 +321,2169 @@ double fRand(double fMin, double fMax)
     return fMin + f * (fMax - fMin);
 }
 
-bool init()
+// bytes per matrix element in -gemm mode, 1 for posit8 and the smallest integer that holds the -posit format
+size_t gemmElementSize()
 {
-    cl_int status;
-
-    if (!setCwdToExeDir())
-    {
-        return false;
-    }
-
-    // Get the OpenCL platform.
-    platform = findPlatform("Intel");
-    if (platform == NULL)
-    {
-        printf("ERROR: Unable to find Intel FPGA OpenCL platform.\n");
-        return false;
-    }
-    // Query the available OpenCL devices.
-    scoped_array<cl_device_id> devices;
-    cl_uint num_devices;
-
-    devices.reset(getDevices(platform, CL_DEVICE_TYPE_ALL, &num_devices));
-
-    // We'll just use the first device.
-    device = devices[0];
-
-    // Create the context.
-    context = clCreateContext(NULL, 1, &device, &oclContextCallback, NULL, &status);
-    checkError(status, "Failed to create context");
-
-    // Create the command queue.
-    queue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &status);
-    checkError(status, "Failed to create command queue");
-
-    // Create the program.
-    std::string binary_file = getBoardBinaryFile("device", device);
-    program = createProgramFromBinary(context, binary_file.c_str(), &device, 1);
-
-    // Build the program that was just created.
-    status = clBuildProgram(program, 0, NULL, "", NULL, NULL);
-    checkError(status, "Failed to build program");
-
-    // Create the kernel - name passed in here must match kernel name in the
-    // original CL file, that was compiled into an AOCX file using the AOC tool
-
-    const char *computationKernelName = "matrix_mult"; // Kernel name, as defined in the CL file
-    computationKernel = clCreateKernel(program, computationKernelName, &status);
-    checkError(status, "Failed to create computationKernel");
-
-    // Input buffers.
-    input_buf = clCreateBuffer(context, CL_MEM_READ_ONLY, N * N * sizeof(_posit8), NULL, &status);
-    checkError(status, "Failed to create buffer for input A");
-
-    // Output buffer.
-    output_buf = clCreateBuffer(context, CL_MEM_WRITE_ONLY, N * N * sizeof(_posit8), NULL, &status);
-    checkError(status, "Failed to create buffer for output");
-
-    return true;
+    return !genericPosit || positNbits <= 8 ? 1 : positNbits <= 16 ? 2 : 4;
 }
 
-void printBits(size_t const size, void const *const ptr)
+// the batched kernels address matrix i with cl_int element offsets (strides or the offset table), so
+// the last matrix of a tightly packed batch has to start below INT_MAX
+bool batchFitsOffsets(unsigned M, unsigned N, unsigned K, unsigned batch_count)
 {
-    unsigned char *b = (unsigned char *)ptr;
-    unsigned char byte;
-    int i, j;
-
-    for (i = size - 1; i >= 0; i--)
-    {
-        for (j = 7; j >= 0; j--)
-        {
-            byte = (b[i] >> j) & 1;
-            printf("%u", byte);
-        }
-    }
-    puts("");
+    unsigned long long largest = std::max((unsigned long long)M * K, std::max((unsigned long long)K * N, (unsigned long long)M * N));
+    return batch_count * largest <= INT_MAX;
 }
 
-// Initialize the data for the problem. Requires num_devices to be known.
-void init_problem()
+// fills count matrix elements of the -gemm format with random values in [0, 1)
+void fillRandomGemm(unsigned char *data, size_t count)
 {
-    // Generate input vector A and the output consisting
-    // of a total of N * N elements.
-    input.reset(N * N);
-    output.reset(N * N);
-    for (unsigned j = 0; j < N * N; ++j)
+    for (size_t i = 0; i < count; i++)
     {
-        _posit8 p;
-        doubleToPosit8(fRand(0, 1.0), &input[j]);
-        output[j] = 0;
+        if (!genericPosit)
+        {
+            doubleToPosit8(fRand(0, 1.0), &data[i]);
+            continue;
+        }
+        positn value = doubleToPositN(fRand(0, 1.0), positNbits, positEs);
+        switch (gemmElementSize())
+        {
+        case 1:
+            data[i] = value;
+            break;
+        case 2:
+            ((unsigned short *)data)[i] = value;
+            break;
+        default:
+            ((unsigned int *)data)[i] = value;
+        }
     }
 }
 
-// Free the resources allocated during initialization
-void cleanup()
+// Matrix i (0 A, 1 B, 2 C) of -gemm with size elements: the mapped tensor file if there is one,
+// otherwise owned, filled with random values for A and B.
+unsigned char *gemmMatrix(int i, size_t size, scoped_aligned_ptr<unsigned char> &owned)
 {
-    if (computationKernel)
-    {
-        clReleaseKernel(computationKernel);
-    }
-    if (input_buf)
-    {
-        clReleaseMemObject(input_buf);
-    }
-    if (output_buf)
-    {
-        clReleaseMemObject(output_buf);
-    }
-    if (program)
-    {
-        clReleaseProgram(program);
-    }
-    if (queue)
+    if (gemmTensors[i].data)
     {
-        clReleaseCommandQueue(queue);
+        return gemmTensors[i].data;
     }
-    if (context)
+    owned.reset(size * gemmElementSize());
+    if (i < 2)
     {
-        clReleaseContext(context);
+        fillRandomGemm(owned, size);
     }
+    return owned;
 }
 
-_posit8 _twosComplement(_posit8 input)
+// Whether the files at both paths exist and are the same file, e.g. through a link.
+bool sameFile(const std::string &first, const std::string &second)
 {
-    input = ~input;
-    input = input + 1;
-    return input;
+    struct stat first_info, second_info;
+    return stat(first.c_str(), &first_info) == 0 && stat(second.c_str(), &second_info) == 0 && first_info.st_dev == second_info.st_dev &&
+           first_info.st_ino == second_info.st_ino;
 }
 
-void extractPositValues(_posit8 input, posit_values *output)
+// Maps the tensor files of -a and -b and checks the one of -c, which createGemmOutput creates once the
+// multiplication runs. Without -gemm the shape comes from A and B, a matrix stored column major
+// (-layout) is a file with the dimensions swapped.
+bool mapGemmTensors(const char *layout)
 {
-    output->exp = 0x0; //allways zero by definition
-
-    if (input == 0x0)
-    {
-        output->zero = true;
-        output->inf = false;
-        output->sign = false;
-        output->k = 0;
-        output->frac = 0x0;
-        output->fracLength = 0;
-    }
-    else if (input == 0x80)
-    {
-        output->zero = false;
-        output->inf = true;
-        output->sign = true;
-        output->k = 0;
-        output->frac = 0x0;
-        output->fracLength = 0;
-    }
-    else
+    const int nbits = genericPosit ? positNbits : 8;
+    const int es = genericPosit ? positEs : 0;
+    for (int i = 0; i < 2; i++)
     {
-        output->sign = input >> 7;
-        // if negative make two's complement
-        if (output->sign)
+        if (tensorFiles[i].empty())
         {
-            input = _twosComplement(input);
+            continue;
         }
-
-        // regime bits consisting of zeros
-        int regime_bits = _clz(input << 1);
-        output->k = -1 * regime_bits;
-
-        if (regime_bits == 0)
+        if (!mapTensorFile(tensorFiles[i].c_str(), gemmTensors[i]))
         {
-            // regime bits consisting of ones
-            unsigned char temp = ~(input << 1); // make bitshift before inverting for all-1-case
-            regime_bits = _clz(temp);
-            output->k = regime_bits - 1;
+            return false;
         }
-
-        // flush sign and regime
-        if (regime_bits < 7)
+        const tensor_header &header = gemmTensors[i].header;
+        if (header.rank != 2 || header.nbits != nbits || header.es != es)
         {
-            output->fracLength = 8 - (regime_bits + 2); //mask all the regime bits (regime_bits + 1) + the sign bit (1)
+            printf("ERROR: %s has to be a matrix of posit<%d,%d>.\n", tensorFiles[i].c_str(), nbits, es);
+            return false;
         }
-        else
+    }
+
+    if (!runGemmMode)
+    {
+        const unsigned *a_dims = gemmTensors[0].header.dims;
+        const unsigned *b_dims = gemmTensors[1].header.dims;
+        gemm.M = layout[0] == 'c' ? a_dims[1] : a_dims[0];
+        gemm.K = layout[0] == 'c' ? a_dims[0] : a_dims[1];
+        gemm.N = layout[1] == 'c' ? b_dims[0] : b_dims[1];
+        runGemmMode = true;
+    }
+
+    // stored dimensions of A, B and C
+    unsigned dims[3][2] = {{gemm.M, gemm.K}, {gemm.K, gemm.N}, {gemm.M, gemm.N}};
+    for (int i = 0; i < 3; i++)
+    {
+        if (layout[i] == 'c')
         {
-            output->fracLength = 0;
+            std::swap(dims[i][0], dims[i][1]);
         }
-        if (output->fracLength > 0)
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        const unsigned *file_dims = gemmTensors[i].header.dims;
+        if (gemmTensors[i].data && (file_dims[0] != dims[i][0] || file_dims[1] != dims[i][1]))
         {
-            unsigned char mask = ((1 << output->fracLength) - 1);
-            output->frac = input & mask;
+            printf("ERROR: %s is a %ux%u matrix, the multiplication needs %ux%u.\n", tensorFiles[i].c_str(), file_dims[0], file_dims[1], dims[i][0],
+                   dims[i][1]);
+            return false;
         }
-        else
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        if (!tensorFiles[2].empty() && !tensorFiles[i].empty() && sameFile(tensorFiles[2], tensorFiles[i]))
         {
-            output->frac = 0x0;
+            printf("ERROR: -c can not overwrite the input %s.\n", tensorFiles[i].c_str());
+            return false;
         }
     }
+    gemmOutputDims[0] = dims[2][0];
+    gemmOutputDims[1] = dims[2][1];
+    return true;
 }
 
-void posit8ToDouble(_posit8 posit, double *output)
+// Creates the tensor file of -c for the result, it replaces the file at the path when finishGemmOutput
+// succeeds, so a failed run leaves an existing file alone.
+bool createGemmOutput()
 {
-    posit_values pval;
-    extractPositValues(posit, &pval);
-    double fraction_max = pow(2, pval.fracLength);
-    double fracVal = 1 + ((double)pval.frac / fraction_max);
-    if (posit == 0x0)
-    {
-        *output = 0;
-    }
-    else
-    {
-        *output = pow(-1, pval.sign) * pow(2, pval.k) * fracVal;
-    }
+    const int nbits = genericPosit ? positNbits : 8;
+    const int es = genericPosit ? positEs : 0;
+    return tensorFiles[2].empty() || createTensorFile(tensorFiles[2].c_str(), nbits, es, 2, gemmOutputDims, gemmTensors[2]);
 }
 
-int _clz(char c)
+bool finishGemmOutput()
 {
-    unsigned int n = 0;
-    if (c == 0)
-        return 8;
-
-    if ((c & 0xF0) == 0)
-    {
-        n = n + 4;
-        c = c << 4;
-    }
-    if ((c & 0xC0) == 0)
-    {
-        n = n + 2;
-        c = c << 2;
-    }
-    if ((c & 0x80) == 0)
-    {
-        n = n + 1;
-    }
-    return n;
+    return tensorFiles[2].empty() || finishTensorFile(gemmTensors[2]);
 }
 
-char convertFraction(double doubleFraction, unsigned int fracLength)
+// Splits a comma separated list.
+std::vector<std::string> splitList(const char *text)
 {
-    char _positFraction = 0x0;
-    unsigned int _fracCounter = fracLength;
-    double _temp = 1;
-    while (_fracCounter > 0)
+    std::vector<std::string> items;
+    std::string item;
+    for (const char *c = text;; c++)
     {
-        _temp /= 2;
-
-        if (doubleFraction >= _temp)
+        if (*c == ',' || *c == '\0')
         {
-            // shift in 1
-            _positFraction = (_positFraction << 1) + 1;
-            doubleFraction -= _temp;
+            if (!item.empty())
+            {
+                items.push_back(item);
+            }
+            item.clear();
+            if (*c == '\0')
+            {
+                break;
+            }
         }
         else
         {
-            // shift in 0
-            _positFraction = _positFraction << 1;
+            item += *c;
         }
-        _fracCounter--;
     }
-    return _positFraction;
+    return items;
 }
 
-void doubleToPosit8(double doubleInput, _posit8 *out)
+// Parses a comma separated list of positive numbers, e.g. 64,128,256.
+bool parseUnsignedList(const char *text, std::vector<unsigned> &values)
 {
-    char output = 0x0;
-    unsigned int sign;
-    unsigned int _regimeLength;
-    double _tempDoubleInput;
-    unsigned int _regimeIsOnes;
-    // extract sign
-    (doubleInput >= 0) ? (sign = 0) : (sign = 1);
-
-    if (doubleInput == 0)
-    {
-        // check for zero
-        output = 0;
-    }
-    else if (isinf(doubleInput) || isnan(doubleInput))
-    {
-        // check for infinity
-        output = 0x80;
-    }
-    else if (doubleInput >= 64)
-    {
-        // check for maxpos
-        output = 0x7F;
-    }
-    else if (doubleInput <= -64)
-    {
-        // check for minpos
-        output = 0x81;
-    }
-    else if (doubleInput <= 0.015625 && !sign)
-    {
-        // check for +minpos
-        output = 0x1;
-    }
-    else if (doubleInput >= -0.015625 && sign)
-    {
-        // check for -minpos
-        output = 0xFF;
-    }
-    else
+    std::vector<std::string> items = splitList(text);
+    values.clear();
+    for (size_t i = 0; i < items.size(); i++)
     {
-        if (sign)
+        unsigned value;
+        char rest;
+        if (sscanf(items[i].c_str(), "%u%c", &value, &rest) != 1 || value == 0)
         {
-            // Make negative numbers positive for easier computation
-            doubleInput = -doubleInput;
+            return false;
         }
+        values.push_back(value);
+    }
+    return !values.empty();
+}
 
-        _tempDoubleInput = doubleInput;
-
-        // check if regime is composed of ones
-        if (doubleInput > 1 || doubleInput < -1)
+// Usage: host [N] [naive|tiled|systolic] [-stream=<jobs>] [-gemm=<M>x<N>x<K> [-layout=<abc>] [-posit=<nbits>,<es>]
+//                                                       [-bias] [-scale=<value>] [-activation=none|relu|sigmoid] [-zerocopy] [-compress]
+//                                                       [-a=<file>] [-b=<file>] [-c=<file>]]
+//             [-batch=<count> [-offsets]] [-mlp=<file>|<n0>,<n1>,... [-save-mlp=<file> [-compress]]] [-serve=<socket>] [-client=<socket>]
+//             [-platform=<name>] [-devices=<n>] [-source[=<device.cl>]] [-cpu [-threads=<n>]]
+//             [-bench [-variants=<list>] [-sizes=<list>] [-batches=<list>] [-iterations=<list>] [-runs=<n>]
+//                     [-format=csv|json] [-out=<file>]]
+// -platform selects the first OpenCL platform whose name contains name, -platform= takes the first one.
+// -devices limits the devices of the platform that -gemm splits its rows over (default all).
+// -zerocopy makes -gemm on a single device (e.g. -devices=1) generate its inputs in device visible host
+// buffers and read C from there instead of copying them (see host_buffer_pool), shards are copied.
+// -source compiles the kernels from source at runtime, so any OpenCL runtime (e.g. PoCL) can run them.
+// -cpu runs all modes on the host, which also happens automatically if no OpenCL device is found.
+// -bench sweeps all combinations of the comma separated lists, variants are naive, tiled, systolic,
+// batched and cpu (default naive,tiled,batched,cpu), see runBenchmark for the reported values.
+// -layout gives the storage order of A, B and C, r for row major and c for column major (default rrr).
+// -posit multiplies posit<nbits, es> matrices (3 <= nbits <= 32, es <= 4) with matrix_mult_general_positn,
+// an offline compiled device.aocx has to be built with the same -DPOSIT_NBITS=<nbits> -DPOSIT_ES=<es>.
+// -bias, -scale and -activation fuse activation((A * B + bias) * scale) into the posit8 -gemm kernel
+// (matrix_mult_general_fused), -bias adds a random value per column of C.
+// -batch multiplies count independent row major matrices of the -gemm shape (N x N x N without -gemm)
+// in one launch, -offsets addresses them through an offset table instead of fixed strides.
+// -mlp runs N random input vectors through a posit8 MLP (see mlp.h) loaded from file, or through a
+// random one with the given layer widths, one matrix_mult_general_fused launch per layer.
+// -save-mlp writes the model, e.g. to keep a random one, with -compress the weights are stored as
+// posit8_codec.h streams.
+// -compress sends B of a posit8 -gemm as a posit8_codec.h stream, decode_posit8_blocks expands it on the device.
+// -serve sets up the device once and multiplies posit8 matrices for clients on the local socket until
+// SIGINT or SIGTERM (see gemm_service.h), -client sends the random -gemm matrices to such a service,
+// checks C against cpuGemmPosit8 and prints the round trip time.
+// -a and -b read A and B of -gemm from tensor files (see tensor_file.h) instead of generating them,
+// with both the shape can be left out, -c writes C to a tensor file. The files are mapped, so the
+// transfers to the devices read the pages straight from the page cache.
+bool parseArguments(int argc, char **argv)
+{
+    unsigned positional = 0;
+    char layout[4] = "rrr";
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-')
         {
-            _regimeIsOnes = 1;
-            _regimeLength = 1; // because k = m - 1 we need to add one
-            while (_tempDoubleInput >= 2)
+            if (sscanf(argv[i], "-gemm=%ux%ux%u", &gemm.M, &gemm.N, &gemm.K) == 3)
+            {
+                if (gemm.M == 0 || gemm.N == 0 || gemm.K == 0)
+                {
+                    printf("ERROR: -gemm needs M, N and K of at least 1.\n");
+                    return false;
+                }
+                runGemmMode = true;
+            }
+            else if (strncmp(argv[i], "-layout=", 8) == 0)
+            {
+                if (strlen(argv[i]) != 11 || strspn(argv[i] + 8, "rc") != 3)
+                {
+                    printf("ERROR: -layout takes three characters, r for row major and c for column major.\n");
+                    return false;
+                }
+                strcpy(layout, argv[i] + 8);
+            }
+            else if (sscanf(argv[i], "-posit=%d,%d", &positNbits, &positEs) == 2)
+            {
+                genericPosit = true;
+            }
+            else if (strcmp(argv[i], "-bias") == 0)
+            {
+                gemmBias = fusedEpilogue = true;
+            }
+            else if (sscanf(argv[i], "-scale=%lf", &gemmScale) == 1)
+            {
+                fusedEpilogue = true;
+            }
+            else if (strncmp(argv[i], "-activation=", 12) == 0)
+            {
+                const char *activation = argv[i] + 12;
+                if (strcmp(activation, "relu") == 0)
+                {
+                    gemmActivation = POSIT8_ACTIVATION_RELU;
+                }
+                else if (strcmp(activation, "sigmoid") == 0)
+                {
+                    gemmActivation = POSIT8_ACTIVATION_SIGMOID;
+                }
+                else if (strcmp(activation, "none") != 0)
+                {
+                    printf("ERROR: Unknown activation %s, use none, relu or sigmoid.\n", activation);
+                    return false;
+                }
+                fusedEpilogue = true;
+            }
+            else if (strncmp(argv[i], "-mlp=", 5) == 0)
+            {
+                // a list of layer widths builds a random model, anything else is a model file
+                std::vector<unsigned> sizes;
+                if (parseUnsignedList(argv[i] + 5, sizes))
+                {
+                    if (sizes.size() < 2)
+                    {
+                        printf("ERROR: -mlp needs at least two layer widths.\n");
+                        return false;
+                    }
+                    randomMlp(sizes, mlpModel);
+                }
+                else if (!loadMlp(argv[i] + 5, mlpModel))
+                {
+                    return false;
+                }
+                mlpMode = true;
+            }
+            else if (strncmp(argv[i], "-save-mlp=", 10) == 0)
+            {
+                mlpSaveFile = argv[i] + 10;
+            }
+            else if (strncmp(argv[i], "-serve=", 7) == 0)
+            {
+                serviceSocket = argv[i] + 7;
+            }
+            else if (strncmp(argv[i], "-client=", 8) == 0)
+            {
+                clientSocket = argv[i] + 8;
+            }
+            else if (argv[i][1] >= 'a' && argv[i][1] <= 'c' && argv[i][2] == '=')
+            {
+                tensorFiles[argv[i][1] - 'a'] = argv[i] + 3;
+            }
+            else if (strcmp(argv[i], "-compress") == 0)
+            {
+                compressData = true;
+            }
+            else if (strcmp(argv[i], "-zerocopy") == 0)
+            {
+                zeroCopy = true;
+            }
+            else if (strcmp(argv[i], "-offsets") == 0)
+            {
+                batchOffsets = true;
+            }
+            else if (strcmp(argv[i], "-cpu") == 0)
+            {
+                cpuBackend = true;
+            }
+            else if (strcmp(argv[i], "-bench") == 0)
+            {
+                benchMode = true;
+            }
+            else if (strncmp(argv[i], "-variants=", 10) == 0)
+            {
+                benchVariants = splitList(argv[i] + 10);
+            }
+            else if (strncmp(argv[i], "-sizes=", 7) == 0 || strncmp(argv[i], "-batches=", 9) == 0 ||
+                     strncmp(argv[i], "-iterations=", 12) == 0)
+            {
+                std::vector<unsigned> &list = argv[i][1] == 's' ? benchSizes : argv[i][1] == 'b' ? benchBatches : benchIterations;
+                if (!parseUnsignedList(strchr(argv[i], '=') + 1, list))
+                {
+                    printf("ERROR: Invalid list in %s.\n", argv[i]);
+                    return false;
+                }
+            }
+            else if (strcmp(argv[i], "-format=json") == 0 || strcmp(argv[i], "-format=csv") == 0)
+            {
+                benchJson = strcmp(argv[i], "-format=json") == 0;
+            }
+            else if (strncmp(argv[i], "-out=", 5) == 0)
+            {
+                benchOutputFile = argv[i] + 5;
+            }
+            else if (strncmp(argv[i], "-platform=", 10) == 0)
+            {
+                platformName = argv[i] + 10;
+            }
+            else if (strcmp(argv[i], "-source") == 0)
+            {
+                buildFromSource = true;
+            }
+            else if (strncmp(argv[i], "-source=", 8) == 0)
             {
-                _tempDoubleInput /= 2;
-                _regimeLength++;
+                buildFromSource = true;
+                sourceFile = argv[i] + 8;
             }
-            if (_regimeLength > 6)
+            else if (sscanf(argv[i], "-stream=%u", &NUM_STREAM_JOBS) != 1 && sscanf(argv[i], "-batch=%u", &BATCH_COUNT) != 1 &&
+                     sscanf(argv[i], "-threads=%u", &NUM_THREADS) != 1 && sscanf(argv[i], "-devices=%u", &MAX_DEVICES) != 1 &&
+                     sscanf(argv[i], "-runs=%u", &BENCH_RUNS) != 1)
             {
-                output = 0x7F;
-                *out = output;
-                return;
+                printf("ERROR: Unknown option %s.\n", argv[i]);
+                return false;
             }
         }
-        // regime is composed of zeros
-        else
+        else if (positional == 0)
+        {
+            sscanf(argv[i], "%u", &N);
+            positional++;
+        }
+        else if (positional == 1)
         {
-            _regimeIsOnes = 0;
-            _regimeLength = 0; // because k = m
-            while (_tempDoubleInput < 1)
+            // kernel variant: "naive" (default), "tiled" or "systolic"
+            if (strcmp(argv[i], "tiled") == 0)
             {
-                _tempDoubleInput *= 2;
-                _regimeLength++;
+                kernelVariant = TILED;
             }
-
-            if (_regimeLength > 6)
+            else if (strcmp(argv[i], "systolic") == 0)
+            {
+                kernelVariant = SYSTOLIC;
+            }
+            else if (strcmp(argv[i], "naive") != 0)
             {
-                output = 0x1;
-                *out = output;
-                return;
+                printf("ERROR: Unknown kernel variant %s, use naive, tiled or systolic.\n", argv[i]);
+                return false;
             }
+            positional++;
         }
+    }
 
-        double _doubleFraction = _tempDoubleInput - 1; // remove hidden bit (1.0101010)
-        unsigned int _fracLength = 6 - _regimeLength;
-        char _positFraction = convertFraction(_doubleFraction, _fracLength);
-
-        output = 0x0;
-
-        for (int i = 0; i < _regimeLength; i++)
+    if (benchMode)
+    {
+        // the sweep replaces every other mode, so their options would be ignored
+        bool tensors = !tensorFiles[0].empty() || !tensorFiles[1].empty() || !tensorFiles[2].empty();
+        if (runGemmMode || genericPosit || fusedEpilogue || mlpMode || !mlpSaveFile.empty() || BATCH_COUNT > 0 || batchOffsets ||
+            NUM_STREAM_JOBS > 0 || zeroCopy || compressData || tensors || !serviceSocket.empty() || !clientSocket.empty())
         {
-            output = (output << 1) + _regimeIsOnes;
+            printf("ERROR: -bench can not be combined with other modes or their options.\n");
+            return false;
         }
-        output = (output << 1) + !_regimeIsOnes;
-        output = (output << _fracLength);
-        output |= _positFraction;
-
-        if (sign)
+        const char *default_variants[] = {"naive", "tiled", "batched", "cpu"};
+        if (benchVariants.empty())
+        {
+            benchVariants.assign(default_variants, default_variants + 4);
+        }
+        for (size_t i = 0; i < benchVariants.size(); i++)
+        {
+            const std::string &v = benchVariants[i];
+            if (v != "naive" && v != "tiled" && v != "systolic" && v != "batched" && v != "cpu")
+            {
+                printf("ERROR: Unknown benchmark variant %s.\n", v.c_str());
+                return false;
+            }
+        }
+        if (benchSizes.empty())
+        {
+            benchSizes.push_back(N);
+        }
+        if (benchBatches.empty())
+        {
+            benchBatches.push_back(16);
+        }
+        if (benchIterations.empty())
+        {
+            benchIterations.push_back(NUM_ITERATIONS);
+        }
+        if (BENCH_RUNS == 0)
         {
-            output = _twosComplement(output);
+            BENCH_RUNS = 1;
         }
+        // the sweep checks the size of every variant itself
+        return true;
+    }
+
+    if (!tensorFiles[0].empty() || !tensorFiles[1].empty() || !tensorFiles[2].empty())
+    {
+        if (!runGemmMode && (tensorFiles[0].empty() || tensorFiles[1].empty()))
+        {
+            printf("ERROR: -a, -b and -c need a -gemm shape unless -a and -b are both given.\n");
+            return false;
+        }
+        if (mlpMode || zeroCopy || BATCH_COUNT > 0 || NUM_STREAM_JOBS > 0 || !serviceSocket.empty() || !clientSocket.empty())
+        {
+            printf("ERROR: -a, -b and -c only work with -gemm (without -zerocopy).\n");
+            return false;
+        }
+        if (!mapGemmTensors(layout))
+        {
+            return false;
+        }
+    }
+
+    if (genericPosit)
+    {
+        if (positNbits < 3 || positNbits > 32 || positEs < 0 || positEs > 4)
+        {
+            printf("ERROR: Unsupported format posit<%d,%d>, nbits has to be in 3..32 and es in 0..4.\n", positNbits, positEs);
+            return false;
+        }
+        if (!runGemmMode || BATCH_COUNT > 0 || NUM_STREAM_JOBS > 0)
+        {
+            printf("ERROR: -posit only works with -gemm.\n");
+            return false;
+        }
+    }
+
+    if (!serviceSocket.empty() && (runGemmMode || mlpMode || BATCH_COUNT > 0 || NUM_STREAM_JOBS > 0 || genericPosit || fusedEpilogue))
+    {
+        printf("ERROR: -serve takes the shape of every multiplication from the requests, it can not be combined with other modes.\n");
+        return false;
+    }
+    if (!clientSocket.empty() && (!runGemmMode || genericPosit || fusedEpilogue || zeroCopy || BATCH_COUNT > 0 || NUM_STREAM_JOBS > 0))
+    {
+        printf("ERROR: -client needs a posit8 -gemm shape and no other mode.\n");
+        return false;
+    }
+
+    if (compressData && !((runGemmMode && !genericPosit && !zeroCopy && BATCH_COUNT == 0 && NUM_STREAM_JOBS == 0) || !mlpSaveFile.empty()))
+    {
+        printf("ERROR: -compress only works with posit8 -gemm (without -zerocopy) or -save-mlp.\n");
+        return false;
+    }
+
+    if (zeroCopy && (!runGemmMode || BATCH_COUNT > 0 || NUM_STREAM_JOBS > 0))
+    {
+        printf("ERROR: -zerocopy only works with -gemm.\n");
+        return false;
+    }
+
+    if (fusedEpilogue && (!runGemmMode || genericPosit || BATCH_COUNT > 0 || NUM_STREAM_JOBS > 0))
+    {
+        printf("ERROR: -bias, -scale and -activation only work with posit8 -gemm.\n");
+        return false;
+    }
+
+    if (mlpMode)
+    {
+        if (runGemmMode || BATCH_COUNT > 0 || NUM_STREAM_JOBS > 0)
+        {
+            printf("ERROR: -mlp can not be combined with -gemm, -batch or -stream.\n");
+            return false;
+        }
+        if (!mlpSaveFile.empty() && !saveMlp(mlpSaveFile, mlpModel, compressData))
+        {
+            return false;
+        }
+    }
+    else if (!mlpSaveFile.empty())
+    {
+        printf("ERROR: -save-mlp only works with -mlp.\n");
+        return false;
+    }
+
+    if (BATCH_COUNT > 0)
+    {
+        // the batched kernels only take row major matrices
+        if (strcmp(layout, "rrr") != 0)
+        {
+            printf("ERROR: -batch only works with row major matrices (-layout=rrr).\n");
+            return false;
+        }
+        if (!runGemmMode)
+        {
+            gemm.M = gemm.N = gemm.K = N;
+        }
+        if (!batchFitsOffsets(gemm.M, gemm.N, gemm.K, BATCH_COUNT))
+        {
+            printf("ERROR: -batch=%u of %ux%ux%u needs more than %d elements per matrix array.\n", BATCH_COUNT, gemm.M, gemm.N, gemm.K, INT_MAX);
+            return false;
+        }
+    }
+    if (runGemmMode || BATCH_COUNT > 0)
+    {
+        // tightly packed matrices, the leading dimension is the length of a row or column
+        gemm.a_col_major = layout[0] == 'c';
+        gemm.b_col_major = layout[1] == 'c';
+        gemm.c_col_major = layout[2] == 'c';
+        gemm.lda = gemm.a_col_major ? gemm.M : gemm.K;
+        gemm.ldb = gemm.b_col_major ? gemm.K : gemm.N;
+        gemm.ldc = gemm.c_col_major ? gemm.M : gemm.N;
+    }
+
+    if (kernelVariant == TILED && N % BLOCK_SIZE != 0)
+    {
+        printf("ERROR: N has to be a multiple of %d for the tiled kernel.\n", BLOCK_SIZE);
+        return false;
+    }
+    if (kernelVariant == SYSTOLIC && (N % SYSTOLIC_ROWS != 0 || N % SYSTOLIC_COLS != 0))
+    {
+        printf("ERROR: N has to be a multiple of %d and %d for the systolic kernel.\n", SYSTOLIC_ROWS, SYSTOLIC_COLS);
+        return false;
+    }
+    return true;
+}
+
+// Run num_jobs independent multiplications as a pipeline. The input of job i+1 is written on
+// writeQueue while job i runs on queue and the result of job i-1 is read on readQueue; jobs
+// alternate between two sets of buffers and events keep a buffer from being reused too early.
+void runStreaming(unsigned num_jobs)
+{
+    cl_int status;
+    const size_t matrix_size = N * N * sizeof(_posit8);
+
+    // every job gets its own input, the results of all jobs are kept
+    scoped_aligned_ptr<_posit8> job_inputs;
+    scoped_aligned_ptr<_posit8> job_outputs;
+    job_inputs.reset(num_jobs * N * N);
+    job_outputs.reset(num_jobs * N * N);
+    for (unsigned j = 0; j < num_jobs * N * N; ++j)
+    {
+        doubleToPosit8(fRand(0, 1.0), &job_inputs[j]);
+    }
+
+    scoped_aligned_ptr<cl_event> write_event;
+    scoped_aligned_ptr<cl_event> kernel_event;
+    scoped_aligned_ptr<cl_event> read_event;
+    write_event.reset(num_jobs);
+    kernel_event.reset(num_jobs);
+    read_event.reset(num_jobs);
+
+    const double start_time = getCurrentTimestamp();
+
+    for (unsigned i = 0; i < num_jobs; i++)
+    {
+        unsigned slot = i % 2;
+
+        // the input buffer is free again once the kernel of job i-2 is done
+        status = clEnqueueWriteBuffer(writeQueue, stream_input_buf[slot], CL_FALSE, 0, matrix_size, &job_inputs[i * N * N],
+                                      i >= 2 ? 1 : 0, i >= 2 ? &kernel_event[i - 2] : NULL, &write_event[i]);
+        checkError(status, "Failed to transfer input of job %u", i);
+
+        // the output buffer is free again once the result of job i-2 has been read
+        cl_event wait_events[2];
+        cl_uint num_wait_events = 0;
+        wait_events[num_wait_events++] = write_event[i];
+        if (i >= 2)
+        {
+            wait_events[num_wait_events++] = read_event[i - 2];
+        }
+        enqueueMatrixMult(stream_input_buf[slot], stream_input_buf[slot], stream_output_buf[slot], num_wait_events, wait_events, &kernel_event[i]);
+
+        status = clEnqueueReadBuffer(readQueue, stream_output_buf[slot], CL_FALSE, 0, matrix_size, &job_outputs[i * N * N], 1, &kernel_event[i], &read_event[i]);
+        checkError(status, "Failed to read output of job %u", i);
+
+        // start the transfers right away instead of at the next flush
+        clFlush(writeQueue);
+        clFlush(queue);
+        clFlush(readQueue);
+    }
+
+    clWaitForEvents(1, &read_event[num_jobs - 1]);
+    clFinish(readQueue);
+    const double end_time = getCurrentTimestamp();
+
+    cl_ulong kernel_ns = 0;
+    for (unsigned i = 0; i < num_jobs; i++)
+    {
+        kernel_ns += getStartEndTime(kernel_event[i]);
+        clReleaseEvent(write_event[i]);
+        clReleaseEvent(kernel_event[i]);
+        clReleaseEvent(read_event[i]);
+    }
+
+    // end-to-end time includes all transfers, kernel time only the sum of the kernel executions
+    double seconds = end_time - start_time;
+    double operations = 2 * pow(N, 3) * num_jobs;
+    double gflops = (operations / seconds) * 1.0e-9;
+    printf("%lf,%lf,%lf\n", seconds, gflops, double(kernel_ns) * 1e-9);
+}
+
+
+bool init()
+{
+    cl_int status;
+
+    if (!setCwdToExeDir())
+    {
+        return false;
+    }
+
+    // Get the OpenCL platform.
+    platform = findPlatform(platformName.c_str());
+    if (platform == NULL)
+    {
+        printf("ERROR: Unable to find OpenCL platform matching \"%s\".\n", platformName.c_str());
+        return false;
+    }
+    // Query the available OpenCL devices.
+    scoped_array<cl_device_id> devices;
+    cl_uint num_devices;
+
+    devices.reset(getDevices(platform, CL_DEVICE_TYPE_ALL, &num_devices));
+
+    if (num_devices == 0)
+    {
+        printf("ERROR: No OpenCL device found on platform %s.\n", getPlatformName(platform).c_str());
+        return false;
+    }
+
+    // One context for all devices (at most MAX_DEVICES), -gemm shards over them and every other
+    // mode runs on the first one.
+    if (MAX_DEVICES > 0 && num_devices > MAX_DEVICES)
+    {
+        num_devices = MAX_DEVICES;
+    }
+    gemmDevices.assign(devices.get(), devices.get() + num_devices);
+    device = gemmDevices[0];
+
+    // the offline compiled device.aocx or device.cl, without the kernels main falls back to the CPU backend
+    std::string program_file = buildFromSource ? sourceFile : getBoardBinaryFile("device", device);
+    if (program_file.empty())
+    {
+        return false;
+    }
+    if (!fileExists(program_file.c_str()))
+    {
+        printf("ERROR: Unable to find %s.\n", program_file.c_str());
+        return false;
+    }
+
+    // Create the context.
+    context = clCreateContext(NULL, num_devices, gemmDevices.data(), &oclContextCallback, NULL, &status);
+    checkError(status, "Failed to create context");
+
+    // Create the command queues.
+    for (cl_uint i = 0; i < num_devices; i++)
+    {
+        gemmQueues.push_back(clCreateCommandQueue(context, gemmDevices[i], CL_QUEUE_PROFILING_ENABLE, &status));
+        checkError(status, "Failed to create command queue for device %u", i);
+    }
+    queue = gemmQueues[0];
+    deviceThroughput.assign(num_devices, 1.0);
+
+    // Create the program, either from the offline compiled device.aocx or from device.cl
+    // with the same compile time parameters as the host.
+    char build_options[STRING_BUFFER_LEN] = "";
+    if (buildFromSource)
+    {
+        program = createProgramFromSource(context, program_file.c_str());
+        snprintf(build_options, sizeof(build_options), "-I%s -DBLOCK_SIZE=%d -DSYSTOLIC_ROWS=%d -DSYSTOLIC_COLS=%d",
+                 libraryDir.c_str(), BLOCK_SIZE, SYSTOLIC_ROWS, SYSTOLIC_COLS);
+        if (genericPosit)
+        {
+            size_t length = strlen(build_options);
+            snprintf(build_options + length, sizeof(build_options) - length, " -DPOSIT_NBITS=%d -DPOSIT_ES=%d", positNbits, positEs);
+        }
+    }
+    else
+    {
+        program = createProgramFromBinary(context, program_file.c_str(), gemmDevices.data(), num_devices);
+    }
+
+    // Build the program that was just created.
+    status = buildProgram(program, num_devices, gemmDevices.data(), build_options);
+    checkError(status, "Failed to build program");
+
+    // Create the kernel - name passed in here must match kernel name in the
+    // original CL file, that was compiled into an AOCX file using the AOC tool
+    if (!selectKernelVariant(kernelVariant))
+    {
+        checkError(CL_INVALID_KERNEL_NAME, "Failed to create computationKernel");
+    }
+
+    if (runGemmMode || mlpMode || !serviceSocket.empty())
+    {
+        const char *name = genericPosit ? "matrix_mult_general_positn"
+                           : fusedEpilogue || mlpMode ? "matrix_mult_general_fused"
+                                                      : "matrix_mult_general";
+        gemmKernel = clCreateKernel(program, name, &status);
+        checkError(status, "Failed to create gemmKernel");
+    }
+    if (compressData && runGemmMode)
+    {
+        decodeKernel = clCreateKernel(program, "decode_posit8_blocks", &status);
+        checkError(status, "Failed to create decodeKernel");
+    }
+    if (BATCH_COUNT > 0 || benchMode)
+    {
+        batchedKernel = clCreateKernel(program, "matrix_mult_batched", &status);
+        checkError(status, "Failed to create batchedKernel");
+        batchedOffsetsKernel = clCreateKernel(program, "matrix_mult_batched_offsets", &status);
+        checkError(status, "Failed to create batchedOffsetsKernel");
+    }
+
+    // Input buffers.
+    input_buf = clCreateBuffer(context, CL_MEM_READ_ONLY, N * N * sizeof(_posit8), NULL, &status);
+    checkError(status, "Failed to create buffer for input A");
+
+    // Output buffer.
+    output_buf = clCreateBuffer(context, CL_MEM_WRITE_ONLY, N * N * sizeof(_posit8), NULL, &status);
+    checkError(status, "Failed to create buffer for output");
+
+    if (NUM_STREAM_JOBS > 0)
+    {
+        writeQueue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &status);
+        checkError(status, "Failed to create command queue");
+
+        readQueue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &status);
+        checkError(status, "Failed to create command queue");
+
+        for (unsigned i = 0; i < 2; i++)
+        {
+            stream_input_buf[i] = clCreateBuffer(context, CL_MEM_READ_ONLY, N * N * sizeof(_posit8), NULL, &status);
+            checkError(status, "Failed to create streaming input buffer");
+
+            stream_output_buf[i] = clCreateBuffer(context, CL_MEM_WRITE_ONLY, N * N * sizeof(_posit8), NULL, &status);
+            checkError(status, "Failed to create streaming output buffer");
+        }
+    }
+
+    return true;
+}
+
+// Creates computationKernel (and the feeders of the systolic array) for variant and makes it the
+// kernel of enqueueMatrixMult. Returns false if the program does not contain the kernels, e.g.
+// the systolic array on platforms without channels.
+bool selectKernelVariant(KernelVariant variant)
+{
+    cl_int status;
+
+    const char *computationKernelName = "matrix_mult"; // Kernel name, as defined in the CL file
+    if (variant == TILED)
+    {
+        computationKernelName = "matrix_mult_tiled";
+    }
+    else if (variant == SYSTOLIC)
+    {
+        computationKernelName = "matrix_mult_systolic";
+    }
+
+    cl_kernel kernel = clCreateKernel(program, computationKernelName, &status);
+    if (status != CL_SUCCESS)
+    {
+        return false;
+    }
+
+    if (variant == SYSTOLIC && feedAKernel == NULL)
+    {
+        // the feeders run concurrently with the array, so each of them needs its own queue
+        feedAKernel = clCreateKernel(program, "systolic_feed_a", &status);
+        checkError(status, "Failed to create feedAKernel");
+
+        feedBKernel = clCreateKernel(program, "systolic_feed_b", &status);
+        checkError(status, "Failed to create feedBKernel");
+
+        feedAQueue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &status);
+        checkError(status, "Failed to create command queue");
+
+        feedBQueue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &status);
+        checkError(status, "Failed to create command queue");
+    }
+
+    if (computationKernel)
+    {
+        clReleaseKernel(computationKernel);
+    }
+    computationKernel = kernel;
+    kernelVariant = variant;
+    return true;
+}
+
+// Enqueue one multiplication of the N x N matrices in a_buf and b_buf with the selected kernel variant.
+void enqueueMatrixMult(cl_mem a_buf, cl_mem b_buf, cl_mem out_buf, cl_uint num_wait_events, const cl_event *wait_events, cl_event *kernel_event)
+{
+    cl_int status;
+    unsigned argi = 0;
+
+    if (kernelVariant == SYSTOLIC)
+    {
+        status = clSetKernelArg(feedAKernel, 0, sizeof(cl_mem), &a_buf);
+        checkError(status, "Failed to set argument %d", 0);
+
+        status = clSetKernelArg(feedAKernel, 1, sizeof(cl_int), (void *)&N);
+        checkError(status, "Failed to set argument %d", 1);
+
+        status = clSetKernelArg(feedBKernel, 0, sizeof(cl_mem), &b_buf);
+        checkError(status, "Failed to set argument %d", 0);
+
+        status = clSetKernelArg(feedBKernel, 1, sizeof(cl_int), (void *)&N);
+        checkError(status, "Failed to set argument %d", 1);
+
+        status = clSetKernelArg(computationKernel, argi++, sizeof(cl_int), (void *)&N);
+        checkError(status, "Failed to set argument %d", argi - 1);
+
+        status = clSetKernelArg(computationKernel, argi++, sizeof(cl_mem), &out_buf);
+        checkError(status, "Failed to set argument %d", argi - 1);
+
+        status = clEnqueueTask(feedAQueue, feedAKernel, num_wait_events, wait_events, NULL);
+        checkError(status, "Failed to launch feedAKernel");
+
+        status = clEnqueueTask(feedBQueue, feedBKernel, num_wait_events, wait_events, NULL);
+        checkError(status, "Failed to launch feedBKernel");
+
+        status = clEnqueueTask(queue, computationKernel, num_wait_events, wait_events, kernel_event);
+        checkError(status, "Failed to launch kernel");
+
+        clFlush(feedAQueue);
+        clFlush(feedBQueue);
+        return;
+    }
+
+    size_t global_work_size[2];
+    global_work_size[0] = N;
+    global_work_size[1] = N;
+
+    // the tiled kernel requires work groups of exactly one tile
+    size_t local_work_size[2];
+    local_work_size[0] = BLOCK_SIZE;
+    local_work_size[1] = BLOCK_SIZE;
+
+    status = clSetKernelArg(computationKernel, argi++, sizeof(cl_mem), &a_buf);
+    checkError(status, "Failed to set argument %d", argi - 1);
+
+    status = clSetKernelArg(computationKernel, argi++, sizeof(cl_mem), &b_buf);
+    checkError(status, "Failed to set argument %d", argi - 1);
+
+    status = clSetKernelArg(computationKernel, argi++, sizeof(cl_int), (void *)&N);
+    checkError(status, "Failed to set argument %d", argi - 1);
+
+    status = clSetKernelArg(computationKernel, argi++, sizeof(cl_mem), &out_buf);
+    checkError(status, "Failed to set argument %d", argi - 1);
+
+    status = clEnqueueNDRangeKernel(queue, computationKernel, 2, NULL, global_work_size, kernelVariant == TILED ? local_work_size : NULL, num_wait_events, wait_events, kernel_event);
+    checkError(status, "Failed to launch kernel");
+}
+
+// Enqueue C = A * B for the shape and layouts in params, A, B and C are separate buffers.
+void enqueueGemm(cl_command_queue gemm_queue, cl_mem a_buf, cl_mem b_buf, cl_mem c_buf, const device_epilogue *epilogue, const gemm_params &params,
+                 cl_uint num_wait_events, const cl_event *wait_events, cl_event *kernel_event)
+{
+    cl_int status;
+    unsigned argi = 0;
+
+    cl_int M = params.M, N = params.N, K = params.K;
+    cl_int lda = params.lda, ldb = params.ldb, ldc = params.ldc;
+    cl_int a_col_major = params.a_col_major, b_col_major = params.b_col_major, c_col_major = params.c_col_major;
+
+    status = clSetKernelArg(gemmKernel, argi++, sizeof(cl_mem), &a_buf);
+    checkError(status, "Failed to set argument %d", argi - 1);
+
+    status = clSetKernelArg(gemmKernel, argi++, sizeof(cl_mem), &b_buf);
+    checkError(status, "Failed to set argument %d", argi - 1);
+
+    status = clSetKernelArg(gemmKernel, argi++, sizeof(cl_mem), &c_buf);
+    checkError(status, "Failed to set argument %d", argi - 1);
+
+    const cl_int *int_args[] = {&M, &N, &K, &lda, &ldb, &ldc, &a_col_major, &b_col_major, &c_col_major};
+    for (unsigned i = 0; i < sizeof(int_args) / sizeof(int_args[0]); i++)
+    {
+        status = clSetKernelArg(gemmKernel, argi++, sizeof(cl_int), int_args[i]);
+        checkError(status, "Failed to set argument %d", argi - 1);
+    }
+
+    if (epilogue)
+    {
+        // a NULL buffer becomes a NULL pointer in the kernel, which skips the bias
+        status = clSetKernelArg(gemmKernel, argi++, sizeof(cl_mem), epilogue->bias_buf ? &epilogue->bias_buf : NULL);
+        checkError(status, "Failed to set argument %d", argi - 1);
+        status = clSetKernelArg(gemmKernel, argi++, sizeof(_posit8), &epilogue->scale);
+        checkError(status, "Failed to set argument %d", argi - 1);
+        status = clSetKernelArg(gemmKernel, argi++, sizeof(cl_int), &epilogue->activation);
+        checkError(status, "Failed to set argument %d", argi - 1);
+    }
+
+    size_t global_work_size[2];
+    global_work_size[0] = params.N;
+    global_work_size[1] = params.M;
+
+    status = clEnqueueNDRangeKernel(gemm_queue, gemmKernel, 2, NULL, global_work_size, NULL, num_wait_events, wait_events, kernel_event);
+    checkError(status, "Failed to launch gemm kernel");
+}
+
+// Splits the M rows of A over the devices in proportion to their throughput, device i gets the rows
+// from first_rows[i] to first_rows[i + 1].
+std::vector<unsigned> splitRows(unsigned M, const std::vector<double> &throughput)
+{
+    double total = 0;
+    for (size_t i = 0; i < throughput.size(); i++)
+    {
+        total += throughput[i];
+    }
+    std::vector<unsigned> first_rows(throughput.size() + 1, M);
+    double sum = 0;
+    for (size_t i = 0; i < throughput.size(); i++)
+    {
+        first_rows[i] = (unsigned)(M * (sum / total) + 0.5);
+        sum += throughput[i];
+    }
+    return first_rows;
+}
+
+// Origin and region of the rows first to first + rows of a host matrix with cols columns, for
+// clEnqueueWriteBufferRect and clEnqueueReadBufferRect. The rows are copied to or from a packed
+// device matrix with the same storage order, whose leading dimension is returned.
+unsigned rowBlockRect(bool col_major, unsigned ld, unsigned cols, unsigned first, unsigned rows, size_t element_size, size_t host_origin[3],
+                      size_t region[3], size_t *host_pitch, size_t *buffer_pitch)
+{
+    // row major matrices are cols wide lines, column major ones cols lines of all rows
+    host_origin[0] = col_major ? first * element_size : 0;
+    host_origin[1] = col_major ? 0 : first;
+    host_origin[2] = 0;
+    region[0] = (col_major ? rows : cols) * element_size;
+    region[1] = col_major ? cols : rows;
+    region[2] = 1;
+    *host_pitch = ld * element_size;
+    *buffer_pitch = region[0];
+    return col_major ? rows : cols;
+}
+
+// Writes the posit8 stream to the device of device_queue and expands it into out_buf with
+// decode_posit8_blocks. The buffers and the write events are appended to bufs and events, error_buf gets
+// the int the kernel sets to non zero if a block does not decode.
+void enqueueDecodeStream(cl_command_queue device_queue, const std::vector<unsigned char> &stream, cl_mem out_buf, std::vector<cl_mem> &bufs,
+                         std::vector<cl_event> &events, cl_mem *error_buf, cl_event *decode_event)
+{
+    cl_int status;
+    posit8_stream_info info = {};
+    std::vector<unsigned short> table(POSIT8_CODEC_TABLE_SIZE);
+    if (!parsePosit8Stream(stream.data(), stream.size(), &info) || !buildPosit8DecodeTable(info.lengths, table.data()))
+    {
+        checkError(CL_INVALID_VALUE, "Invalid posit8 stream");
+    }
+
+    // the block offsets and the payload are stored as the kernel reads them
+    const size_t offsets_size = 4 * ((size_t)info.num_blocks + 1);
+    const size_t payload_size = stream.size() - (info.payload - stream.data());
+    const void *data[3] = {info.block_offsets, info.payload, table.data()};
+    const size_t sizes[3] = {offsets_size, payload_size > 0 ? payload_size : 1, table.size() * sizeof(unsigned short)};
+    cl_mem stream_bufs[3];
+    cl_event write_events[3];
+    for (int i = 0; i < 3; i++)
+    {
+        stream_bufs[i] = clCreateBuffer(context, CL_MEM_READ_ONLY, sizes[i], NULL, &status);
+        checkError(status, "Failed to create buffer for the posit8 stream");
+        status = clEnqueueWriteBuffer(device_queue, stream_bufs[i], CL_FALSE, 0, i == 1 ? payload_size : sizes[i], data[i], 0, NULL, &write_events[i]);
+        checkError(status, "Failed to transfer the posit8 stream");
+        bufs.push_back(stream_bufs[i]);
+        events.push_back(write_events[i]);
+    }
+
+    cl_int no_error = 0;
+    *error_buf = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(no_error), &no_error, &status);
+    checkError(status, "Failed to create buffer for the decode error");
+    bufs.push_back(*error_buf);
+
+    cl_uint count = info.count, block_size = info.block_size;
+    unsigned argi = 0;
+    status = clSetKernelArg(decodeKernel, argi++, sizeof(cl_mem), &stream_bufs[1]);
+    checkError(status, "Failed to set argument %d", argi - 1);
+    status = clSetKernelArg(decodeKernel, argi++, sizeof(cl_mem), &stream_bufs[0]);
+    checkError(status, "Failed to set argument %d", argi - 1);
+    status = clSetKernelArg(decodeKernel, argi++, sizeof(cl_mem), &stream_bufs[2]);
+    checkError(status, "Failed to set argument %d", argi - 1);
+    status = clSetKernelArg(decodeKernel, argi++, sizeof(cl_uint), &count);
+    checkError(status, "Failed to set argument %d", argi - 1);
+    status = clSetKernelArg(decodeKernel, argi++, sizeof(cl_uint), &block_size);
+    checkError(status, "Failed to set argument %d", argi - 1);
+    status = clSetKernelArg(decodeKernel, argi++, sizeof(cl_mem), &out_buf);
+    checkError(status, "Failed to set argument %d", argi - 1);
+    status = clSetKernelArg(decodeKernel, argi++, sizeof(cl_mem), error_buf);
+    checkError(status, "Failed to set argument %d", argi - 1);
+
+    // one work item per block, groups of 64 share a decode table
+    size_t local_work_size = 64;
+    size_t global_work_size = (info.num_blocks + local_work_size - 1) / local_work_size * local_work_size;
+    status = clEnqueueNDRangeKernel(device_queue, decodeKernel, 1, NULL, &global_work_size, &local_work_size, 3, write_events, decode_event);
+    checkError(status, "Failed to launch decode kernel");
+}
+
+// Computes C = A * B with the rows of A and C split over all devices by first_rows (see splitRows).
+// Every device gets its block of A and all of B and writes its block of C, which is gathered into c.
+// If b_stream is not NULL, B is sent as this posit8_codec.h stream and decoded on the devices.
+// device_seconds gets the kernel time of every device, the result is the longest one.
+double shardedGemm(const gemm_params &params, const unsigned char *a, const unsigned char *b, const std::vector<unsigned char> *b_stream,
+                   unsigned char *c, const unsigned char *bias, const std::vector<unsigned> &first_rows, std::vector<double> &device_seconds)
+{
+    cl_int status;
+    const size_t num_devices = gemmQueues.size();
+    const size_t element_size = gemmElementSize();
+    const size_t b_size = (size_t)params.ldb * (params.b_col_major ? params.N : params.K) * element_size;
+    const size_t buffer_origin[3] = {0, 0, 0};
+
+    std::vector<cl_mem> bufs;
+    std::vector<cl_event> events;
+    std::vector<cl_event> read_events;
+    std::vector<cl_event> kernel_events(num_devices, NULL);
+    std::vector<cl_mem> decode_errors(num_devices, NULL);
+    for (size_t d = 0; d < num_devices; d++)
+    {
+        unsigned rows = first_rows[d + 1] - first_rows[d];
+        if (rows == 0)
+        {
+            continue;
+        }
+        cl_command_queue device_queue = gemmQueues[d];
+        cl_event write_events[3];
+        cl_uint num_writes = 0;
+
+        gemm_params block = params;
+        block.M = rows;
+        size_t host_origin[3], region[3], host_pitch, buffer_pitch;
+
+        block.lda = rowBlockRect(params.a_col_major, params.lda, params.K, first_rows[d], rows, element_size, host_origin, region, &host_pitch,
+                                 &buffer_pitch);
+        cl_mem a_buf = clCreateBuffer(context, CL_MEM_READ_ONLY, (size_t)rows * params.K * element_size, NULL, &status);
+        checkError(status, "Failed to create buffer for A on device %d", (int)d);
+        status = clEnqueueWriteBufferRect(device_queue, a_buf, CL_FALSE, buffer_origin, host_origin, region, buffer_pitch, 0, host_pitch, 0, a, 0,
+                                          NULL, &write_events[num_writes++]);
+        checkError(status, "Failed to transfer input A to device %d", (int)d);
+
+        cl_mem b_buf = clCreateBuffer(context, b_stream ? CL_MEM_READ_WRITE : CL_MEM_READ_ONLY, b_size, NULL, &status);
+        checkError(status, "Failed to create buffer for B on device %d", (int)d);
+        if (b_stream)
+        {
+            enqueueDecodeStream(device_queue, *b_stream, b_buf, bufs, events, &decode_errors[d], &write_events[num_writes++]);
+        }
+        else
+        {
+            status = clEnqueueWriteBuffer(device_queue, b_buf, CL_FALSE, 0, b_size, b, 0, NULL, &write_events[num_writes++]);
+            checkError(status, "Failed to transfer input B to device %d", (int)d);
+        }
+        bufs.push_back(a_buf);
+        bufs.push_back(b_buf);
+
+        // bias of the fused epilogue, one value per column of C
+        device_epilogue epilogue = {NULL, 0x40, gemmActivation};
+        doubleToPosit8(gemmScale, &epilogue.scale);
+        if (bias)
+        {
+            epilogue.bias_buf = clCreateBuffer(context, CL_MEM_READ_ONLY, params.N, NULL, &status);
+            checkError(status, "Failed to create buffer for the bias on device %d", (int)d);
+            status = clEnqueueWriteBuffer(device_queue, epilogue.bias_buf, CL_FALSE, 0, params.N, bias, 0, NULL, &write_events[num_writes++]);
+            checkError(status, "Failed to transfer the bias to device %d", (int)d);
+            bufs.push_back(epilogue.bias_buf);
+        }
+
+        cl_mem c_buf = clCreateBuffer(context, CL_MEM_WRITE_ONLY, (size_t)rows * params.N * element_size, NULL, &status);
+        checkError(status, "Failed to create buffer for C on device %d", (int)d);
+        bufs.push_back(c_buf);
+
+        block.ldc = rowBlockRect(params.c_col_major, params.ldc, params.N, first_rows[d], rows, element_size, host_origin, region, &host_pitch,
+                                 &buffer_pitch);
+        enqueueGemm(device_queue, a_buf, b_buf, c_buf, fusedEpilogue ? &epilogue : NULL, block, num_writes, write_events, &kernel_events[d]);
+
+        cl_event read_event;
+        status = clEnqueueReadBufferRect(device_queue, c_buf, CL_FALSE, buffer_origin, host_origin, region, buffer_pitch, 0, host_pitch, 0, c, 1,
+                                         &kernel_events[d], &read_event);
+        checkError(status, "Failed to read output C from device %d", (int)d);
+        read_events.push_back(read_event);
+        events.insert(events.end(), write_events, write_events + num_writes);
+
+        // start this device before the transfers of the next one are enqueued
+        clFlush(device_queue);
+    }
+    clWaitForEvents(read_events.size(), read_events.data());
+
+    // C is garbage if B did not decode
+    for (size_t d = 0; d < num_devices; d++)
+    {
+        if (decode_errors[d])
+        {
+            cl_int decode_error = 0;
+            status = clEnqueueReadBuffer(gemmQueues[d], decode_errors[d], CL_TRUE, 0, sizeof(decode_error), &decode_error, 0, NULL, NULL);
+            checkError(status, "Failed to read the decode error of device %d", (int)d);
+            if (decode_error)
+            {
+                checkError(CL_INVALID_VALUE, "Damaged posit8 stream on device %d", (int)d);
+            }
+        }
+    }
+
+    double seconds = 0;
+    device_seconds.assign(num_devices, 0.0);
+    for (size_t d = 0; d < num_devices; d++)
+    {
+        if (kernel_events[d])
+        {
+            device_seconds[d] = double(getStartEndTime(kernel_events[d])) * 1e-9;
+            seconds = std::max(seconds, device_seconds[d]);
+            clReleaseEvent(kernel_events[d]);
+        }
+    }
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        clReleaseEvent(events[i]);
+    }
+    for (size_t i = 0; i < read_events.size(); i++)
+    {
+        clReleaseEvent(read_events[i]);
+    }
+    for (size_t i = 0; i < bufs.size(); i++)
+    {
+        clReleaseMemObject(bufs[i]);
+    }
+    return seconds;
+}
+
+// Computes C = A * B on the first device with all matrices in buffers of hostPool, the random
+// inputs are generated in place and only unmapping and mapping the buffers moves data.
+void zeroCopyGemm(const gemm_params &params)
+{
+    size_t a_size = (size_t)params.lda * (params.a_col_major ? params.K : params.M);
+    size_t b_size = (size_t)params.ldb * (params.b_col_major ? params.N : params.K);
+    size_t c_size = (size_t)params.ldc * (params.c_col_major ? params.N : params.M);
+    const size_t element_size = gemmElementSize();
+
+    if (hostPool == NULL)
+    {
+        hostPool = new host_buffer_pool(context, queue);
+    }
+    host_buffer *a = hostPool->acquire(a_size * element_size);
+    host_buffer *b = hostPool->acquire(b_size * element_size);
+    host_buffer *c = hostPool->acquire(c_size * element_size);
+    host_buffer *bias = gemmBias ? hostPool->acquire(params.N) : NULL;
+    fillRandomGemm((unsigned char *)a->ptr, a_size);
+    fillRandomGemm((unsigned char *)b->ptr, b_size);
+    if (bias)
+    {
+        fillRandomGemm((unsigned char *)bias->ptr, params.N);
+    }
+
+    // the kernel writes C, so it goes to the device as well
+    cl_event unmap_events[4];
+    cl_uint num_unmaps = 0;
+    hostPool->unmap(a, 0, NULL, &unmap_events[num_unmaps++]);
+    hostPool->unmap(b, 0, NULL, &unmap_events[num_unmaps++]);
+    hostPool->unmap(c, 0, NULL, &unmap_events[num_unmaps++]);
+    if (bias)
+    {
+        hostPool->unmap(bias, 0, NULL, &unmap_events[num_unmaps++]);
+    }
+
+    device_epilogue epilogue = {bias ? bias->buf : NULL, 0x40, gemmActivation};
+    doubleToPosit8(gemmScale, &epilogue.scale);
+
+    cl_event kernel_event;
+    enqueueGemm(queue, a->buf, b->buf, c->buf, fusedEpilogue ? &epilogue : NULL, params, num_unmaps, unmap_events, &kernel_event);
+    hostPool->map(c, 1, &kernel_event); // C is at c->ptr now
+
+    double seconds = double(getStartEndTime(kernel_event)) * 1e-9;
+    double operations = 2.0 * params.M * params.N * params.K;
+    double gflops = (operations / seconds) * 1.0e-9;
+    printf("%lf,%lf\n", seconds, gflops);
+
+    for (cl_uint i = 0; i < num_unmaps; i++)
+    {
+        clReleaseEvent(unmap_events[i]);
+    }
+    clReleaseEvent(kernel_event);
+    hostPool->release(a);
+    hostPool->release(b);
+    hostPool->release(c);
+    if (bias)
+    {
+        hostPool->release(bias);
+    }
+}
+
+// Multiply two random matrices, or the ones of -a and -b, with the shape and layouts in params. The
+// transfers read mapped tensor files directly and C is read into the file of -c. With several devices the
+// rows are split over all of them in proportion to their throughput, which the first call measures
+// with equal blocks of a small slice of the multiplication.
+void runGemm(const gemm_params &params)
+{
+    if (zeroCopy && gemmQueues.size() == 1)
+    {
+        zeroCopyGemm(params);
+        return;
+    }
+
+    // storage needed by each matrix with its leading dimension
+    size_t a_size = (size_t)params.lda * (params.a_col_major ? params.K : params.M);
+    size_t b_size = (size_t)params.ldb * (params.b_col_major ? params.N : params.K);
+    size_t c_size = (size_t)params.ldc * (params.c_col_major ? params.N : params.M);
+
+    if (!createGemmOutput())
+    {
+        return;
+    }
+
+    // raw bytes, the elements are posit8 or the -posit format
+    scoped_aligned_ptr<unsigned char> a_owned, b_owned, c_owned;
+    unsigned char *a = gemmMatrix(0, a_size, a_owned);
+    unsigned char *b = gemmMatrix(1, b_size, b_owned);
+    unsigned char *c = gemmMatrix(2, c_size, c_owned);
+
+    scoped_aligned_ptr<unsigned char> bias;
+    if (gemmBias)
+    {
+        bias.reset(params.N);
+        fillRandomGemm(bias, params.N);
+    }
+
+    // B crosses the bus compressed, e.g. the weights of a layer
+    std::vector<unsigned char> b_stream;
+    if (compressData)
+    {
+        b_stream.resize(posit8StreamBound(b_size, POSIT8_CODEC_BLOCK_SIZE));
+        b_stream.resize(encodePosit8Stream(b, b_size, POSIT8_CODEC_BLOCK_SIZE, b_stream.data()));
+    }
+
+    std::vector<double> device_seconds;
+    if (gemmQueues.size() > 1 && !throughputMeasured)
+    {
+        // the top left corner of the product, the timed launch overwrites its part of C. B goes
+        // uncompressed, only its whole stream decodes
+        gemm_params slice = params;
+        slice.M = std::min(params.M, CALIBRATION_ROWS * (unsigned)gemmQueues.size());
+        slice.N = std::min(params.N, (unsigned)CALIBRATION_SIZE);
+        slice.K = std::min(params.K, (unsigned)CALIBRATION_SIZE);
+        std::vector<unsigned> first_rows = splitRows(slice.M, std::vector<double>(gemmQueues.size(), 1.0));
+        shardedGemm(slice, a, b, NULL, c, gemmBias ? bias.get() : NULL, first_rows, device_seconds);
+        for (size_t d = 0; d < gemmQueues.size(); d++)
+        {
+            unsigned rows = first_rows[d + 1] - first_rows[d];
+            if (rows > 0 && device_seconds[d] > 0)
+            {
+                deviceThroughput[d] = rows / device_seconds[d];
+            }
+        }
+        throughputMeasured = true;
+    }
+
+    double seconds = shardedGemm(params, a, b, compressData ? &b_stream : NULL, c, gemmBias ? bias.get() : NULL, splitRows(params.M, deviceThroughput),
+                                 device_seconds);
+    if (!finishGemmOutput())
+    {
+        return;
+    }
+    double operations = 2.0 * params.M * params.N * params.K;
+    double gflops = (operations / seconds) * 1.0e-9;
+    printf("%lf,%lf\n", seconds, gflops);
+}
+
+// Run rows random input vectors through the model. On the device the weights are uploaded once and
+// the activations stay in two device buffers that alternate between the layers, every layer is one
+// matrix_mult_general_fused launch and only the output of the last layer is read back. The result
+// is compared with cpuMlpForward, with the CPU backend that is the whole run.
+void runMlp(const mlp_model &model, unsigned rows)
+{
+    cl_int status;
+    const size_t num_layers = model.layers.size();
+    const mlp_layer &last = model.layers[num_layers - 1];
+
+    std::vector<unsigned char> in((size_t)rows * model.layers[0].inputs);
+    for (size_t i = 0; i < in.size(); i++)
+    {
+        doubleToPosit8(fRand(-1.0, 1.0), &in[i]);
+    }
+
+    double operations = 0;
+    unsigned max_width = model.layers[0].inputs;
+    for (size_t l = 0; l < num_layers; l++)
+    {
+        operations += 2.0 * rows * model.layers[l].inputs * model.layers[l].outputs;
+        max_width = std::max(max_width, model.layers[l].outputs);
+    }
+
+    std::vector<unsigned char> reference;
+    const double start_time = getCurrentTimestamp();
+    cpuMlpForward(model, in.data(), rows, reference, NUM_THREADS);
+    const double end_time = getCurrentTimestamp();
+    if (cpuBackend)
+    {
+        double seconds = end_time - start_time;
+        printf("%lf,%lf\n", seconds, (operations / seconds) * 1.0e-9);
+        return;
+    }
+
+    // weights and bias of all layers, written once
+    std::vector<cl_mem> weight_bufs(num_layers), bias_bufs(num_layers);
+    std::vector<cl_event> write_events;
+    for (size_t l = 0; l < num_layers; l++)
+    {
+        const mlp_layer &layer = model.layers[l];
+        cl_event event;
+        weight_bufs[l] = clCreateBuffer(context, CL_MEM_READ_ONLY, layer.weights.size(), NULL, &status);
+        checkError(status, "Failed to create buffer for the weights of layer %d", (int)l);
+        status = clEnqueueWriteBuffer(queue, weight_bufs[l], CL_FALSE, 0, layer.weights.size(), layer.weights.data(), 0, NULL, &event);
+        checkError(status, "Failed to transfer the weights of layer %d", (int)l);
+        write_events.push_back(event);
+
+        bias_bufs[l] = clCreateBuffer(context, CL_MEM_READ_ONLY, layer.bias.size(), NULL, &status);
+        checkError(status, "Failed to create buffer for the bias of layer %d", (int)l);
+        status = clEnqueueWriteBuffer(queue, bias_bufs[l], CL_FALSE, 0, layer.bias.size(), layer.bias.data(), 0, NULL, &event);
+        checkError(status, "Failed to transfer the bias of layer %d", (int)l);
+        write_events.push_back(event);
+    }
+
+    // activations, layer l reads activation_bufs[l % 2] and writes activation_bufs[(l + 1) % 2]
+    cl_mem activation_bufs[2];
+    for (int i = 0; i < 2; i++)
+    {
+        activation_bufs[i] = clCreateBuffer(context, CL_MEM_READ_WRITE, (size_t)rows * max_width, NULL, &status);
+        checkError(status, "Failed to create activation buffer %d", i);
+    }
+    cl_event event;
+    status = clEnqueueWriteBuffer(queue, activation_bufs[0], CL_FALSE, 0, in.size(), in.data(), 0, NULL, &event);
+    checkError(status, "Failed to transfer the input");
+    write_events.push_back(event);
+
+    std::vector<cl_event> kernel_events(num_layers);
+    for (size_t l = 0; l < num_layers; l++)
+    {
+        const mlp_layer &layer = model.layers[l];
+        gemm_params params = {rows, layer.outputs, layer.inputs, layer.inputs, layer.outputs, layer.outputs, false, false, false};
+        device_epilogue epilogue = {bias_bufs[l], layer.scale, layer.activation};
+
+        // the first layer waits for all uploads, every further one for its predecessor
+        if (l == 0)
+        {
+            enqueueGemm(queue, activation_bufs[0], weight_bufs[0], activation_bufs[1], &epilogue, params, write_events.size(), write_events.data(),
+                        &kernel_events[0]);
+        }
+        else
+        {
+            enqueueGemm(queue, activation_bufs[l % 2], weight_bufs[l], activation_bufs[(l + 1) % 2], &epilogue, params, 1, &kernel_events[l - 1],
+                        &kernel_events[l]);
+        }
+    }
+
+    std::vector<unsigned char> out((size_t)rows * last.outputs);
+    cl_event finish_event;
+    status = clEnqueueReadBuffer(queue, activation_bufs[num_layers % 2], CL_FALSE, 0, out.size(), out.data(), 1, &kernel_events[num_layers - 1],
+                                 &finish_event);
+    checkError(status, "Failed to read the output");
+    clWaitForEvents(1, &finish_event);
+
+    cl_ulong time_ns = 0;
+    for (size_t l = 0; l < num_layers; l++)
+    {
+        time_ns += getStartEndTime(kernel_events[l]);
+    }
+    double seconds = double(time_ns) * 1e-9;
+    double gflops = (operations / seconds) * 1.0e-9;
+    printf("%lf,%lf\n", seconds, gflops);
+    if (out != reference)
+    {
+        printf("ERROR: Output of the device differs from cpuMlpForward.\n");
+    }
+
+    for (size_t i = 0; i < write_events.size(); i++)
+    {
+        clReleaseEvent(write_events[i]);
+    }
+    for (size_t l = 0; l < num_layers; l++)
+    {
+        clReleaseEvent(kernel_events[l]);
+        clReleaseMemObject(weight_bufs[l]);
+        clReleaseMemObject(bias_bufs[l]);
+    }
+    clReleaseEvent(finish_event);
+    clReleaseMemObject(activation_bufs[0]);
+    clReleaseMemObject(activation_bufs[1]);
+}
+
+void stopServiceHandler(int)
+{
+    gemmServiceStopped = 1;
+}
+
+// Reads A and B of a service request from fd, computes C = A * B and sends it back. On the device
+// the matrices live in buffers of hostPool, so the socket data lands in device visible memory and
+// later requests reuse the buffers of earlier ones. The CPU backend keeps its matrices in host.
+// Returns false if the connection failed.
+bool serviceGemm(int fd, const gemm_params &params, std::vector<unsigned char> host[3])
+{
+    const size_t sizes[3] = {(size_t)params.M * params.K, (size_t)params.K * params.N, (size_t)params.M * params.N};
+    if (cpuBackend)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            host[i].resize(sizes[i]);
+        }
+        if (!readAll(fd, host[0].data(), sizes[0]) || !readAll(fd, host[1].data(), sizes[1]))
+        {
+            return false;
+        }
+        cpuGemmPosit8(host[0].data(), host[1].data(), host[2].data(), params, NUM_THREADS);
+        return writeGemmResult(fd, GEMM_SERVICE_OK, params, host[2].data());
+    }
+
+    if (hostPool == NULL)
+    {
+        hostPool = new host_buffer_pool(context, queue);
+    }
+    host_buffer *bufs[3];
+    for (int i = 0; i < 3; i++)
+    {
+        bufs[i] = hostPool->acquire(sizes[i]);
+    }
+
+    bool ok = readAll(fd, bufs[0]->ptr, sizes[0]) && readAll(fd, bufs[1]->ptr, sizes[1]);
+    if (ok)
+    {
+        // the kernel writes C, so it goes to the device as well
+        cl_event unmap_events[3], kernel_event;
+        for (int i = 0; i < 3; i++)
+        {
+            hostPool->unmap(bufs[i], 0, NULL, &unmap_events[i]);
+        }
+        enqueueGemm(queue, bufs[0]->buf, bufs[1]->buf, bufs[2]->buf, NULL, params, 3, unmap_events, &kernel_event);
+        hostPool->map(bufs[2], 1, &kernel_event); // A and B are mapped again when they are acquired
+        ok = writeGemmResult(fd, GEMM_SERVICE_OK, params, (const unsigned char *)bufs[2]->ptr);
+
+        for (int i = 0; i < 3; i++)
+        {
+            clReleaseEvent(unmap_events[i]);
+        }
+        clReleaseEvent(kernel_event);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        hostPool->release(bufs[i]);
+    }
+    return ok;
+}
+
+// Answers GEMM requests on the local socket path until SIGINT or SIGTERM, one connection at a time.
+// The program, kernel and buffers are set up once, so a request only costs its transfers and the kernel.
+void runService(const std::string &path)
+{
+    int listen_fd = listenGemmService(path.c_str());
+    if (listen_fd < 0)
+    {
+        return;
+    }
+
+    // without SA_RESTART, so accept returns when a signal arrives
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopServiceHandler;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    printf("Serving posit8 GEMM requests on %s (%s).\n", path.c_str(), cpuBackend ? "CPU backend" : getDeviceName(device).c_str());
+    fflush(stdout);
+
+    std::vector<unsigned char> host[3]; // A, B and C of the CPU backend
+    unsigned long long requests = 0;
+    while (!gemmServiceStopped)
+    {
+        int fd = acceptGemmClient(listen_fd);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        gemm_params params;
+        while (!gemmServiceStopped && readGemmRequest(fd, params))
+        {
+            // an invalid request ends the connection, its matrices are not read
+            const unsigned max_elements = GEMM_SERVICE_MAX_ELEMENTS;
+            if (params.M == 0 || params.N == 0 || params.K == 0 || (unsigned long long)params.M * params.K > max_elements ||
+                (unsigned long long)params.K * params.N > max_elements || (unsigned long long)params.M * params.N > max_elements)
+            {
+                writeGemmResult(fd, GEMM_SERVICE_INVALID, params, NULL);
+                break;
+            }
+
+            if (!serviceGemm(fd, params, host))
+            {
+                break;
+            }
+            requests++;
+        }
+        close(fd);
+    }
+
+    close(listen_fd);
+    unlink(path.c_str());
+    printf("Served %llu requests.\n", requests);
+}
+
+// Sends the random matrices of params to the service on path and checks the result against cpuGemmPosit8.
+bool runClient(const std::string &path, const gemm_params &shape)
+{
+    unsigned flags = (shape.a_col_major ? GEMM_SERVICE_A_COL_MAJOR : 0) | (shape.b_col_major ? GEMM_SERVICE_B_COL_MAJOR : 0) |
+                     (shape.c_col_major ? GEMM_SERVICE_C_COL_MAJOR : 0);
+    gemm_params params = packedGemmParams(shape.M, shape.N, shape.K, flags);
+
+    std::vector<unsigned char> a((size_t)params.M * params.K), b((size_t)params.K * params.N);
+    std::vector<unsigned char> c((size_t)params.M * params.N), reference(c.size());
+    fillRandomGemm(a.data(), a.size());
+    fillRandomGemm(b.data(), b.size());
+
+    int fd = connectGemmService(path.c_str());
+    if (fd < 0)
+    {
+        return false;
+    }
+    const double start_time = getCurrentTimestamp();
+    bool ok = requestGemm(fd, params, a.data(), b.data(), c.data());
+    const double end_time = getCurrentTimestamp();
+    close(fd);
+    if (!ok)
+    {
+        printf("ERROR: The service did not answer the request.\n");
+        return false;
+    }
+
+    double seconds = end_time - start_time;
+    double operations = 2.0 * params.M * params.N * params.K;
+    printf("%lf,%lf\n", seconds, (operations / seconds) * 1.0e-9);
+
+    cpuGemmPosit8(a.data(), b.data(), reference.data(), params, NUM_THREADS);
+    if (c != reference)
+    {
+        printf("ERROR: Result of the service differs from cpuGemmPosit8.\n");
+        return false;
+    }
+    return true;
+}
+
+// Enqueue batch_count independent row major products C_i = A_i * B_i of the shape in params.
+// Without offsets_buf the matrices are packed back to back in a_buf, b_buf and c_buf, otherwise
+// offsets_buf holds 3 * batch_count ints with the first element of A_i, B_i and C_i.
+void enqueueBatchedGemm(cl_mem a_buf, cl_mem b_buf, cl_mem c_buf, cl_mem offsets_buf, const gemm_params &params, unsigned batch_count,
+                        cl_uint num_wait_events, const cl_event *wait_events, cl_event *kernel_event)
+{
+    cl_int status;
+    unsigned argi = 0;
+    cl_kernel kernel = offsets_buf ? batchedOffsetsKernel : batchedKernel;
+
+    cl_int M = params.M, N = params.N, K = params.K;
+    cl_int lda = params.lda, ldb = params.ldb, ldc = params.ldc;
+    cl_int stride_a = params.M * params.lda, stride_b = params.K * params.ldb, stride_c = params.M * params.ldc;
+
+    status = clSetKernelArg(kernel, argi++, sizeof(cl_mem), &a_buf);
+    checkError(status, "Failed to set argument %d", argi - 1);
+
+    status = clSetKernelArg(kernel, argi++, sizeof(cl_mem), &b_buf);
+    checkError(status, "Failed to set argument %d", argi - 1);
+
+    status = clSetKernelArg(kernel, argi++, sizeof(cl_mem), &c_buf);
+    checkError(status, "Failed to set argument %d", argi - 1);
+
+    if (offsets_buf)
+    {
+        status = clSetKernelArg(kernel, argi++, sizeof(cl_mem), &offsets_buf);
+        checkError(status, "Failed to set argument %d", argi - 1);
+    }
+
+    const cl_int *int_args[] = {&M, &N, &K, &lda, &ldb, &ldc, &stride_a, &stride_b, &stride_c};
+    unsigned num_int_args = offsets_buf ? 6 : 9;
+    for (unsigned i = 0; i < num_int_args; i++)
+    {
+        status = clSetKernelArg(kernel, argi++, sizeof(cl_int), int_args[i]);
+        checkError(status, "Failed to set argument %d", argi - 1);
+    }
+
+    size_t global_work_size[3];
+    global_work_size[0] = params.N;
+    global_work_size[1] = params.M;
+    global_work_size[2] = batch_count;
+
+    // one work group per small matrix keeps its rows of A and B together,
+    // larger matrices are left to the runtime
+    size_t local_work_size[3];
+    local_work_size[0] = params.N;
+    local_work_size[1] = params.M;
+    local_work_size[2] = 1;
+    const size_t *local = params.M * params.N <= 256 ? local_work_size : NULL;
+
+    status = clEnqueueNDRangeKernel(queue, kernel, 3, NULL, global_work_size, local, num_wait_events, wait_events, kernel_event);
+    checkError(status, "Failed to launch batched kernel");
+}
+
+// Multiply batch_count pairs of random matrices with the shape in params in a single launch.
+void runBatched(const gemm_params &params, unsigned batch_count, bool use_offsets)
+{
+    cl_int status;
+
+    size_t a_size = (size_t)params.M * params.K * batch_count;
+    size_t b_size = (size_t)params.K * params.N * batch_count;
+    size_t c_size = (size_t)params.M * params.N * batch_count;
+
+    scoped_aligned_ptr<_posit8> a, b, c;
+    a.reset(a_size);
+    b.reset(b_size);
+    c.reset(c_size);
+    for (size_t i = 0; i < a_size; i++)
+    {
+        doubleToPosit8(fRand(0, 1.0), &a[i]);
+    }
+    for (size_t i = 0; i < b_size; i++)
+    {
+        doubleToPosit8(fRand(0, 1.0), &b[i]);
+    }
+
+    cl_mem a_buf = clCreateBuffer(context, CL_MEM_READ_ONLY, a_size * sizeof(_posit8), NULL, &status);
+    checkError(status, "Failed to create buffer for A");
+    cl_mem b_buf = clCreateBuffer(context, CL_MEM_READ_ONLY, b_size * sizeof(_posit8), NULL, &status);
+    checkError(status, "Failed to create buffer for B");
+    cl_mem c_buf = clCreateBuffer(context, CL_MEM_WRITE_ONLY, c_size * sizeof(_posit8), NULL, &status);
+    checkError(status, "Failed to create buffer for C");
+    cl_mem offsets_buf = NULL;
+
+    cl_event write_events[3];
+    cl_uint num_write_events = 2;
+    status = clEnqueueWriteBuffer(queue, a_buf, CL_FALSE, 0, a_size * sizeof(_posit8), a, 0, NULL, &write_events[0]);
+    checkError(status, "Failed to transfer input A");
+    status = clEnqueueWriteBuffer(queue, b_buf, CL_FALSE, 0, b_size * sizeof(_posit8), b, 0, NULL, &write_events[1]);
+    checkError(status, "Failed to transfer input B");
+
+    scoped_aligned_ptr<cl_int> offsets;
+    if (use_offsets)
+    {
+        // same packing as the strided layout, but through the offset table
+        offsets.reset(3 * batch_count);
+        for (unsigned i = 0; i < batch_count; i++)
+        {
+            offsets[3 * i] = i * params.M * params.K;
+            offsets[3 * i + 1] = i * params.K * params.N;
+            offsets[3 * i + 2] = i * params.M * params.N;
+        }
+        offsets_buf = clCreateBuffer(context, CL_MEM_READ_ONLY, 3 * batch_count * sizeof(cl_int), NULL, &status);
+        checkError(status, "Failed to create buffer for offsets");
+        status = clEnqueueWriteBuffer(queue, offsets_buf, CL_FALSE, 0, 3 * batch_count * sizeof(cl_int), offsets, 0, NULL, &write_events[num_write_events++]);
+        checkError(status, "Failed to transfer offsets");
+    }
+
+    cl_event kernel_event, finish_event;
+    enqueueBatchedGemm(a_buf, b_buf, c_buf, offsets_buf, params, batch_count, num_write_events, write_events, &kernel_event);
+
+    status = clEnqueueReadBuffer(queue, c_buf, CL_FALSE, 0, c_size * sizeof(_posit8), c, 1, &kernel_event, &finish_event);
+    checkError(status, "Failed to read output C");
+    clWaitForEvents(1, &finish_event);
+
+    double seconds = double(getStartEndTime(kernel_event)) * 1e-9;
+    double operations = 2.0 * params.M * params.N * params.K * batch_count;
+    double gflops = (operations / seconds) * 1.0e-9;
+    printf("%lf,%lf\n", seconds, gflops);
+
+    for (cl_uint i = 0; i < num_write_events; i++)
+    {
+        clReleaseEvent(write_events[i]);
+    }
+    clReleaseEvent(kernel_event);
+    clReleaseEvent(finish_event);
+    clReleaseMemObject(a_buf);
+    clReleaseMemObject(b_buf);
+    clReleaseMemObject(c_buf);
+    if (offsets_buf)
+    {
+        clReleaseMemObject(offsets_buf);
+    }
+}
+
+// Runs the selected mode with cpuGemmPosit8 on the host. Every job multiplies its own pair of
+// random matrices (or those of -a and -b), the results are bit identical to the corresponding kernels.
+void runCpu()
+{
+    gemm_params params = gemm;
+    unsigned num_jobs = BATCH_COUNT > 0 ? BATCH_COUNT : 1;
+    if (!runGemmMode && BATCH_COUNT == 0)
+    {
+        // matrix_mult computes output[y*N + x] = sum A[x*N + i] * B[i*N + y], so C is column major
+        params.M = params.N = params.K = N;
+        params.lda = params.ldb = params.ldc = N;
+        params.a_col_major = params.b_col_major = false;
+        params.c_col_major = true;
+        num_jobs = NUM_STREAM_JOBS > 0 ? NUM_STREAM_JOBS : NUM_ITERATIONS;
+    }
+
+    size_t a_size = (size_t)params.lda * (params.a_col_major ? params.K : params.M);
+    size_t b_size = (size_t)params.ldb * (params.b_col_major ? params.N : params.K);
+    size_t c_size = (size_t)params.ldc * (params.c_col_major ? params.N : params.M);
+
+    const size_t element_size = gemmElementSize();
+
+    // the tensor files of -a, -b and -c only come with a single -gemm job
+    if (!createGemmOutput())
+    {
+        return;
+    }
+    scoped_aligned_ptr<unsigned char> a_owned, b_owned, c_owned;
+    unsigned char *a = gemmMatrix(0, a_size * num_jobs, a_owned);
+    unsigned char *b = gemmMatrix(1, b_size * num_jobs, b_owned);
+    unsigned char *c = gemmMatrix(2, c_size * num_jobs, c_owned);
+
+    scoped_aligned_ptr<unsigned char> bias;
+    gemm_epilogue epilogue = {NULL, 0x40, gemmActivation};
+    doubleToPosit8(gemmScale, &epilogue.scale);
+    if (gemmBias)
+    {
+        bias.reset(params.N);
+        fillRandomGemm(bias, params.N);
+        epilogue.bias = bias;
+    }
+
+    const double start_time = getCurrentTimestamp();
+    for (unsigned i = 0; i < num_jobs; i++)
+    {
+        if (genericPosit)
+        {
+            cpuGemmPositN(&a[i * a_size * element_size], &b[i * b_size * element_size], &c[i * c_size * element_size], params,
+                          positNbits, positEs, NUM_THREADS);
+        }
+        else
+        {
+            cpuGemmPosit8(&a[i * a_size], &b[i * b_size], &c[i * c_size], params, NUM_THREADS, fusedEpilogue ? &epilogue : NULL);
+        }
+    }
+    const double end_time = getCurrentTimestamp();
+    if (!finishGemmOutput())
+    {
+        return;
+    }
+
+    double seconds = end_time - start_time;
+    double operations = 2.0 * params.M * params.N * params.K * num_jobs;
+    double gflops = (operations / seconds) * 1.0e-9;
+    printf("%lf,%lf\n", seconds, gflops);
+}
+
+// Nearest rank percentile of samples, p in [0, 100].
+double percentile(std::vector<double> samples, double p)
+{
+    std::sort(samples.begin(), samples.end());
+    size_t rank = (size_t)ceil(p / 100.0 * samples.size());
+    return samples[rank > 0 ? rank - 1 : 0];
+}
+
+// Measures one configuration: every run writes the inputs, launches the kernel iterations times
+// and reads the result back. The first run is a warm up and not counted.
+bool benchmarkConfig(const std::string &variant, unsigned n, unsigned batch, unsigned iterations, bench_result *result)
+{
+    cl_int status;
+    const bool on_cpu = variant == "cpu";
+    const bool batched = variant == "batched";
+    if (!batched)
+    {
+        batch = 1;
+    }
+
+    if ((!on_cpu && cpuBackend) || (batched && !batchFitsOffsets(n, n, n, batch)))
+    {
+        return false;
+    }
+    if (!on_cpu && !batched)
+    {
+        KernelVariant kernel_variant = variant == "tiled" ? TILED : variant == "systolic" ? SYSTOLIC : NAIVE;
+        if ((kernel_variant == TILED && n % BLOCK_SIZE != 0) ||
+            (kernel_variant == SYSTOLIC && (n % SYSTOLIC_ROWS != 0 || n % SYSTOLIC_COLS != 0)))
+        {
+            return false;
+        }
+        if (kernel_variant != kernelVariant && !selectKernelVariant(kernel_variant))
+        {
+            return false;
+        }
+    }
+
+    // matrix_mult and its variants produce a column major C, matrix_mult_batched a row major one
+    gemm_params params = {n, n, n, n, n, n, false, false, !batched};
+    const size_t matrix_elements = (size_t)n * n;
+    const size_t total_elements = matrix_elements * batch;
+
+    scoped_aligned_ptr<_posit8> a, b, c, reference;
+    a.reset(total_elements);
+    b.reset(total_elements);
+    c.reset(total_elements);
+    reference.reset(total_elements);
+    for (size_t i = 0; i < total_elements; i++)
+    {
+        doubleToPosit8(fRand(-1.0, 1.0), &a[i]);
+        doubleToPosit8(fRand(-1.0, 1.0), &b[i]);
+    }
+    for (unsigned i = 0; i < batch; i++)
+    {
+        cpuGemmPosit8((const unsigned char *)&a[i * matrix_elements], (const unsigned char *)&b[i * matrix_elements],
+                      (unsigned char *)&reference[i * matrix_elements], params, NUM_THREADS);
+    }
+
+    cl_mem a_buf = NULL, b_buf = NULL, c_buf = NULL;
+    if (!on_cpu)
+    {
+        a_buf = clCreateBuffer(context, CL_MEM_READ_ONLY, total_elements * sizeof(_posit8), NULL, &status);
+        checkError(status, "Failed to create buffer for A");
+        b_buf = clCreateBuffer(context, CL_MEM_READ_ONLY, total_elements * sizeof(_posit8), NULL, &status);
+        checkError(status, "Failed to create buffer for B");
+        c_buf = clCreateBuffer(context, CL_MEM_WRITE_ONLY, total_elements * sizeof(_posit8), NULL, &status);
+        checkError(status, "Failed to create buffer for C");
+    }
+
+    std::vector<double> e2e_ms;
+    double kernel_ms = 0, write_ms = 0, read_ms = 0;
+    bool verified = true;
+
+    for (unsigned run = 0; run <= BENCH_RUNS; run++)
+    {
+        double run_kernel_ms = 0, run_write_ms = 0, run_read_ms = 0;
+        memset(c, 0, total_elements);
+        const double start_time = getCurrentTimestamp();
+
+        if (on_cpu)
+        {
+            for (unsigned i = 0; i < iterations; i++)
+            {
+                cpuGemmPosit8((const unsigned char *)a.get(), (const unsigned char *)b.get(), (unsigned char *)c.get(), params, NUM_THREADS);
+            }
+            run_kernel_ms = (getCurrentTimestamp() - start_time) * 1e3;
+        }
+        else
+        {
+            cl_event write_events[2], read_event;
+            scoped_array<cl_event> kernel_events(iterations);
+
+            status = clEnqueueWriteBuffer(queue, a_buf, CL_FALSE, 0, total_elements * sizeof(_posit8), a, 0, NULL, &write_events[0]);
+            checkError(status, "Failed to transfer input A");
+            status = clEnqueueWriteBuffer(queue, b_buf, CL_FALSE, 0, total_elements * sizeof(_posit8), b, 0, NULL, &write_events[1]);
+            checkError(status, "Failed to transfer input B");
+
+            for (unsigned i = 0; i < iterations; i++)
+            {
+                if (batched)
+                {
+                    enqueueBatchedGemm(a_buf, b_buf, c_buf, NULL, params, batch, 2, write_events, &kernel_events[i]);
+                }
+                else
+                {
+                    N = n;
+                    enqueueMatrixMult(a_buf, b_buf, c_buf, 2, write_events, &kernel_events[i]);
+                }
+            }
+
+            status = clEnqueueReadBuffer(queue, c_buf, CL_TRUE, 0, total_elements * sizeof(_posit8), c, 1, &kernel_events[iterations - 1], &read_event);
+            checkError(status, "Failed to read output C");
+
+            run_write_ms = (getStartEndTime(write_events[0]) + getStartEndTime(write_events[1])) * 1e-6;
+            run_read_ms = getStartEndTime(read_event) * 1e-6;
+            for (unsigned i = 0; i < iterations; i++)
+            {
+                run_kernel_ms += getStartEndTime(kernel_events[i]) * 1e-6;
+                clReleaseEvent(kernel_events[i]);
+            }
+            clReleaseEvent(write_events[0]);
+            clReleaseEvent(write_events[1]);
+            clReleaseEvent(read_event);
+        }
+
+        const double end_time = getCurrentTimestamp();
+        verified = verified && memcmp(c, reference, total_elements) == 0;
+        if (run == 0)
+        {
+            continue;
+        }
+        e2e_ms.push_back((end_time - start_time) * 1e3);
+        kernel_ms += run_kernel_ms;
+        write_ms += run_write_ms;
+        read_ms += run_read_ms;
+    }
+
+    if (!on_cpu)
+    {
+        clReleaseMemObject(a_buf);
+        clReleaseMemObject(b_buf);
+        clReleaseMemObject(c_buf);
+    }
+
+    result->variant = variant;
+    result->n = n;
+    result->batch = batch;
+    result->iterations = iterations;
+    result->runs = BENCH_RUNS;
+    result->kernel_ms = kernel_ms / BENCH_RUNS;
+    result->write_ms = write_ms / BENCH_RUNS;
+    result->read_ms = read_ms / BENCH_RUNS;
+    result->e2e_p50_ms = percentile(e2e_ms, 50);
+    result->e2e_p90_ms = percentile(e2e_ms, 90);
+    result->e2e_p99_ms = percentile(e2e_ms, 99);
+    result->e2e_min_ms = *std::min_element(e2e_ms.begin(), e2e_ms.end());
+    result->e2e_max_ms = *std::max_element(e2e_ms.begin(), e2e_ms.end());
+
+    // two inputs in, one output back
+    double transfer_ms = result->write_ms + result->read_ms;
+    result->bandwidth_gbs = transfer_ms > 0 ? 3.0 * total_elements * sizeof(_posit8) / (transfer_ms * 1e-3) * 1e-9 : 0;
+    double operations = 2.0 * n * n * n * batch * iterations;
+    result->gops = result->kernel_ms > 0 ? operations / (result->kernel_ms * 1e-3) * 1e-9 : 0;
+    result->verified = verified;
+    return true;
+}
+
+void printBenchResults(const std::vector<bench_result> &results, FILE *file)
+{
+    if (benchJson)
+    {
+        fprintf(file, "[\n");
+    }
+    else
+    {
+        fprintf(file, "variant,n,batch,iterations,runs,kernel_ms,write_ms,read_ms,e2e_p50_ms,e2e_p90_ms,e2e_p99_ms,"
+                      "e2e_min_ms,e2e_max_ms,bandwidth_gbs,gops,verified\n");
+    }
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const bench_result &r = results[i];
+        if (benchJson)
+        {
+            fprintf(file, "  {\"variant\": \"%s\", \"n\": %u, \"batch\": %u, \"iterations\": %u, \"runs\": %u, "
+                          "\"kernel_ms\": %f, \"write_ms\": %f, \"read_ms\": %f, "
+                          "\"e2e_p50_ms\": %f, \"e2e_p90_ms\": %f, \"e2e_p99_ms\": %f, \"e2e_min_ms\": %f, \"e2e_max_ms\": %f, "
+                          "\"bandwidth_gbs\": %f, \"gops\": %f, \"verified\": %s}%s\n",
+                    r.variant.c_str(), r.n, r.batch, r.iterations, r.runs, r.kernel_ms, r.write_ms, r.read_ms,
+                    r.e2e_p50_ms, r.e2e_p90_ms, r.e2e_p99_ms, r.e2e_min_ms, r.e2e_max_ms, r.bandwidth_gbs, r.gops,
+                    r.verified ? "true" : "false", i + 1 < results.size() ? "," : "");
+        }
+        else
+        {
+            fprintf(file, "%s,%u,%u,%u,%u,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%d\n",
+                    r.variant.c_str(), r.n, r.batch, r.iterations, r.runs, r.kernel_ms, r.write_ms, r.read_ms,
+                    r.e2e_p50_ms, r.e2e_p90_ms, r.e2e_p99_ms, r.e2e_min_ms, r.e2e_max_ms, r.bandwidth_gbs, r.gops, r.verified);
+        }
+    }
+
+    if (benchJson)
+    {
+        fprintf(file, "]\n");
+    }
+}
+
+// Sweeps every variant, size, batch count (batched only) and iteration count. Reports the mean
+// kernel and transfer times, end-to-end latency percentiles per run, transfer bandwidth and
+// GOPS (2 * N^3 posit operations per product), and checks every output against cpuGemmPosit8.
+// Configurations a variant can not run (size, missing kernels or no device) are skipped.
+void runBenchmark()
+{
+    std::vector<bench_result> results;
+
+    for (size_t v = 0; v < benchVariants.size(); v++)
+    {
+        const std::vector<unsigned> batches = benchVariants[v] == "batched" ? benchBatches : std::vector<unsigned>(1, 1);
+        for (size_t s = 0; s < benchSizes.size(); s++)
+        {
+            for (size_t b = 0; b < batches.size(); b++)
+            {
+                for (size_t i = 0; i < benchIterations.size(); i++)
+                {
+                    bench_result result;
+                    if (benchmarkConfig(benchVariants[v], benchSizes[s], batches[b], benchIterations[i], &result))
+                    {
+                        results.push_back(result);
+                    }
+                    else
+                    {
+                        fprintf(stderr, "Skipping %s with N = %u, batch = %u and %u iterations.\n", benchVariants[v].c_str(), benchSizes[s],
+                                batches[b], benchIterations[i]);
+                    }
+                }
+            }
+        }
+    }
+
+    FILE *file = stdout;
+    if (!benchOutputFile.empty())
+    {
+        file = fopen(benchOutputFile.c_str(), "w");
+        if (file == NULL)
+        {
+            printf("ERROR: Unable to open %s.\n", benchOutputFile.c_str());
+            return;
+        }
+    }
+    printBenchResults(results, file);
+    if (file != stdout)
+    {
+        fclose(file);
+    }
+}
+
+void printBits(size_t const size, void const *const ptr)
+{
+    unsigned char *b = (unsigned char *)ptr;
+    unsigned char byte;
+    int i, j;
+
+    for (i = size - 1; i >= 0; i--)
+    {
+        for (j = 7; j >= 0; j--)
+        {
+            byte = (b[i] >> j) & 1;
+            printf("%u", byte);
+        }
+    }
+    puts("");
+}
+
+// Initialize the data for the problem. Requires num_devices to be known.
+void init_problem()
+{
+    // Generate input vector A and the output consisting
+    // of a total of N * N elements.
+    input.reset(N * N);
+    output.reset(N * N);
+    for (unsigned j = 0; j < N * N; ++j)
+    {
+        _posit8 p;
+        doubleToPosit8(fRand(0, 1.0), &input[j]);
+        output[j] = 0;
+    }
+}
+
+// Free the resources allocated during initialization
+void cleanup()
+{
+    // removes C of -c if the run did not finish it
+    for (int i = 0; i < 3; i++)
+    {
+        closeTensorFile(gemmTensors[i]);
+    }
+    // unmaps its buffers on queue, so before the queues go
+    delete hostPool;
+    hostPool = NULL;
+    if (computationKernel)
+    {
+        clReleaseKernel(computationKernel);
+    }
+    if (gemmKernel)
+    {
+        clReleaseKernel(gemmKernel);
+    }
+    if (batchedKernel)
+    {
+        clReleaseKernel(batchedKernel);
+    }
+    if (batchedOffsetsKernel)
+    {
+        clReleaseKernel(batchedOffsetsKernel);
+    }
+    if (decodeKernel)
+    {
+        clReleaseKernel(decodeKernel);
+    }
+    if (feedAKernel)
+    {
+        clReleaseKernel(feedAKernel);
+    }
+    if (feedBKernel)
+    {
+        clReleaseKernel(feedBKernel);
+    }
+    if (input_buf)
+    {
+        clReleaseMemObject(input_buf);
+    }
+    if (output_buf)
+    {
+        clReleaseMemObject(output_buf);
+    }
+    for (unsigned i = 0; i < 2; i++)
+    {
+        if (stream_input_buf[i])
+        {
+            clReleaseMemObject(stream_input_buf[i]);
+        }
+        if (stream_output_buf[i])
+        {
+            clReleaseMemObject(stream_output_buf[i]);
+        }
+    }
+    if (program)
+    {
+        clReleaseProgram(program);
+    }
+    // gemmQueues[0] is queue
+    for (size_t i = 0; i < gemmQueues.size(); i++)
+    {
+        if (gemmQueues[i])
+        {
+            clReleaseCommandQueue(gemmQueues[i]);
+        }
+    }
+    if (writeQueue)
+    {
+        clReleaseCommandQueue(writeQueue);
+    }
+    if (readQueue)
+    {
+        clReleaseCommandQueue(readQueue);
+    }
+    if (feedAQueue)
+    {
+        clReleaseCommandQueue(feedAQueue);
+    }
+    if (feedBQueue)
+    {
+        clReleaseCommandQueue(feedBQueue);
+    }
+    if (context)
+    {
+        clReleaseContext(context);
     }
-    *out = output;
 }
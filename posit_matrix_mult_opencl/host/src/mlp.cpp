@@ -0,0 +1,174 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "cpu_gemm.h"
+#include "mlp.h"
+#include "posit8.h"
+#include "posit8_codec.h"
+
+namespace
+{
+
+const char MLP_MAGIC[8] = {'P', '8', 'M', 'L', 'P', 0, 0, 0};
+const char MLP_COMPRESSED_MAGIC[8] = {'P', '8', 'M', 'L', 'P', 'Z', 0, 0};
+
+bool readU32(FILE *file, unsigned &value)
+{
+    unsigned char bytes[4];
+    if (fread(bytes, 1, 4, file) != 4)
+    {
+        return false;
+    }
+    value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned)bytes[3] << 24);
+    return true;
+}
+
+void writeU32(FILE *file, unsigned value)
+{
+    unsigned char bytes[4] = {(unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24)};
+    fwrite(bytes, 1, 4, file);
+}
+
+} // namespace
+
+bool loadMlp(const std::string &path, mlp_model &model)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+    {
+        printf("ERROR: Can not open model %s.\n", path.c_str());
+        return false;
+    }
+
+    // the sizes in the file are checked against the bytes it has left before anything is allocated
+    struct stat info;
+    char magic[8];
+    unsigned num_layers = 0;
+    bool ok = fstat(fileno(file), &info) == 0 && fread(magic, 1, 8, file) == 8;
+    bool compressed = ok && memcmp(magic, MLP_COMPRESSED_MAGIC, 8) == 0;
+    ok = ok && (compressed || memcmp(magic, MLP_MAGIC, 8) == 0) && readU32(file, num_layers) && num_layers > 0;
+
+    model.layers.clear();
+    for (unsigned i = 0; ok && i < num_layers; i++)
+    {
+        mlp_layer layer;
+        unsigned activation = 0;
+        ok = readU32(file, layer.inputs) && readU32(file, layer.outputs) && readU32(file, activation) &&
+             fread(&layer.scale, 1, 1, file) == 1 && layer.inputs > 0 && layer.outputs > 0 &&
+             activation <= POSIT8_ACTIVATION_SIGMOID;
+        // consecutive layers have to fit together
+        ok = ok && (i == 0 || model.layers.back().outputs == layer.inputs);
+
+        // a compressed stream needs at least one bit per weight
+        unsigned long long weights = (unsigned long long)layer.inputs * layer.outputs;
+        unsigned stream_size = 0;
+        ok = ok && (!compressed || readU32(file, stream_size));
+        unsigned long long remaining = ok ? info.st_size - ftell(file) : 0;
+        unsigned long long weight_bytes = compressed ? stream_size : weights;
+        ok = ok && weight_bytes + layer.outputs <= remaining && (!compressed || weights <= 8ull * stream_size);
+        if (ok)
+        {
+            layer.activation = activation;
+            layer.weights.resize(weights);
+            layer.bias.resize(layer.outputs);
+            if (compressed)
+            {
+                ok = stream_size <= posit8StreamBound(layer.weights.size(), 1);
+                std::vector<unsigned char> stream(ok ? stream_size : 0);
+                ok = ok && fread(stream.data(), 1, stream.size(), file) == stream.size() &&
+                     decodePosit8Stream(stream.data(), stream.size(), layer.weights.data(), layer.weights.size()) == (long long)layer.weights.size();
+            }
+            else
+            {
+                ok = fread(layer.weights.data(), 1, layer.weights.size(), file) == layer.weights.size();
+            }
+            ok = ok && fread(layer.bias.data(), 1, layer.bias.size(), file) == layer.bias.size();
+            model.layers.push_back(layer);
+        }
+    }
+    fclose(file);
+
+    if (!ok)
+    {
+        printf("ERROR: %s is not a valid posit8 MLP model.\n", path.c_str());
+    }
+    return ok;
+}
+
+bool saveMlp(const std::string &path, const mlp_model &model, bool compressed)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == NULL)
+    {
+        printf("ERROR: Can not write model %s.\n", path.c_str());
+        return false;
+    }
+    fwrite(compressed ? MLP_COMPRESSED_MAGIC : MLP_MAGIC, 1, 8, file);
+    writeU32(file, model.layers.size());
+    for (size_t i = 0; i < model.layers.size(); i++)
+    {
+        const mlp_layer &layer = model.layers[i];
+        writeU32(file, layer.inputs);
+        writeU32(file, layer.outputs);
+        writeU32(file, layer.activation);
+        fwrite(&layer.scale, 1, 1, file);
+        if (compressed)
+        {
+            std::vector<unsigned char> stream(posit8StreamBound(layer.weights.size(), POSIT8_CODEC_BLOCK_SIZE));
+            stream.resize(encodePosit8Stream(layer.weights.data(), layer.weights.size(), POSIT8_CODEC_BLOCK_SIZE, stream.data()));
+            writeU32(file, stream.size());
+            fwrite(stream.data(), 1, stream.size(), file);
+        }
+        else
+        {
+            fwrite(layer.weights.data(), 1, layer.weights.size(), file);
+        }
+        fwrite(layer.bias.data(), 1, layer.bias.size(), file);
+    }
+    return fclose(file) == 0;
+}
+
+void randomMlp(const std::vector<unsigned> &sizes, mlp_model &model)
+{
+    model.layers.clear();
+    for (size_t i = 0; i + 1 < sizes.size(); i++)
+    {
+        mlp_layer layer;
+        layer.inputs = sizes[i];
+        layer.outputs = sizes[i + 1];
+        layer.activation = i + 2 < sizes.size() ? POSIT8_ACTIVATION_SIGMOID : POSIT8_ACTIVATION_NONE;
+        layer.scale = 0x40;
+
+        double range = 1.0 / sqrt((double)layer.inputs);
+        layer.weights.resize((size_t)layer.inputs * layer.outputs);
+        layer.bias.resize(layer.outputs);
+        for (size_t w = 0; w < layer.weights.size(); w++)
+        {
+            doubleToPosit8(range * (2.0 * rand() / RAND_MAX - 1.0), &layer.weights[w]);
+        }
+        for (size_t b = 0; b < layer.bias.size(); b++)
+        {
+            doubleToPosit8(range * (2.0 * rand() / RAND_MAX - 1.0), &layer.bias[b]);
+        }
+        model.layers.push_back(layer);
+    }
+}
+
+void cpuMlpForward(const mlp_model &model, const unsigned char *input, unsigned rows, std::vector<unsigned char> &output, unsigned num_threads)
+{
+    std::vector<unsigned char> current(input, input + (size_t)rows * model.layers[0].inputs);
+    for (size_t i = 0; i < model.layers.size(); i++)
+    {
+        const mlp_layer &layer = model.layers[i];
+        gemm_params params = {rows, layer.outputs, layer.inputs, layer.inputs, layer.outputs, layer.outputs, false, false, false};
+        gemm_epilogue epilogue = {layer.bias.data(), layer.scale, layer.activation};
+
+        output.assign((size_t)rows * layer.outputs, 0);
+        cpuGemmPosit8(current.data(), layer.weights.data(), output.data(), params, num_threads, &epilogue);
+        current.swap(output);
+    }
+    output.swap(current);
+}
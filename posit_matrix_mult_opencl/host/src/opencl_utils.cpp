@@ -0,0 +1,378 @@
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "opencl_utils.h"
+
+namespace ocl_utils
+{
+
+const char *getErrorString(cl_int error)
+{
+    switch (error)
+    {
+    case 0: return "CL_SUCCESS";
+    case -1: return "CL_DEVICE_NOT_FOUND";
+    case -2: return "CL_DEVICE_NOT_AVAILABLE";
+    case -3: return "CL_COMPILER_NOT_AVAILABLE";
+    case -4: return "CL_MEM_OBJECT_ALLOCATION_FAILURE";
+    case -5: return "CL_OUT_OF_RESOURCES";
+    case -6: return "CL_OUT_OF_HOST_MEMORY";
+    case -7: return "CL_PROFILING_INFO_NOT_AVAILABLE";
+    case -11: return "CL_BUILD_PROGRAM_FAILURE";
+    case -30: return "CL_INVALID_VALUE";
+    case -32: return "CL_INVALID_PLATFORM";
+    case -33: return "CL_INVALID_DEVICE";
+    case -34: return "CL_INVALID_CONTEXT";
+    case -36: return "CL_INVALID_COMMAND_QUEUE";
+    case -38: return "CL_INVALID_MEM_OBJECT";
+    case -42: return "CL_INVALID_BINARY";
+    case -44: return "CL_INVALID_PROGRAM";
+    case -45: return "CL_INVALID_PROGRAM_EXECUTABLE";
+    case -46: return "CL_INVALID_KERNEL_NAME";
+    case -48: return "CL_INVALID_KERNEL";
+    case -49: return "CL_INVALID_ARG_INDEX";
+    case -50: return "CL_INVALID_ARG_VALUE";
+    case -51: return "CL_INVALID_ARG_SIZE";
+    case -52: return "CL_INVALID_KERNEL_ARGS";
+    case -53: return "CL_INVALID_WORK_DIMENSION";
+    case -54: return "CL_INVALID_WORK_GROUP_SIZE";
+    case -55: return "CL_INVALID_WORK_ITEM_SIZE";
+    case -56: return "CL_INVALID_GLOBAL_OFFSET";
+    case -57: return "CL_INVALID_EVENT_WAIT_LIST";
+    case -58: return "CL_INVALID_EVENT";
+    case -61: return "CL_INVALID_BUFFER_SIZE";
+    case -63: return "CL_INVALID_GLOBAL_WORK_SIZE";
+    default: return "unknown error";
+    }
+}
+
+void _checkError(int line, const char *file, cl_int error, const char *msg, ...)
+{
+    if (error == CL_SUCCESS)
+    {
+        return;
+    }
+
+    printf("ERROR: %s (%d)\nLocation: %s:%d\nMessage: ", getErrorString(error), error, file, line);
+    va_list args;
+    va_start(args, msg);
+    vprintf(msg, args);
+    va_end(args);
+    printf("\n");
+
+    cleanup();
+    exit(error);
+}
+
+bool setCwdToExeDir()
+{
+    char path[4096];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length <= 0)
+    {
+        return false;
+    }
+    path[length] = '\0';
+
+    char *last_slash = strrchr(path, '/');
+    if (last_slash == NULL)
+    {
+        return true;
+    }
+    *last_slash = '\0';
+    return chdir(path) == 0;
+}
+
+std::string getPlatformName(cl_platform_id platform)
+{
+    char name[1024] = "";
+    clGetPlatformInfo(platform, CL_PLATFORM_NAME, sizeof(name), name, NULL);
+    return name;
+}
+
+std::string getDeviceName(cl_device_id device)
+{
+    char name[1024] = "";
+    clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(name), name, NULL);
+    return name;
+}
+
+static std::string toLower(std::string text)
+{
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        text[i] = tolower(text[i]);
+    }
+    return text;
+}
+
+cl_platform_id findPlatform(const char *search)
+{
+    cl_uint num_platforms = 0;
+    if (clGetPlatformIDs(0, NULL, &num_platforms) != CL_SUCCESS || num_platforms == 0)
+    {
+        return NULL;
+    }
+
+    scoped_array<cl_platform_id> platforms(num_platforms);
+    cl_int status = clGetPlatformIDs(num_platforms, platforms, NULL);
+    checkError(status, "Failed to query platforms");
+
+    std::string search_lower = toLower(search);
+    for (cl_uint i = 0; i < num_platforms; i++)
+    {
+        if (toLower(getPlatformName(platforms[i])).find(search_lower) != std::string::npos)
+        {
+            return platforms[i];
+        }
+    }
+    return NULL;
+}
+
+cl_device_id *getDevices(cl_platform_id platform, cl_device_type device_type, cl_uint *num_devices)
+{
+    cl_int status = clGetDeviceIDs(platform, device_type, 0, NULL, num_devices);
+    if (status == CL_DEVICE_NOT_FOUND)
+    {
+        *num_devices = 0;
+        return NULL;
+    }
+    checkError(status, "Failed to query the number of devices");
+
+    cl_device_id *devices = new cl_device_id[*num_devices];
+    status = clGetDeviceIDs(platform, device_type, *num_devices, devices, NULL);
+    checkError(status, "Failed to query devices");
+    return devices;
+}
+
+bool fileExists(const char *file_name)
+{
+    return access(file_name, R_OK) == 0;
+}
+
+std::string getBoardBinaryFile(const char *prefix, cl_device_id device)
+{
+    std::string file_name = std::string(prefix) + ".aocx";
+    if (!fileExists(file_name.c_str()))
+    {
+        printf("ERROR: Unable to find %s for device %s.\n", file_name.c_str(), getDeviceName(device).c_str());
+        return "";
+    }
+    return file_name;
+}
+
+// reads the whole file, NULL if it can not be opened
+static unsigned char *loadFile(const char *file_name, size_t *size)
+{
+    FILE *file = fopen(file_name, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    unsigned char *content = new unsigned char[*size + 1];
+    if (fread(content, 1, *size, file) != *size)
+    {
+        delete[] content;
+        fclose(file);
+        return NULL;
+    }
+    content[*size] = '\0';
+    fclose(file);
+    return content;
+}
+
+cl_program createProgramFromBinary(cl_context context, const char *binary_file_name, const cl_device_id *devices, unsigned num_devices)
+{
+    size_t binary_size;
+    scoped_array<unsigned char> binary(loadFile(binary_file_name, &binary_size));
+    if (binary == NULL)
+    {
+        checkError(CL_INVALID_PROGRAM, "Failed to load binary file %s", binary_file_name);
+    }
+
+    scoped_array<size_t> binary_lengths(num_devices);
+    scoped_array<const unsigned char *> binaries(num_devices);
+    for (unsigned i = 0; i < num_devices; i++)
+    {
+        binary_lengths[i] = binary_size;
+        binaries[i] = binary;
+    }
+
+    cl_int status;
+    scoped_array<cl_int> binary_status(num_devices);
+    cl_program program = clCreateProgramWithBinary(context, num_devices, devices, binary_lengths, binaries, binary_status, &status);
+    checkError(status, "Failed to create program with binary");
+    for (unsigned i = 0; i < num_devices; i++)
+    {
+        checkError(binary_status[i], "Failed to load binary for device %u", i);
+    }
+    return program;
+}
+
+cl_program createProgramFromSource(cl_context context, const char *source_file_name)
+{
+    size_t source_size;
+    scoped_array<unsigned char> source(loadFile(source_file_name, &source_size));
+    if (source == NULL)
+    {
+        checkError(CL_INVALID_PROGRAM, "Failed to load source file %s", source_file_name);
+    }
+
+    cl_int status;
+    const char *source_text = (const char *)source.get();
+    cl_program program = clCreateProgramWithSource(context, 1, &source_text, &source_size, &status);
+    checkError(status, "Failed to create program with source");
+    return program;
+}
+
+cl_int buildProgram(cl_program program, cl_uint num_devices, const cl_device_id *devices, const char *options)
+{
+    cl_int status = clBuildProgram(program, num_devices, devices, options, NULL, NULL);
+    if (status != CL_SUCCESS && num_devices > 0)
+    {
+        size_t log_size = 0;
+        clGetProgramBuildInfo(program, devices[0], CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size);
+        scoped_array<char> log(log_size + 1);
+        clGetProgramBuildInfo(program, devices[0], CL_PROGRAM_BUILD_LOG, log_size, log, NULL);
+        log[log_size] = '\0';
+        printf("Build log:\n%s\n", log.get());
+    }
+    return status;
+}
+
+void oclContextCallback(const char *errinfo, const void *, size_t, void *)
+{
+    printf("Context callback: %s\n", errinfo);
+}
+
+host_buffer_pool::~host_buffer_pool()
+{
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+        if (buffers[i]->mapped)
+        {
+            clEnqueueUnmapMemObject(queue, buffers[i]->buf, buffers[i]->ptr, 0, NULL, NULL);
+        }
+    }
+    clFinish(queue);
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+        clReleaseMemObject(buffers[i]->buf);
+        free(buffers[i]->ptr);
+        delete buffers[i];
+    }
+}
+
+host_buffer *host_buffer_pool::acquire(size_t size)
+{
+    size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    if (size == 0)
+    {
+        size = ALIGNMENT;
+    }
+
+    host_buffer *best = NULL;
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+        if (!buffers[i]->in_use && buffers[i]->size >= size && (best == NULL || buffers[i]->size < best->size))
+        {
+            best = buffers[i];
+        }
+    }
+
+    if (best == NULL)
+    {
+        void *ptr = NULL;
+        if (posix_memalign(&ptr, ALIGNMENT, size) != 0)
+        {
+            checkError(CL_OUT_OF_HOST_MEMORY, "Failed to allocate %zu bytes of host memory", size);
+        }
+        cl_int status;
+        cl_mem buf = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, size, ptr, &status);
+        checkError(status, "Failed to create host buffer of %zu bytes", size);
+
+        best = new host_buffer;
+        best->buf = buf;
+        best->ptr = ptr;
+        best->size = size;
+        best->mapped = false;
+        buffers.push_back(best);
+    }
+    best->in_use = true;
+    if (!best->mapped)
+    {
+        map(best, 0, NULL);
+    }
+    return best;
+}
+
+void host_buffer_pool::unmap(host_buffer *buffer, cl_uint num_wait_events, const cl_event *wait_events, cl_event *event)
+{
+    cl_int status = clEnqueueUnmapMemObject(queue, buffer->buf, buffer->ptr, num_wait_events, wait_events, event);
+    checkError(status, "Failed to unmap host buffer");
+    buffer->mapped = false;
+}
+
+void host_buffer_pool::map(host_buffer *buffer, cl_uint num_wait_events, const cl_event *wait_events)
+{
+    cl_int status;
+    void *ptr = clEnqueueMapBuffer(queue, buffer->buf, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, buffer->size, num_wait_events, wait_events,
+                                   NULL, &status);
+    checkError(status, "Failed to map host buffer");
+    // the mapping of a CL_MEM_USE_HOST_PTR buffer is the host memory itself
+    if (ptr != buffer->ptr)
+    {
+        checkError(CL_INVALID_HOST_PTR, "Host buffer mapped to a different address");
+    }
+    buffer->mapped = true;
+}
+
+void host_buffer_pool::release(host_buffer *buffer)
+{
+    buffer->in_use = false;
+}
+
+size_t host_buffer_pool::allocatedBytes() const
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+        bytes += buffers[i]->size;
+    }
+    return bytes;
+}
+
+cl_ulong getStartEndTime(cl_event event)
+{
+    return getStartEndTime(event, CL_PROFILING_COMMAND_START, CL_PROFILING_COMMAND_END);
+}
+
+cl_ulong getStartEndTime(cl_event event, cl_profiling_info start, cl_profiling_info end)
+{
+    cl_ulong start_time, end_time;
+    cl_int status;
+
+    status = clGetEventProfilingInfo(event, start, sizeof(start_time), &start_time, NULL);
+    checkError(status, "Failed to query event start time");
+    status = clGetEventProfilingInfo(event, end, sizeof(end_time), &end_time, NULL);
+    checkError(status, "Failed to query event end time");
+
+    return end_time - start_time;
+}
+
+double getCurrentTimestamp()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+} // namespace ocl_utils
@@ -0,0 +1,210 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "tensor_file.h"
+
+namespace
+{
+
+const char TENSOR_MAGIC[8] = {'P', '8', 'T', 'E', 'N', 'S', 'O', 'R'};
+const unsigned TENSOR_VERSION = 1;
+
+unsigned readU32(const unsigned char *bytes)
+{
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned)bytes[3] << 24);
+}
+
+uint64_t readU64(const unsigned char *bytes)
+{
+    return readU32(bytes) | ((uint64_t)readU32(bytes + 4) << 32);
+}
+
+void writeU32(unsigned char *bytes, unsigned value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+void writeU64(unsigned char *bytes, uint64_t value)
+{
+    writeU32(bytes, (unsigned)value);
+    writeU32(bytes + 4, (unsigned)(value >> 32));
+}
+
+} // namespace
+
+size_t tensorElementSize(const tensor_header &header)
+{
+    return header.nbits <= 8 ? 1 : header.nbits <= 16 ? 2 : 4;
+}
+
+size_t tensorElements(const tensor_header &header)
+{
+    size_t elements = 1;
+    for (unsigned i = 0; i < header.rank; i++)
+    {
+        elements *= header.dims[i];
+    }
+    return elements;
+}
+
+bool mapTensorFile(const char *path, mapped_tensor &tensor)
+{
+    memset(&tensor, 0, sizeof(tensor));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        printf("ERROR: Can not open tensor %s.\n", path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < TENSOR_FILE_HEADER_SIZE)
+    {
+        printf("ERROR: %s is not a tensor file.\n", path);
+        close(fd);
+        return false;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    void *map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        printf("ERROR: Can not map tensor %s.\n", path);
+        return false;
+    }
+    tensor.map = map;
+    tensor.map_size = info.st_size;
+
+    const unsigned char *bytes = (const unsigned char *)map;
+    tensor_header &header = tensor.header;
+    header.nbits = readU32(bytes + 12);
+    header.es = readU32(bytes + 16);
+    header.rank = readU32(bytes + 20);
+    for (int i = 0; i < TENSOR_FILE_MAX_RANK; i++)
+    {
+        header.dims[i] = readU32(bytes + 24 + 4 * i);
+    }
+    header.data_offset = readU64(bytes + 40);
+    header.data_size = readU64(bytes + 48);
+
+    // dimensions whose product overflows can not describe the data of the file
+    bool ok = header.rank <= TENSOR_FILE_MAX_RANK;
+    uint64_t elements = 1;
+    for (unsigned i = 0; ok && i < header.rank; i++)
+    {
+        ok = header.dims[i] > 0 && elements <= tensor.map_size / header.dims[i];
+        elements *= header.dims[i];
+    }
+    ok = ok && memcmp(bytes, TENSOR_MAGIC, 8) == 0 && readU32(bytes + 8) == TENSOR_VERSION && header.nbits >= 2 && header.nbits <= 32 &&
+              header.es >= 0 && header.rank >= 1 && header.rank <= TENSOR_FILE_MAX_RANK && header.data_offset % TENSOR_FILE_ALIGNMENT == 0 &&
+              header.data_offset <= tensor.map_size && header.data_size <= tensor.map_size - header.data_offset &&
+              header.data_size == tensorElements(header) * tensorElementSize(header);
+    if (!ok)
+    {
+        printf("ERROR: %s is not a valid tensor file.\n", path);
+        closeTensorFile(tensor);
+        return false;
+    }
+    tensor.data = (unsigned char *)map + header.data_offset;
+
+    // transfers read the data front to back
+    madvise(map, tensor.map_size, MADV_SEQUENTIAL);
+    return true;
+}
+
+bool createTensorFile(const char *path, int nbits, int es, unsigned rank, const unsigned *dims, mapped_tensor &tensor)
+{
+    memset(&tensor, 0, sizeof(tensor));
+    tensor_header &header = tensor.header;
+    header.nbits = nbits;
+    header.es = es;
+    header.rank = rank;
+    for (unsigned i = 0; i < TENSOR_FILE_MAX_RANK; i++)
+    {
+        header.dims[i] = i < rank ? dims[i] : 1;
+    }
+    header.data_offset = TENSOR_FILE_ALIGNMENT;
+    header.data_size = tensorElements(header) * tensorElementSize(header);
+
+    // a unique file in the directory of path, so the rename replaces the old file in one step
+    size_t path_length = strlen(path);
+    tensor.path = strdup(path);
+    tensor.temp_path = (char *)malloc(path_length + 8);
+    memcpy(tensor.temp_path, path, path_length);
+    memcpy(tensor.temp_path + path_length, ".XXXXXX", 8);
+    int fd = mkstemp(tensor.temp_path);
+    if (fd < 0)
+    {
+        printf("ERROR: Can not create tensor %s.\n", path);
+        free(tensor.temp_path);
+        tensor.temp_path = NULL;
+        closeTensorFile(tensor);
+        return false;
+    }
+    fchmod(fd, 0644);
+    tensor.map_size = header.data_offset + header.data_size;
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, tensor.map_size) == 0)
+    {
+        map = mmap(NULL, tensor.map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        printf("ERROR: Can not map tensor %s.\n", path);
+        closeTensorFile(tensor);
+        return false;
+    }
+    tensor.map = map;
+    tensor.writable = true;
+
+    unsigned char *bytes = (unsigned char *)map;
+    memcpy(bytes, TENSOR_MAGIC, 8);
+    writeU32(bytes + 8, TENSOR_VERSION);
+    writeU32(bytes + 12, nbits);
+    writeU32(bytes + 16, es);
+    writeU32(bytes + 20, rank);
+    for (int i = 0; i < TENSOR_FILE_MAX_RANK; i++)
+    {
+        writeU32(bytes + 24 + 4 * i, header.dims[i]);
+    }
+    writeU64(bytes + 40, header.data_offset);
+    writeU64(bytes + 48, header.data_size);
+    tensor.data = bytes + header.data_offset;
+    return true;
+}
+
+bool finishTensorFile(mapped_tensor &tensor)
+{
+    if (msync(tensor.map, tensor.map_size, MS_SYNC) != 0 || rename(tensor.temp_path, tensor.path) != 0)
+    {
+        printf("ERROR: Can not write tensor %s.\n", tensor.path);
+        return false;
+    }
+    free(tensor.temp_path);
+    tensor.temp_path = NULL;
+    return true;
+}
+
+void closeTensorFile(mapped_tensor &tensor)
+{
+    if (tensor.map)
+    {
+        munmap(tensor.map, tensor.map_size);
+    }
+    // an unfinished result, e.g. after an error, never shows up at path
+    if (tensor.temp_path)
+    {
+        unlink(tensor.temp_path);
+    }
+    free(tensor.path);
+    free(tensor.temp_path);
+    memset(&tensor, 0, sizeof(tensor));
+}
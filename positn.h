@@ -0,0 +1,312 @@
+// Generic posit<nbits, es> routines for C, C++ and OpenCL C, for 3 <= nbits <= 32 and es <= 4.
+//
+// The format is passed as nbits and es arguments to every routine. Called with constants (the
+// template parameters of Posit in posit.hpp, or POSIT_NBITS and POSIT_ES on the device) the
+// inlined code specializes to the format. Encodings are held in the low nbits of a 64 bit
+// integer. All operations work on an unpacked value with a 61 bit significand and share one
+// decode and one round routine, which rounds the concatenated regime, exponent and fraction
+// bits to nearest (ties to even) like roundToPosit8 in posit8.h.
+#ifndef POSITN_H
+#define POSITN_H
+
+#include "posit8.h"
+
+// position of the hidden bit in the unpacked significand, leaves two bits of headroom for sums
+#define POSITN_HIDDEN_BIT 61
+
+typedef posit8_u64 positn; // encoding in the low nbits
+
+// value is 2^scale * significand / 2^POSITN_HIDDEN_BIT, the significand is 0 for zero.
+// sticky is set if nonzero bits below the significand were dropped
+typedef struct positn_unpacked
+{
+    bool sign;
+    bool nar;
+    bool sticky;
+    int scale;
+    posit8_u64 significand;
+} positn_unpacked;
+
+POSIT8_FUNC POSIT8_CONSTEXPR positn narPositN(int nbits)
+{
+    return (positn)1 << (nbits - 1);
+}
+
+POSIT8_FUNC POSIT8_CONSTEXPR positn maskPositN(int nbits)
+{
+    return ((positn)1 << nbits) - 1;
+}
+
+POSIT8_FUNC POSIT8_CONSTEXPR positn negPositN(positn a, int nbits)
+{
+    return (~a + 1) & maskPositN(nbits);
+}
+
+POSIT8_FUNC POSIT8_CONSTEXPR positn_unpacked zeroPositN(void)
+{
+    positn_unpacked zero = {false, false, false, 0, 0};
+    return zero;
+}
+
+POSIT8_FUNC POSIT8_CONSTEXPR positn_unpacked unpackedNaRPositN(void)
+{
+    positn_unpacked nar = {false, true, false, 0, 0};
+    return nar;
+}
+
+POSIT8_FUNC POSIT8_CONSTEXPR positn_unpacked decodePositN(positn input, int nbits, int es)
+{
+    positn bits = input & maskPositN(nbits);
+    if (bits == 0)
+    {
+        return zeroPositN();
+    }
+    if (bits == narPositN(nbits))
+    {
+        return unpackedNaRPositN();
+    }
+
+    bool sign = (bits >> (nbits - 1)) & 0x1;
+    positn absolute = sign ? negPositN(bits, nbits) : bits;
+
+    // bits after the sign, aligned to the top. The zeros below stop the count of a run of ones
+    // and the body is never zero, so the regime run is at most nbits - 1 long
+    posit8_u64 body = absolute << (65 - nbits);
+    bool regimeBit = body >> 63;
+    int run = (int)POSIT8_CLZ64(regimeBit ? ~body : body);
+    int k = regimeBit ? run - 1 : -run;
+
+    // exponent and fraction follow the run and its terminating bit, missing bits are zero
+    posit8_u64 rest = body << (run + 1);
+    int exponent = es > 0 ? (int)(rest >> (64 - es)) : 0;
+    posit8_u64 fraction = rest << es;
+
+    positn_unpacked result = {sign, false, false, k * (1 << es) + exponent,
+                              ((posit8_u64)1 << POSITN_HIDDEN_BIT) | (fraction >> (64 - POSITN_HIDDEN_BIT))};
+    return result;
+}
+
+// moves the leading one of the significand to POSITN_HIDDEN_BIT, bits shifted out go to sticky
+POSIT8_FUNC POSIT8_CONSTEXPR positn_unpacked normalizePositN(positn_unpacked a)
+{
+    if (a.nar || a.significand == 0)
+    {
+        return a;
+    }
+    int shift = 63 - (int)POSIT8_CLZ64(a.significand) - POSITN_HIDDEN_BIT;
+    if (shift > 0)
+    {
+        a.sticky = a.sticky || (a.significand & (((posit8_u64)1 << shift) - 1)) != 0;
+        a.significand >>= shift;
+    }
+    else
+    {
+        a.significand <<= -shift;
+    }
+    a.scale += shift;
+    return a;
+}
+
+// rounds an unpacked value to the nearest posit<nbits, es> (ties to even). The regime, exponent and
+// fraction bits are concatenated aligned to the top of 64 bits and cut down to nbits - 1 bits.
+// Outside of maxpos and minpos the result saturates, posits never drop to zero
+POSIT8_FUNC POSIT8_CONSTEXPR positn roundPositN(positn_unpacked a, int nbits, int es)
+{
+    if (a.nar)
+    {
+        return narPositN(nbits);
+    }
+    if (a.significand == 0)
+    {
+        return 0;
+    }
+    a = normalizePositN(a);
+
+    // floor division, the exponent field is always positive
+    int k = a.scale >= 0 ? a.scale >> es : -((-a.scale + (1 << es) - 1) >> es);
+    int exponent = a.scale - k * (1 << es);
+    int maxK = nbits - 2;
+
+    // saturate at maxpos
+    positn result = maskPositN(nbits - 1);
+    if (k < -maxK)
+    {
+        // minpos
+        result = 1;
+    }
+    else if (k < maxK)
+    {
+        // regime of k + 1 ones and a zero, or -k zeros and a one
+        int regimeLength = k >= 0 ? k + 2 : -k + 1;
+        posit8_u64 regime = k >= 0 ? ~(posit8_u64)0 << (63 - k) : (posit8_u64)1 << (63 + k);
+
+        // fraction without the hidden bit, then the exponent in front of it
+        posit8_u64 fraction = a.significand << (64 - POSITN_HIDDEN_BIT);
+        posit8_u64 tail = fraction;
+        bool sticky = a.sticky;
+        if (es > 0)
+        {
+            tail = ((posit8_u64)exponent << (64 - es)) | (fraction >> es);
+            sticky = sticky || (fraction << (64 - es)) != 0;
+        }
+        posit8_u64 pattern = regime | (tail >> regimeLength);
+        sticky = sticky || (tail << (64 - regimeLength)) != 0;
+
+        // keep nbits - 1 bits, the bit below decides together with the sticky bits. k < maxK
+        // leaves a zero in the regime, so rounding up never carries past maxpos
+        result = pattern >> (65 - nbits);
+        bool roundBit = (pattern >> (64 - nbits)) & 0x1;
+        sticky = sticky || (pattern << nbits) != 0;
+        if (roundBit && (sticky || (result & 0x1)))
+        {
+            result += 1;
+        }
+    }
+    return a.sign ? negPositN(result, nbits) : result;
+}
+
+// exact product of two decoded (not accumulated) values, their significands have at most 31 bits
+POSIT8_FUNC POSIT8_CONSTEXPR positn_unpacked multUnpackedPositN(positn_unpacked a, positn_unpacked b)
+{
+    if (a.nar || b.nar)
+    {
+        return unpackedNaRPositN();
+    }
+    if (a.significand == 0 || b.significand == 0)
+    {
+        return zeroPositN();
+    }
+    // product of two significands with the hidden bit at 31 has its hidden bit at 62 or 63, its
+    // low bits are zero so shifting it back to 61 is exact
+    posit8_u64 product = (a.significand >> (POSITN_HIDDEN_BIT - 31)) * (b.significand >> (POSITN_HIDDEN_BIT - 31));
+    int carry = (int)(product >> 63);
+    positn_unpacked result = {a.sign != b.sign, false, false, a.scale + b.scale + carry, product >> (1 + carry)};
+    return result;
+}
+
+// sum of two normalized unpacked values (as returned by all routines here), the smaller one is
+// aligned and its dropped bits go to sticky
+POSIT8_FUNC POSIT8_CONSTEXPR positn_unpacked addUnpackedPositN(positn_unpacked a, positn_unpacked b)
+{
+    if (a.nar || b.nar)
+    {
+        return unpackedNaRPositN();
+    }
+    if (b.significand == 0)
+    {
+        return a;
+    }
+    if (a.significand == 0)
+    {
+        return b;
+    }
+    if (b.scale > a.scale || (b.scale == a.scale && b.significand > a.significand))
+    {
+        positn_unpacked swap = a;
+        a = b;
+        b = swap;
+    }
+
+    int shift = a.scale - b.scale;
+    posit8_u64 aligned = shift < 64 ? b.significand >> shift : 0;
+    bool lost = shift >= 64 ? true : shift > 0 && (b.significand << (64 - shift)) != 0;
+
+    positn_unpacked result = {a.sign, false, a.sticky || b.sticky || lost, a.scale, 0};
+    if (a.sign == b.sign)
+    {
+        result.significand = a.significand + aligned;
+    }
+    else
+    {
+        // the exact difference lies between a - aligned - 1 and a - aligned if bits were lost
+        result.significand = a.significand - aligned - (lost ? 1 : 0);
+    }
+    return normalizePositN(result);
+}
+
+POSIT8_FUNC POSIT8_CONSTEXPR positn addPositN(positn a, positn b, int nbits, int es)
+{
+    return roundPositN(addUnpackedPositN(decodePositN(a, nbits, es), decodePositN(b, nbits, es)), nbits, es);
+}
+
+POSIT8_FUNC POSIT8_CONSTEXPR positn subPositN(positn a, positn b, int nbits, int es)
+{
+    return addPositN(a, negPositN(b, nbits), nbits, es);
+}
+
+POSIT8_FUNC POSIT8_CONSTEXPR positn multPositN(positn a, positn b, int nbits, int es)
+{
+    return roundPositN(multUnpackedPositN(decodePositN(a, nbits, es), decodePositN(b, nbits, es)), nbits, es);
+}
+
+POSIT8_FUNC POSIT8_CONSTEXPR positn divPositN(positn a, positn b, int nbits, int es)
+{
+    positn_unpacked dividend = decodePositN(a, nbits, es);
+    positn_unpacked divisor = decodePositN(b, nbits, es);
+    if (dividend.nar || divisor.nar || divisor.significand == 0)
+    {
+        return narPositN(nbits);
+    }
+    if (dividend.significand == 0)
+    {
+        return 0;
+    }
+
+    // 31 bit significands, the quotient has 32 or 33 bits and the remainder becomes the sticky bit
+    posit8_u64 x = dividend.significand >> (POSITN_HIDDEN_BIT - 31);
+    posit8_u64 y = divisor.significand >> (POSITN_HIDDEN_BIT - 31);
+    posit8_u64 quotient = (x << 32) / y;
+    positn_unpacked result = {dividend.sign != divisor.sign, false, (x << 32) % y != 0, dividend.scale - divisor.scale,
+                              quotient << (POSITN_HIDDEN_BIT - 32)};
+    return roundPositN(result, nbits, es);
+}
+
+// fused multiply add, computes a * b + c with a single rounding
+POSIT8_FUNC POSIT8_CONSTEXPR positn fmaPositN(positn a, positn b, positn c, int nbits, int es)
+{
+    positn_unpacked product = multUnpackedPositN(decodePositN(a, nbits, es), decodePositN(b, nbits, es));
+    return roundPositN(addUnpackedPositN(product, decodePositN(c, nbits, es)), nbits, es);
+}
+
+// dot product step: adds the exact product a * b to the unpacked accumulator. Unlike quire8 the
+// accumulator keeps 61 significant bits instead of all of them, which is far beyond the fraction
+// of every supported format, and the sum is rounded once by roundPositN at the end
+POSIT8_FUNC POSIT8_CONSTEXPR void fdpPositN(positn_unpacked *acc, positn a, positn b, int nbits, int es)
+{
+    *acc = addUnpackedPositN(*acc, multUnpackedPositN(decodePositN(a, nbits, es), decodePositN(b, nbits, es)));
+}
+
+#if POSIT8_HAS_DOUBLE
+// nearest posit<nbits, es>, infinity and nan become NaR
+POSIT8_FUNC positn doubleToPositN(double input, int nbits, int es)
+{
+    if (isnan(input) || isinf(input))
+    {
+        return narPositN(nbits);
+    }
+    if (input == 0)
+    {
+        return 0;
+    }
+    int exponent = 0;
+    double mantissa = frexp(fabs(input), &exponent);
+
+    // the 53 bit mantissa in [0.5, 1) fits the unpacked significand exactly
+    positn_unpacked value = {input < 0, false, false, exponent - 1, (posit8_u64)ldexp(mantissa, POSITN_HIDDEN_BIT + 1)};
+    return roundPositN(value, nbits, es);
+}
+
+// every posit<nbits, es> with nbits <= 32 is exact as double, NaR becomes NaN
+POSIT8_FUNC double positNToDouble(positn input, int nbits, int es)
+{
+    positn_unpacked value = decodePositN(input, nbits, es);
+    if (value.nar)
+    {
+        return NAN;
+    }
+    double magnitude = ldexp((double)value.significand, value.scale - POSITN_HIDDEN_BIT);
+    return value.sign ? -magnitude : magnitude;
+}
+#endif
+
+#endif
@@ -1 +1 @@
-gcc device.c -o device.out -lm
+gcc -O2 -pthread device.c -o device.out -lm
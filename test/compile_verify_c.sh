@@ -0,0 +1,3 @@
+gcc -O2 -pthread verify.c -o verify.out -lm
+gcc -O2 verify_codec.c -o verify_codec.out -lm
+gcc -O2 verify_vector.c -o verify_vector.out -lm
@@ -0,0 +1,2 @@
+g++ -std=c++17 -O2 verify_posit8.cpp -o verify_posit8.out
+g++ -std=c++17 -O2 verify_positn.cpp -o verify_positn.out
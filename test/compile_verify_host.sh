@@ -0,0 +1,4 @@
+# cpu_gemm.cpp needs no OpenCL
+g++ -std=c++11 -O2 -I.. -I../posit_matrix_mult_opencl/host/inc verify_cpu_gemm.cpp ../posit_matrix_mult_opencl/host/src/cpu_gemm.cpp -o verify_cpu_gemm.out -lpthread
+# needs the OpenCL headers and ICD loader (e.g. ocl-icd-opencl-dev), the buffer calls are replaced so no device is used
+g++ -std=c++11 -O2 -DCL_TARGET_OPENCL_VERSION=120 -DCL_USE_DEPRECATED_OPENCL_1_2_APIS -I../posit_matrix_mult_opencl/host/inc verify_host_pool.cpp ../posit_matrix_mult_opencl/host/src/opencl_utils.cpp -o verify_host_pool.out -lOpenCL
@@ -1,719 +1,129 @@
-#include <math.h>
-#include <stdio.h>
-#include <stdbool.h>
-#include <string.h>
-#include <stdlib.h>
+// command line front end of the posit8 library, used by python_posits.py
+#include "../posit.c"
+#include <time.h>
 
-#define MAX(x, y) (((x) > (y)) ? (x) : (y))
-#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+// microbenchmark of the scalar operations (mode -3): every operation is called for all
+// 256 x 256 operand pairs per round, the results are summed up so the calls are not optimized away.
+// Reports the best and the median of MICROBENCH_SAMPLES samples in ns per call.
+#define MICROBENCH_SAMPLES 7
 
-typedef unsigned char posit8; // posit with 8 bits and exponent size 0
+static volatile unsigned int microbenchSink;
 
-typedef struct posit_values
+double microbenchNow()
 {
-    bool sign;
-    int k;
-    unsigned char exp;
-    unsigned char frac;
-    unsigned char fracLength;
-
-    bool inf;
-    bool zero;
-} posit_values;
-
-
-int clz(char c)
-{
-    unsigned int n = 0;
-    if (c == 0)
-        return 8;
-
-    if ((c & 0xF0) == 0)
-    {
-        n = n + 4;
-        c = c << 4;
-    }
-    if ((c & 0xC0) == 0)
-    {
-        n = n + 2;
-        c = c << 2;
-    }
-    if ((c & 0x80) == 0)
-    {
-        n = n + 1;
-    }
-    return n;
-}
-
-void printBits(size_t const size, void const *const ptr)
-{
-    unsigned char *b = (unsigned char *)ptr;
-    unsigned char byte;
-    int i, j;
-
-    for (i = size - 1; i >= 0; i--)
-    {
-        for (j = 7; j >= 0; j--)
-        {
-            byte = (b[i] >> j) & 1;
-            printf("%u", byte);
-        }
-    }
-    puts("");
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
 }
 
-posit8 twosComplement(posit8 input)
+int compareDouble(const void *a, const void *b)
 {
-    input = ~input;
-    input = input + 1;
-    return input;
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
 }
 
-void extractPositValues(posit8 input, posit_values *output)
+void microbenchReport(const char *op, double *seconds, double calls, bool json, bool *first)
 {
-    output->exp = 0x0; //allways zero by definition
-
-    if (input == 0x0)
-    {
-        output->zero = true;
-        output->inf = false;
-        output->sign = false;
-        output->k = 0;
-        output->frac = 0x0;
-        output->fracLength = 0;
-    }
-    else if (input == 0x80)
-    {
-        output->zero = false;
-        output->inf = true;
-        output->sign = true;
-        output->k = 0;
-        output->frac = 0x0;
-        output->fracLength = 0;
-    }
-    else
-    {
-        output->sign = input >> 7;
-        // if negative make two's complement
-        if (output->sign)
-        {
-            input = twosComplement(input);
-        }
-
-        // regime bits consisting of zeros
-        int regime_bits = clz(input << 1);
-        output->k = -1 * regime_bits;
-
-        if (regime_bits == 0)
-        {
-            // regime bits consisting of ones
-            unsigned char temp = ~(input << 1); // make bitshift before inverting for all-1-case
-            regime_bits = clz(temp);
-            output->k = regime_bits - 1;
-        }
+    qsort(seconds, MICROBENCH_SAMPLES, sizeof(double), compareDouble);
+    double bestNs = seconds[0] / calls * 1e9;
+    double medianNs = seconds[MICROBENCH_SAMPLES / 2] / calls * 1e9;
 
-        // flush sign and regime
-        if (regime_bits < 7)
-        {
-            output->fracLength = 8 - (regime_bits + 2); //mask all the regime bits (regime_bits + 1) + the sign bit (1)
-        }
-        else
-        {
-            output->fracLength = 0;
-        }
-        if (output->fracLength > 0)
-        {
-            unsigned char mask = ((1 << output->fracLength) - 1);
-            output->frac = input & mask;
-        }
-        else
-        {
-            output->frac = 0x0;
-        }
-    }
-}
-
-void posit8ToDouble(posit8 posit, double *output)
-{
-    posit_values pval;
-    extractPositValues(posit, &pval);
-    double fraction_max = pow(2, pval.fracLength);
-    double fracVal = 1 + ((double)pval.frac / fraction_max);
-    if (posit == 0x0)
-    {
-        *output = 0;
-    }
-    else
-    {
-        *output = pow(-1, pval.sign) * pow(2, pval.k) * fracVal;
-    }
-}
-
-char convertFraction(double doubleFraction, unsigned int fracLength)
-{
-    char positFraction = 0x0;
-    unsigned int fracCounter = fracLength;
-    double temp = 1;
-    while (fracCounter > 0)
-    {
-        temp /= 2;
-
-        if (doubleFraction >= temp)
-        {
-            // shift in 1
-            positFraction <<= 1;
-            positFraction += 1;
-            doubleFraction -= temp;
-        }
-        else
-        {
-            // shift in 0
-            positFraction <<= 1;
-        }
-        fracCounter--;
-    }
-    return positFraction;
-}
-
-void doubleToPosit8(double doubleInput, posit8 *out)
-{
-    char output = 0x0;
-    unsigned int sign;
-    unsigned int regimeLength;
-    double tempDoubleInput;
-    unsigned int regimeIsOnes;
-    // extract sign
-    (doubleInput >= 0) ? (sign = 0) : (sign = 1);
-
-    if (doubleInput == 0)
-    {
-        // check for zero
-        output = 0;
-    }
-    else if (isinf(doubleInput) || isnan(doubleInput))
-    {
-        // check for infinity
-        output = 0x80;
-    }
-    else if (doubleInput >= 64)
-    {
-        // check for maxpos
-        output = 0x7F;
-    }
-    else if (doubleInput <= -64)
-    {
-        // check for minpos
-        output = 0x81;
-    }
-    else if (doubleInput <= 0.015625 && !sign)
+    if (json)
     {
-        // check for +minpos
-        output = 0x1;
-    }
-    else if (doubleInput >= -0.015625 && sign)
-    {
-        // check for -minpos
-        output = 0xFF;
+        printf("%s  {\"op\": \"%s\", \"calls\": %.0f, \"best_ns\": %f, \"median_ns\": %f, \"mops\": %f}",
+               *first ? "" : ",\n", op, calls, bestNs, medianNs, 1e3 / bestNs);
     }
     else
     {
-        if (sign)
-        {
-            // Make negative numbers positive for easier computation
-            doubleInput = -doubleInput;
-        }
-
-        tempDoubleInput = doubleInput;
-
-        // check if regime is composed of ones
-        if (doubleInput > 1 || doubleInput < -1)
-        {
-            regimeIsOnes = 1;
-            regimeLength = 1; // because k = m - 1 we need to add one
-            while (tempDoubleInput >= 2)
-            {
-                tempDoubleInput /= 2;
-                regimeLength++;
-            }
-        }
-        // regime is composed of zeros
-        else
-        {
-            regimeIsOnes = 0;
-            regimeLength = 0; // because k = m
-            while (tempDoubleInput < 1)
-            {
-                tempDoubleInput *= 2;
-                regimeLength++;
-            }
-        }
-
-        double doubleFraction = tempDoubleInput - 1; // remove hidden bit (1.0101010)
-        unsigned int fracLength = 6 - regimeLength;
-        char positFraction = convertFraction(doubleFraction, fracLength);
-
-        output = 0x0;
-
-        for (int i = 0; i < regimeLength; i++)
-        {
-            output = (output << 1) + regimeIsOnes;
-        }
-        output = (output << 1) + !regimeIsOnes;
-        output = (output << fracLength);
-        output |= positFraction;
-
-        if (sign)
-        {
-            output = twosComplement(output);
-        }
+        printf("%s,%.0f,%f,%f,%f\n", op, calls, bestNs, medianNs, 1e3 / bestNs);
     }
-    *out = output;
+    *first = false;
 }
 
-char kToRegime(int k)
-{
-    if (k >= 6)
-    {
-        // regime is only 1s
-        return (1 << 7) - 1;
-    }
-    if (k <= -7)
-    {
-        // regime is only 0s
-        return 0x0;
-    }
-    if (k >= 0)
-    {
-        // k is positive, regime consists of 1s ending in 0
-        return (1 << (k + 2)) - 2;
+// x is the first operand, b the second one (or the only one of unary operations).
+// x changes with the round, so the compiler can not hoist the rounds out of the loop.
+#define MICROBENCH(op, body)                                                       \
+    {                                                                              \
+        double seconds[MICROBENCH_SAMPLES];                                        \
+        for (int s = 0; s < MICROBENCH_SAMPLES; s++)                               \
+        {                                                                          \
+            unsigned int sink = 0;                                                 \
+            double start = microbenchNow();                                        \
+            for (unsigned int r = 0; r < rounds; r++)                              \
+            {                                                                      \
+                for (unsigned int a = 0; a < 256; a++)                             \
+                {                                                                  \
+                    posit8 x = a ^ (r & 0xFF);                                     \
+                    for (unsigned int b = 0; b < 256; b++)                         \
+                    {                                                              \
+                        body                                                       \
+                    }                                                              \
+                }                                                                  \
+            }                                                                      \
+            seconds[s] = microbenchNow() - start;                                  \
+            microbenchSink ^= sink;                                                \
+        }                                                                          \
+        microbenchReport(op, seconds, (double)rounds * 256 * 256, json, &first);   \
     }
-    // k is negative and regime ends therefore with 1
-    return 0x1;
-}
 
-int regimeLengthFromK(int k, int positSize)
+void runMicrobenchmark(unsigned int rounds, bool json)
 {
-    int result = 0;
+    bool first = true;
 
-    if (k >= 0)
+    // inputs of the conversions, most of them are not representable and have to be rounded
+    double doubles[256];
+    float floats[256];
+    unsigned short halfs[256];
+    quire8 quires[256];
+    for (unsigned int i = 0; i < 256; i++)
     {
-        result = k + 2;
-    }
-    else if (k < 0)
-    {
-        result = -k + 1;
+        doubles[i] = ((double)i - 128) / 16.0 + 1.0 / 3.0;
+        floats[i] = doubles[i];
+        halfs[i] = 0x2000 + i * 0x50; // 2^-7 up to about 2^5, both signs are covered by the other conversions
+        posit8ToQuire8(i == 0x80 ? 0x0 : i, &quires[i]);
+        fdpPosit8(&quires[i], 0x45, i ^ 0x5A);
     }
+    initPosit8Lut();
 
-    if (result > positSize - 1)
+    if (json)
     {
-        result = positSize - 1;
-    }
-    return result;
-}
-
-void addHiddenBitToFraction(posit_values *a)
-{
-    char hiddenBit = 0x1;
-    hiddenBit <<= a->fracLength;
-    a->frac |= hiddenBit;
-}
-
-void multPosit8(posit8 a, posit8 b, posit8 *result)
-{
-    *result = 0x0;
-    if (a == 0x0)
-    {
-        *result = 0x0;
-    }
-    else if (b == 0x0)
-    {
-        *result = 0x0;
-    }
-    else if (a == 0x80 || b == 0x80)
-    {
-        *result = 0x80;
+        printf("[\n");
     }
     else
     {
-        // extracting posit values
-        posit_values valuesA;
-        extractPositValues(a, &valuesA);
-        posit_values valuesB;
-        extractPositValues(b, &valuesB);
-        bool sign = valuesA.sign ^ valuesB.sign;
-
-        // adding scales of a and b
-        int newK = valuesA.k + valuesB.k;
-
-        // adding hidden bit to fraction
-        addHiddenBitToFraction(&valuesA);
-        addHiddenBitToFraction(&valuesB);
-
-        // keeping track of shift value for position of hidden bit
-        int fracLength;
-
-        // shifting the mantissa of the smaller factor so both are of equal scaling
-        if (valuesA.fracLength > valuesB.fracLength)
-        {
-            valuesB.frac <<= valuesA.fracLength - valuesB.fracLength;
-            //fracLength = 2 * valuesA.fracLength;
-            fracLength = valuesA.fracLength << 1;
-        }
-        else
-        {
-            valuesA.frac <<= valuesB.fracLength - valuesA.fracLength;
-            //fracLength = 2 * valuesB.fracLength;
-            fracLength = valuesB.fracLength << 1;
-        }
-
-        // calculating product of aligned mantissas
-        unsigned int intResult = valuesA.frac * valuesB.frac;
-
-        {
-            if (intResult >> fracLength + 1 > 0)
-            {
-                newK++;
-                fracLength++;
-            }
-
-            if (fracLength > 0)
-            {
-                // mask hidden bit
-                intResult &= 0xffffffff >> 32 - fracLength;
-            }
-            else
-            {
-                intResult = 0x0;
-            }
-        }
-
-        int newRegimeLength = regimeLengthFromK(newK, 8);
-        int resultFracLength = 8 - newRegimeLength - 1;
-
-        unsigned int carryCondition = intResult & 0xffffffff >> 32 - (fracLength - resultFracLength);
-        bool carryBit = 0;
-
-        // check if rest of mantissa that is not used in new posit is bigger than (0.)100
-        // if so carry bit is one and will be added in the end
-        if ((fracLength - resultFracLength) > 1 && carryCondition > (0x1 << (fracLength - resultFracLength) - 1))
-        {
-            carryBit = 1;
-        }
-
-        // determine new regime length
-        newRegimeLength = regimeLengthFromK(newK, 8);
-
-        // transform k value to regime bits
-        char newRegime = kToRegime(newK);
-
-        // calculate length of mantissa bits
-        resultFracLength = 8 - newRegimeLength - 1;
-        int fracShift = fracLength - resultFracLength;
-        unsigned char newFrac;
-        if (fracShift > 0)
-        {
-            newFrac = intResult >> fracShift;
-        }
-        else
-        {
-            newFrac = intResult << -fracShift;
-        }
-
-        *result |= newRegime << resultFracLength;
-
-        if (resultFracLength > 0)
-        {
-            *result |= newFrac;
-        }
-
-        if (*result != 0x7f && (carryBit || ((*result & 0x1) == 1 && carryCondition == (0x1 << (fracLength - resultFracLength) - 1))))
-        {
-            *result += 1;
-        }
-
-        // per definition posits never drop to zero
-        if (*result == 0x0)
-        {
-            *result = 0x1;
-        }
-        if (sign)
-        {
-            *result = twosComplement(*result);
-        }
-    }
-}
-
-void divPosit8(posit8 a, posit8 b, posit8 *result)
-{
-    *result = 0x0;
-    if (a == 0x0)
-    {
-        *result = 0x0;
+        printf("op,calls,best_ns,median_ns,mops\n");
     }
-    else if (b == 0x0)
-    {
-        *result = NAN;
-    }
-    else if (a == 0x80 || b == 0x80)
-    {
-        *result = 0x80;
-    }
-    else
-    {
-        // extracting posit values
-        posit_values valuesA;
-        extractPositValues(a, &valuesA);
-        posit_values valuesB;
-        extractPositValues(b, &valuesB);
-        bool sign = valuesA.sign ^ valuesB.sign;
-
-        // subtracting scales of a and b
-        int newK = valuesA.k - valuesB.k;
-
-        // adding hidden bit to fraction
-        addHiddenBitToFraction(&valuesA);
-        addHiddenBitToFraction(&valuesB);
-
-        valuesB.frac <<= 7 - valuesB.fracLength;
-        valuesA.frac <<= 7 - valuesA.fracLength;
-
-        unsigned int dividend = valuesA.frac << 7;
-
-        unsigned int quot = dividend / valuesB.frac;
-        unsigned int rem = dividend % valuesB.frac;
-
-        if (quot != 0)
-        {
-            bool rcarry = quot >> 7; // this is the hidden bit (7th bit) , extreme right bit is bit 0
-            if (!rcarry)
-            {
-                newK--;
-                quot <<= 1;
-            }
-        }
 
-        // determine new regime length
-        unsigned int newRegimeLength = regimeLengthFromK(newK, 8);
+    posit8 out;
+    double value;
+    quire8 q;
 
-        // transform k value to regime bits
-        char newRegime = kToRegime(newK);
+    MICROBENCH("decodePosit8", posit8_decoded d = decodePosit8(x ^ b); sink += d.significand + d.scale;)
+    MICROBENCH("posit8ToDouble", posit8ToDouble(x ^ b, &value); sink += (int)(value * 64);)
+    MICROBENCH("doubleToPosit8", doubleToPosit8(doubles[x ^ b], &out); sink += out;)
+    MICROBENCH("floatToPosit8", floatToPosit8(floats[x ^ b], &out); sink += out;)
+    MICROBENCH("halfToPosit8", halfToPosit8(halfs[x ^ b], &out); sink += out;)
+    MICROBENCH("addPosit8", addPosit8(x, b, &out); sink += out;)
+    MICROBENCH("subPosit8", subPosit8(x, b, &out); sink += out;)
+    MICROBENCH("multPosit8", multPosit8(x, b, &out); sink += out;)
+    MICROBENCH("divPosit8", divPosit8(x, b, &out); sink += out;)
+    MICROBENCH("sigmoidPosit8", out = x ^ b; sigmoidPosit8(&out); sink += out;)
+    MICROBENCH("posit8ToQuire8", posit8ToQuire8(x ^ b, &q); sink += (unsigned int)q;)
+    MICROBENCH("fdpPosit8", q = quires[b]; fdpPosit8(&q, x, b); sink += (unsigned int)q;)
+    MICROBENCH("quire8ToPosit8", quire8ToPosit8(quires[x ^ b], &out); sink += out;)
+    MICROBENCH("fmaPosit8", fmaPosit8(x, b, x ^ 0x35, &out); sink += out;)
+    MICROBENCH("addPosit8Lut", addPosit8Lut(x, b, &out); sink += out;)
+    MICROBENCH("subPosit8Lut", subPosit8Lut(x, b, &out); sink += out;)
+    MICROBENCH("multPosit8Lut", multPosit8Lut(x, b, &out); sink += out;)
+    MICROBENCH("divPosit8Lut", divPosit8Lut(x, b, &out); sink += out;)
 
-        int resultFracLength = 8 - newRegimeLength - 1;
-
-        newRegime <<= resultFracLength;
-
-        *result = newRegime;
-
-        int scale;
-        if (newK < 0)
-        {
-            scale = -newK;
-        }
-        else
-        {
-            scale = newK + 1;
-        }
-
-        quot &= 0x7F;
-        unsigned char newFrac = quot;
-        newFrac >>= scale + 1;
-
-        *result |= newFrac;
-
-        bool guard = (bool)(0x1 & quot >> scale);
-        if (guard)
-        {
-            bool roundSticky = (((1 << scale) - 1) & quot) ? 1 : 0;
-            if (rem > 0 || roundSticky || ((*result & 0x1) == 1 && !roundSticky))
-            {
-                *result += 1;
-            }
-        }
-
-        if (*result == 0x0)
-        {
-            *result = 0x1;
-        }
-
-        if (sign)
-        {
-            *result = twosComplement(*result);
-        }
-    }
-}
-
-void addPosit8(posit8 a, posit8 b, posit8 *result)
-{
-    *result = 0x0;
-    if (a == 0x0)
-    {
-        *result = b;
-    }
-    else if (b == 0x0)
+    if (json)
     {
-        *result = a;
-    }
-    else if (a == 0x80 || b == 0x80)
-    {
-        *result = 0x80;
-    }
-    else if (twosComplement(a) == b)
-    {
-        *result = 0x0;
-    }
-    else
-    {
-
-        posit_values valuesA;
-        extractPositValues(a, &valuesA);
-        posit_values valuesB;
-        extractPositValues(b, &valuesB);
-
-        bool newSign = 0;
-
-        posit8 compA = a;
-        if (valuesA.sign == 1)
-        {
-            compA = twosComplement(a);
-        }
-
-        posit8 compB = b;
-        if (valuesB.sign == 1)
-        {
-            compB = twosComplement(b);
-        }
-        newSign = (compA > compB) ? valuesA.sign : valuesB.sign;
-
-        // compute scale factor
-        int newK = valuesA.k;
-        addHiddenBitToFraction(&valuesA);
-        addHiddenBitToFraction(&valuesB);
-
-        if (valuesA.k > valuesB.k)
-        {
-            valuesB.fracLength += valuesA.k - valuesB.k;
-            newK = valuesA.k;
-        }
-        else if (valuesA.k < valuesB.k)
-        {
-            valuesA.fracLength += valuesB.k - valuesA.k;
-            newK = valuesB.k;
-        }
-
-        int fracLength;
-        unsigned int fracA, fracB;
-        if (valuesA.fracLength > valuesB.fracLength)
-        {
-            fracB = valuesB.frac << valuesA.fracLength - valuesB.fracLength;
-            fracA = valuesA.frac;
-            fracLength = valuesA.fracLength;
-        }
-        else
-        {
-            fracA = valuesA.frac << valuesB.fracLength - valuesA.fracLength;
-            fracB = valuesB.frac;
-            fracLength = valuesB.fracLength;
-        }
-        unsigned int tempFrac;
-
-        if (valuesA.sign == valuesB.sign)
-        {
-            tempFrac = fracA + fracB;
-        }
-        else
-        {
-            if (fracA > fracB)
-            {
-                tempFrac = fracA - fracB;
-            }
-
-            else
-            {
-                tempFrac = fracB - fracA;
-            }
-        }
-
-        {
-            if (tempFrac >> fracLength + 1 > 0)
-            {
-                newK++;
-                fracLength++;
-            }
-            else
-            {
-                while (tempFrac >> fracLength == 0 && fracLength > 0)
-                {
-                    newK--;
-                    fracLength--;
-                }
-            }
-
-            if (fracLength > 0)
-            {
-                // mask hidden bit
-                tempFrac &= 0xffffffff >> 32 - fracLength;
-            }
-            else
-            {
-                tempFrac = 0x0;
-            }
-        }
-
-        int newRegimeLength = regimeLengthFromK(newK, 8);
-        int resultFracLength = 8 - newRegimeLength - 1;
-        int fractionShiftValue = fracLength - resultFracLength;
-
-        unsigned int cond = tempFrac & (0xffffffff >> 32 - (fracLength - resultFracLength));
-
-        bool carryBit = 0;
-        if ((fracLength - resultFracLength) > 0 && cond > (0x1 << (fracLength - resultFracLength) - 1))
-        {
-            carryBit = 1;
-        }
-        char newRegime = kToRegime(newK);
-        unsigned char newFrac = tempFrac;
-
-        *result = 0x0 << 7;
-        *result |= newRegime << resultFracLength;
-
-        if (resultFracLength > 0)
-        {
-            if (fractionShiftValue > 0)
-            {
-                *result |= (tempFrac >> fractionShiftValue);
-            }
-            else
-            {
-                *result |= (tempFrac << -fractionShiftValue);
-            }
-        }
-
-        if (carryBit || (((*result & 0x1) == 1 && cond == (0x1 << (fracLength - resultFracLength) - 1)) && *result != 0x7f))
-        {
-            *result += 1;
-        }
-
-        if (newSign == 1)
-        {
-            *result = twosComplement(*result);
-        }
+        printf("\n]\n");
     }
 }
 
-void subPosit8(posit8 a, posit8 b, posit8 *result)
-{
-    *result = 0x0;
-    posit8 negative = twosComplement(b);
-    addPosit8(a, negative, result);
-}
-
-void sigmoidPosit8(posit8 *x)
-{
-    *x = *x ^ (1 << 7);
-    *x >>= 2;
-}
-
-
 void main(int argc, char *argv[])
 {
     double doubleInputA;
@@ -724,6 +134,17 @@ void main(int argc, char *argv[])
 
     sscanf(argv[1], "%d", &mode);
 
+    if (mode == -3)
+    {
+        // microbenchmark: ./device.out -3 [rounds] [csv|json]
+        unsigned int rounds = 20;
+        if (argc > 2)
+        {
+            sscanf(argv[2], "%u", &rounds);
+        }
+        runMicrobenchmark(rounds, argc > 3 && strcmp(argv[3], "json") == 0);
+        return;
+    }
 
     if (argc > 2)
     {
@@ -0,0 +1,36 @@
+// Writes posit8_tables.h, the operation tables of posit8.hpp, from the constexpr reference
+// arithmetic in posit8_detail. Run it after changing that arithmetic:
+//   g++ -std=c++17 -O2 generate_posit8_tables.cpp -o generate_posit8_tables.out && ./generate_posit8_tables.out > ../posit8_tables.h
+// verify_posit8 checks that the checked in tables still match the reference.
+#include <cstdio>
+#include "../posit8.hpp"
+
+void printTable(const char *name, posit8 (*op)(posit8, posit8))
+{
+    printf("inline constexpr op_table %s = {{\n", name);
+    for (unsigned i = 0; i < 256 * 256; i++)
+    {
+        printf("%s0x%02X,%s", i % 16 == 0 ? "    " : "", op(i >> 8, i & 0xFF), i % 16 == 15 ? "\n" : " ");
+    }
+    printf("}};\n");
+}
+
+int main()
+{
+    printf("// Generated by test/generate_posit8_tables.cpp, do not edit.\n");
+    printf("//\n");
+    printf("// Results of +, * and / of posit8.hpp for all operand pairs, indexed by (a << 8) | b like the\n");
+    printf("// tables of posit.c. Literal arrays compile much faster than evaluating the reference arithmetic\n");
+    printf("// of posit8_detail 65536 times per table in every translation unit.\n");
+    printf("#ifndef POSIT8_TABLES_H\n");
+    printf("#define POSIT8_TABLES_H\n\n");
+    printf("namespace posit8_detail\n{\n\n");
+    printf("// a - b is a + (-b) and negation is exact, so subtraction shares the table of addition\n");
+    printTable("addTable", posit8_detail::add);
+    printf("\n");
+    printTable("multTable", posit8_detail::mult);
+    printf("\n");
+    printTable("divTable", posit8_detail::div);
+    printf("\n} // namespace posit8_detail\n\n#endif\n");
+    return 0;
+}
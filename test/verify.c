@@ -0,0 +1,556 @@
+// Exhaustive in-process verification of posit.c: every operation is checked for all operand
+// pairs (all triples for fmaPosit8) against an exact reference. The reference takes the value
+// of every posit8 from the golden table 8_bit.csv, computes the result exactly in double and
+// rounds it to the nearest posit8 by value, ties to the even bit pattern, never to zero and
+// saturating at maxpos, the same rounding SoftPosit uses. sigmoidPosit8 is an approximation by
+// definition and not checked.
+// Build with compile_verify_c.sh and run ./verify.out [8_bit.csv], it exits with 1 on mismatches.
+#include "../posit.c"
+#include "verify_check.h"
+#include <pthread.h>
+#include <time.h>
+
+static double goldenValues[256]; // NAN for NaR
+static bool goldenLoaded[256];
+
+// operation that is currently checked, its counts are the difference to the ones at its start
+static const char *currentOp;
+static unsigned long long opFirstCheck;
+static unsigned long long opFirstMismatch;
+static double opStart;
+
+double nowMs()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec * 1e-6;
+}
+
+bool loadGoldenValues(const char *fileName)
+{
+    FILE *file = fopen(fileName, "r");
+    if (file == NULL)
+    {
+        printf("ERROR: Unable to open %s.\n", fileName);
+        return false;
+    }
+
+    double value;
+    char bits[9];
+    while (fscanf(file, "%lf,%8s", &value, bits) == 2)
+    {
+        unsigned int pattern = strtoul(bits, NULL, 2);
+        goldenValues[pattern] = value;
+        goldenLoaded[pattern] = true;
+    }
+    fclose(file);
+
+    // NaR is the only pattern without a real value
+    goldenValues[0x80] = NAN;
+    goldenLoaded[0x80] = true;
+    for (unsigned int i = 0; i < 256; i++)
+    {
+        if (!goldenLoaded[i])
+        {
+            printf("ERROR: %s has no value for pattern 0x%02X.\n", fileName, i);
+            return false;
+        }
+    }
+    return true;
+}
+
+// reference rounding of an exact (or correctly rounded) result to posit8
+posit8 referenceRound(double value)
+{
+    if (isnan(value) || isinf(value))
+    {
+        return 0x80;
+    }
+    if (value == 0.0)
+    {
+        return 0x0;
+    }
+
+    double magnitude = fabs(value);
+    posit8 result;
+    if (magnitude >= goldenValues[0x7F])
+    {
+        result = 0x7F;
+    }
+    else if (magnitude <= goldenValues[0x01])
+    {
+        result = 0x01;
+    }
+    else
+    {
+        // positive patterns are ordered by value, binary search for the two neighbours of magnitude
+        unsigned int lo = 0x01;
+        unsigned int hi = 0x7F;
+        while (hi - lo > 1)
+        {
+            unsigned int mid = (lo + hi) / 2;
+            if (goldenValues[mid] <= magnitude)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        double below = magnitude - goldenValues[lo];
+        double above = goldenValues[hi] - magnitude;
+        if (below < above || (below == above && (lo & 0x1) == 0))
+        {
+            result = lo;
+        }
+        else
+        {
+            result = hi;
+        }
+    }
+    return value < 0 ? twosComplement(result) : result;
+}
+
+double halfToDouble(unsigned short half)
+{
+    int exponent = (half >> 10) & 0x1F;
+    int mantissa = half & 0x3FF;
+    double value;
+    if (exponent == 0x1F)
+    {
+        value = mantissa ? NAN : INFINITY;
+    }
+    else if (exponent == 0)
+    {
+        value = ldexp(mantissa, -24);
+    }
+    else
+    {
+        value = ldexp(mantissa | 0x400, exponent - 25);
+    }
+    return (half & 0x8000) ? -value : value;
+}
+
+void beginOp(const char *op)
+{
+    currentOp = op;
+    opFirstCheck = checks;
+    opFirstMismatch = mismatches;
+    opStart = nowMs();
+    resetReported();
+}
+
+void endOp()
+{
+    printf("%-28s %10llu checks %8llu mismatches %8.2f ms\n", currentOp, checks - opFirstCheck, mismatches - opFirstMismatch,
+           nowMs() - opStart);
+}
+
+// operands describes the inputs of the failed check, e.g. "a=0x41 b=0x7F"
+void check(posit8 got, posit8 expected, const char *operands)
+{
+    if (countCheck(got == expected))
+    {
+        printf("  %s(%s): got 0x%02X, expected 0x%02X\n", currentOp, operands, got, expected);
+    }
+}
+
+typedef void (*binary_op)(posit8 a, posit8 b, posit8 *result);
+
+void checkBinaryOp(const char *op, binary_op function, char symbol)
+{
+    beginOp(op);
+    for (unsigned int a = 0; a < 256; a++)
+    {
+        for (unsigned int b = 0; b < 256; b++)
+        {
+            double x = goldenValues[a];
+            double y = goldenValues[b];
+            // sums, differences and products of two posit8 are exact in double, quotients
+            // are never close enough to a rounding boundary for the double rounding to matter
+            double exact = symbol == '+' ? x + y : symbol == '-' ? x - y : symbol == '*' ? x * y : x / y;
+
+            posit8 got;
+            function(a, b, &got);
+            posit8 expected = referenceRound(exact);
+            char operands[32];
+            if (got != expected)
+            {
+                snprintf(operands, sizeof(operands), "a=0x%02X b=0x%02X", a, b);
+            }
+            check(got, expected, operands);
+        }
+    }
+    endOp();
+}
+
+// every posit8 value, the midpoints between neighbours and the numbers right next to them,
+// returns the number of inputs written
+int conversionInputs(double *inputs)
+{
+    int count = 0;
+    for (unsigned int a = 0x01; a <= 0x7F; a++)
+    {
+        double value = goldenValues[a];
+        double next = a < 0x7F ? goldenValues[a + 1] : 2 * value;
+        double mid = (value + next) / 2;
+        double candidates[4] = {value, mid, nextafter(mid, 0), nextafter(mid, INFINITY)};
+        for (int i = 0; i < 4; i++)
+        {
+            inputs[count++] = candidates[i];
+            inputs[count++] = -candidates[i];
+        }
+    }
+    inputs[count++] = 0.0;
+    inputs[count++] = 1e-30;
+    inputs[count++] = -1e30;
+    inputs[count++] = INFINITY;
+    inputs[count++] = -INFINITY;
+    inputs[count++] = NAN;
+    return count;
+}
+
+void checkConversions()
+{
+    char operands[48];
+
+    beginOp("posit8ToDouble");
+    for (unsigned int a = 0; a < 256; a++)
+    {
+        double value;
+        posit8ToDouble(a, &value);
+        // NaR has no value, any result is accepted
+        if (countCheck(a == 0x80 || value == goldenValues[a]))
+        {
+            printf("  posit8ToDouble(a=0x%02X): got %g, expected %g\n", a, value, goldenValues[a]);
+        }
+    }
+    endOp();
+
+    double inputs[256 * 8 + 8];
+    int count = conversionInputs(inputs);
+
+    beginOp("doubleToPosit8");
+    for (int i = 0; i < count; i++)
+    {
+        posit8 got;
+        doubleToPosit8(inputs[i], &got);
+        snprintf(operands, sizeof(operands), "%.17g", inputs[i]);
+        check(got, referenceRound(inputs[i]), operands);
+    }
+    endOp();
+
+    beginOp("floatToPosit8");
+    for (int i = 0; i < count; i++)
+    {
+        // the float rounding can move a value next to a midpoint onto it, so check the float value
+        float input = inputs[i];
+        posit8 got;
+        floatToPosit8(input, &got);
+        snprintf(operands, sizeof(operands), "%.9g", input);
+        check(got, referenceRound(input), operands);
+    }
+    endOp();
+
+    beginOp("halfToPosit8");
+    for (unsigned int h = 0; h < 65536; h++)
+    {
+        posit8 got;
+        halfToPosit8(h, &got);
+        snprintf(operands, sizeof(operands), "0x%04X", h);
+        check(got, referenceRound(halfToDouble(h)), operands);
+    }
+    endOp();
+
+}
+
+void checkFused()
+{
+    char operands[48];
+
+    // all 2^24 triples, the exact a * b + c needs at most 24 significant bits
+    beginOp("fmaPosit8");
+    for (unsigned int a = 0; a < 256; a++)
+    {
+        for (unsigned int b = 0; b < 256; b++)
+        {
+            for (unsigned int c = 0; c < 256; c++)
+            {
+                posit8 got;
+                fmaPosit8(a, b, c, &got);
+                posit8 expected = referenceRound(goldenValues[a] * goldenValues[b] + goldenValues[c]);
+                if (got != expected)
+                {
+                    snprintf(operands, sizeof(operands), "a=0x%02X b=0x%02X c=0x%02X", a, b, c);
+                }
+                check(got, expected, operands);
+            }
+        }
+    }
+    endOp();
+
+    // the quire keeps every partial sum exact, so a whole row of products is rounded once.
+    // Rows of a and b over all 256 values, rotated against each other, every product is
+    // a multiple of 2^-12 below 2^12 and the sums stay exact in double.
+    beginOp("fdpPosit8");
+    for (unsigned int shift = 0; shift < 256; shift++)
+    {
+        quire8 q;
+        clearQuire8(&q);
+        double exact = 0.0;
+        for (unsigned int i = 0; i < 256; i++)
+        {
+            posit8 a = i;
+            posit8 b = (i + shift) & 0xFF;
+            // leave out NaR so the sum is not NaR for every row
+            if (a == 0x80 || b == 0x80)
+            {
+                continue;
+            }
+            fdpPosit8(&q, a, b);
+            exact += goldenValues[a] * goldenValues[b];
+        }
+        posit8 got;
+        quire8ToPosit8(q, &got);
+        snprintf(operands, sizeof(operands), "rotation %u", shift);
+        check(got, referenceRound(exact), operands);
+    }
+    endOp();
+
+    // the bias is added in the quire and rounded once with the sum, then scaled and activated.
+    // Every value and bias except NaR with a set of scales, NaR quires have to stay NaR
+    beginOp("epiloguePosit8");
+    const posit8 scales[] = {0x40, 0x00, 0x01, 0x20, 0x48, 0x60, 0x7F, 0xC0};
+    for (unsigned int x = 0; x < 256; x++)
+    {
+        for (unsigned int bias = 0; bias < 256; bias++)
+        {
+            for (unsigned int s = 0; s < sizeof(scales) && x != 0x80 && bias != 0x80; s++)
+            {
+                posit8 scale = scales[s];
+                quire8 q;
+                posit8ToQuire8(x, &q);
+                posit8 sum = referenceRound(goldenValues[x] + goldenValues[bias]);
+                posit8 scaled = scale == 0x40 ? sum : referenceRound(goldenValues[sum] * goldenValues[scale]);
+
+                posit8 expected[3] = {scaled, (scaled & 0x80) ? 0x0 : scaled, (posit8)((scaled ^ 0x80) >> 2)};
+                for (int activation = 0; activation < 3; activation++)
+                {
+                    posit8 got = epiloguePosit8(q, bias, scale, activation);
+                    if (got != expected[activation])
+                    {
+                        snprintf(operands, sizeof(operands), "x=0x%02X bias=0x%02X scale=0x%02X act=%d", x, bias, scale, activation);
+                    }
+                    check(got, expected[activation], operands);
+                }
+            }
+        }
+    }
+    for (int activation = 0; activation < 3; activation++)
+    {
+        snprintf(operands, sizeof(operands), "NaR quire act=%d", activation);
+        check(epiloguePosit8(QUIRE8_NAR, 0x40, 0x48, activation), 0x80, operands);
+        snprintf(operands, sizeof(operands), "NaR bias act=%d", activation);
+        check(epiloguePosit8(0, 0x80, 0x40, activation), 0x80, operands);
+    }
+    endOp();
+}
+
+// the first calls of the batch functions fill the lookup tables, several threads making them at the
+// same time have to see complete tables
+#define INIT_THREADS 4
+
+static posit8 initA[65536], initB[65536];
+static posit8 initResults[INIT_THREADS][65536];
+
+void *multiplyAllPairs(void *arg)
+{
+    multPosit8Array(initA, initB, initResults[(size_t)arg], 65536);
+    return NULL;
+}
+
+void checkConcurrentInit()
+{
+    beginOp("initPosit8Lut");
+    for (unsigned int i = 0; i < 65536; i++)
+    {
+        initA[i] = i >> 8;
+        initB[i] = i & 0xFF;
+    }
+    pthread_t threads[INIT_THREADS];
+    for (size_t t = 0; t < INIT_THREADS; t++)
+    {
+        pthread_create(&threads[t], NULL, multiplyAllPairs, (void *)t);
+    }
+    for (size_t t = 0; t < INIT_THREADS; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    for (size_t t = 0; t < INIT_THREADS; t++)
+    {
+        for (unsigned int i = 0; i < 65536; i++)
+        {
+            posit8 expected;
+            multPosit8(i >> 8, i & 0xFF, &expected);
+            if (countCheck(initResults[t][i] == expected))
+            {
+                printf("  thread %zu multPosit8Array(a=0x%02X b=0x%02X): got 0x%02X, expected 0x%02X\n", t, i >> 8, i & 0xFF,
+                       initResults[t][i], expected);
+            }
+        }
+    }
+    endOp();
+}
+
+// the batch functions of the selected instruction set, level is the name of their path
+void checkArrays(const char *level)
+{
+    char op[48];
+    char operands[48];
+
+    // all pairs in one call, the vectorized paths see every operand combination
+    static posit8 a[65536], b[65536], result[65536];
+    for (unsigned int i = 0; i < 65536; i++)
+    {
+        a[i] = i >> 8;
+        b[i] = i & 0xFF;
+    }
+
+    const char *names[2] = {"addPosit8Array", "multPosit8Array"};
+    for (int k = 0; k < 2; k++)
+    {
+        snprintf(op, sizeof(op), "%s/%s", names[k], level);
+        beginOp(op);
+        if (k == 0)
+        {
+            addPosit8Array(a, b, result, 65536);
+        }
+        else
+        {
+            multPosit8Array(a, b, result, 65536);
+        }
+        for (unsigned int i = 0; i < 65536; i++)
+        {
+            double x = goldenValues[a[i]];
+            double y = goldenValues[b[i]];
+            posit8 expected = referenceRound(k == 0 ? x + y : x * y);
+            if (result[i] != expected)
+            {
+                snprintf(operands, sizeof(operands), "a=0x%02X b=0x%02X", a[i], b[i]);
+            }
+            check(result[i], expected, operands);
+        }
+        endOp();
+    }
+
+    double inputs[256 * 8 + 8];
+    int count = conversionInputs(inputs);
+    snprintf(op, sizeof(op), "floatToPosit8Array/%s", level);
+    beginOp(op);
+    float floats[256 * 8 + 8];
+    posit8 results[256 * 8 + 8];
+    for (int i = 0; i < count; i++)
+    {
+        floats[i] = inputs[i];
+    }
+    floatToPosit8Array(floats, results, count);
+    for (int i = 0; i < count; i++)
+    {
+        snprintf(operands, sizeof(operands), "%.9g", floats[i]);
+        check(results[i], referenceRound(floats[i]), operands);
+    }
+    endOp();
+
+    snprintf(op, sizeof(op), "posit8ToFloatArray/%s", level);
+    beginOp(op);
+    posit8 all[256];
+    float values[256];
+    for (unsigned int i = 0; i < 256; i++)
+    {
+        all[i] = i;
+    }
+    posit8ToFloatArray(all, values, 256);
+    for (unsigned int i = 0; i < 256; i++)
+    {
+        bool equal = i == 0x80 ? isnan(values[i]) : values[i] == goldenValues[i];
+        if (countCheck(equal))
+        {
+            printf("  %s(a=0x%02X): got %g, expected %g\n", currentOp, i, values[i], goldenValues[i]);
+        }
+    }
+    endOp();
+
+    snprintf(op, sizeof(op), "dotPosit8/%s", level);
+    beginOp(op);
+    for (unsigned int shift = 0; shift < 256; shift++)
+    {
+        // every 16th row keeps its NaR operands, in the others they become zero
+        bool keepNar = shift % 16 == 0;
+        bool nar = false;
+        double exact = 0.0;
+        for (unsigned int i = 0; i < 256; i++)
+        {
+            a[i] = i;
+            b[i] = (i * 7 + shift) & 0xFF;
+            if (!keepNar)
+            {
+                a[i] = a[i] == 0x80 ? 0x0 : a[i];
+                b[i] = b[i] == 0x80 ? 0x0 : b[i];
+            }
+            if (a[i] == 0x80 || b[i] == 0x80)
+            {
+                nar = true;
+                continue;
+            }
+            exact += goldenValues[a[i]] * goldenValues[b[i]];
+        }
+        posit8 got;
+        dotPosit8(a, b, 256, &got);
+        snprintf(operands, sizeof(operands), "rotation %u", shift);
+        check(got, nar ? 0x80 : referenceRound(exact), operands);
+    }
+    endOp();
+
+}
+
+int main(int argc, char *argv[])
+{
+    const char *goldenFile = argc > 1 ? argv[1] : "8_bit.csv";
+    if (!loadGoldenValues(goldenFile))
+    {
+        return 2;
+    }
+
+    double start = nowMs();
+
+    // before anything else uses the tables
+    checkConcurrentInit();
+    checkBinaryOp("addPosit8", addPosit8, '+');
+    checkBinaryOp("subPosit8", subPosit8, '-');
+    checkBinaryOp("multPosit8", multPosit8, '*');
+    checkBinaryOp("divPosit8", divPosit8, '/');
+    checkBinaryOp("addPosit8Lut", addPosit8Lut, '+');
+    checkBinaryOp("subPosit8Lut", subPosit8Lut, '-');
+    checkBinaryOp("multPosit8Lut", multPosit8Lut, '*');
+    checkBinaryOp("divPosit8Lut", divPosit8Lut, '/');
+    checkConversions();
+    checkFused();
+    // every path of the batch functions the cpu supports, the widest first
+    const char *levels[3] = {"scalar", "avx2", "avx512"};
+    for (int level = POSIT8_SIMD_AVX512; level >= POSIT8_SIMD_SCALAR; level--)
+    {
+        if (setPosit8SimdLevel(level) == level)
+        {
+            checkArrays(levels[level]);
+        }
+        else
+        {
+            printf("%-28s not supported by this cpu, skipped\n", levels[level]);
+        }
+    }
+    setPosit8SimdLevel(POSIT8_SIMD_AVX512);
+
+    printf("%llu checks, %llu mismatches in %.1f ms\n", checks, mismatches, nowMs() - start);
+    return mismatches == 0 ? 0 : 1;
+}
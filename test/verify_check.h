@@ -0,0 +1,41 @@
+// Counting shared by the verifiers: every check is counted, only the first MAX_REPORTED mismatches
+// since the last resetReported() are printed, so a broken operation does not flood the output.
+//   if (countCheck(got == expected)) printf(...);
+#ifndef VERIFY_CHECK_H
+#define VERIFY_CHECK_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define MAX_REPORTED 8 // mismatches printed, all of them are counted
+
+static unsigned long long checks = 0;
+static unsigned long long mismatches = 0;
+static unsigned long long reported = 0;
+
+// counts a check, true if it failed and the caller should print it
+static inline bool countCheck(bool ok)
+{
+    checks++;
+    if (ok)
+    {
+        return false;
+    }
+    mismatches++;
+    return reported++ < MAX_REPORTED;
+}
+
+// e.g. at the start of every operation, so each of them reports its own first mismatches
+static inline void resetReported(void)
+{
+    reported = 0;
+}
+
+// prints the totals, returns the exit code of the verifier
+static inline int reportChecks(void)
+{
+    printf("%llu checks, %llu mismatches\n", checks, mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+#endif
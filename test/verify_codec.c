@@ -0,0 +1,120 @@
+// Round trips of posit8_codec.h: posit8 arrays of several distributions and sizes are encoded and
+// decoded again and have to come back unchanged, blocks whose codes are not smaller than their values
+// are stored. Damaged streams have to be rejected without reading or writing out of bounds. Prints
+// the bits per value of every distribution.
+// Build with compile_verify_c.sh and run ./verify_codec.out, it exits with 1 on mismatches.
+#include "../posit8_codec.h"
+#include "verify_check.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+void check(bool ok, const char *what, const char *distribution, size_t count)
+{
+    if (countCheck(ok))
+    {
+        printf("  %s: %s with %zu values\n", what, distribution, count);
+    }
+}
+
+double uniform()
+{
+    return (rand() + 0.5) / ((double)RAND_MAX + 1);
+}
+
+// normal distribution with the Box-Muller transform
+double gaussian(double sigma)
+{
+    return sigma * sqrt(-2 * log(uniform())) * cos(2 * M_PI * uniform());
+}
+
+void fill(posit8 *values, size_t count, int distribution)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        switch (distribution)
+        {
+        case 0: // all codes equally likely
+            values[i] = rand() & 0xFF;
+            break;
+        case 1: // trained weights
+            doubleToPosit8(gaussian(0.05), &values[i]);
+            break;
+        case 2: // activations around 1
+            doubleToPosit8(gaussian(1.0), &values[i]);
+            break;
+        case 3: // a single code
+            values[i] = 0x40;
+            break;
+        case 4: // a few codes with very different frequencies, the code lengths hit the limit
+            values[i] = (posit8)(__builtin_ctz(rand() | 0x10000) * 7);
+            break;
+        default: // a constant first half, the codes of the uniform second half are longer than its values
+            values[i] = i < count / 2 ? 0x40 : rand() & 0xFF;
+            break;
+        }
+    }
+}
+
+int main()
+{
+    const char *distributions[] = {"uniform", "weights", "activations", "constant", "geometric", "mixed"};
+    const size_t counts[] = {0, 1, 7, 4095, 4096, 4097, 100000, 1000000};
+    const unsigned block_sizes[] = {1, 64, POSIT8_CODEC_BLOCK_SIZE};
+
+    for (int d = 0; d < 6; d++)
+    {
+        size_t input_bytes = 0, stream_bytes = 0;
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+        {
+            size_t count = counts[c];
+            posit8 *values = malloc(count + 1);
+            posit8 *decoded = malloc(count + 1);
+            fill(values, count, d);
+            for (size_t s = 0; s < sizeof(block_sizes) / sizeof(block_sizes[0]); s++)
+            {
+                unsigned block_size = block_sizes[s];
+                if (block_size == 1 && count > 100000)
+                {
+                    continue;
+                }
+                size_t bound = posit8StreamBound(count, block_size);
+                unsigned char *stream = malloc(bound);
+                size_t size = encodePosit8Stream(values, count, block_size, stream);
+                // the bound is the values and the headers, incompressible blocks are stored
+                check(size <= bound, "stream larger than posit8StreamBound", distributions[d], count);
+
+                long long decoded_count = decodePosit8Stream(stream, size, decoded, count);
+                check(decoded_count == (long long)count && memcmp(values, decoded, count) == 0, "round trip", distributions[d], count);
+                if (block_size == POSIT8_CODEC_BLOCK_SIZE)
+                {
+                    input_bytes += count;
+                    stream_bytes += size;
+                }
+
+                if (count > 0)
+                {
+                    // too little room, a truncated stream and a corrupted header
+                    check(decodePosit8Stream(stream, size, decoded, count - 1) == -1, "capacity ignored", distributions[d], count);
+                    check(decodePosit8Stream(stream, size - 1, decoded, count) == -1, "truncated stream accepted", distributions[d], count);
+
+                    // a coded block flagged as stored, its codes are shorter than its values
+                    unsigned char *flag = stream + POSIT8_CODEC_HEADER_SIZE + 3;
+                    if (!(*flag & 0x80))
+                    {
+                        *flag |= 0x80;
+                        check(decodePosit8Stream(stream, size, decoded, count) == -1, "coded block decoded as stored", distributions[d], count);
+                        *flag &= 0x7F;
+                    }
+                    stream[0] ^= 0x01;
+                    check(decodePosit8Stream(stream, size, decoded, count) == -1, "corrupted header accepted", distributions[d], count);
+                }
+                free(stream);
+            }
+            free(values);
+            free(decoded);
+        }
+        printf("%-12s %.2f bits per value\n", distributions[d], 8.0 * stream_bytes / input_bytes);
+    }
+
+    return reportChecks();
+}
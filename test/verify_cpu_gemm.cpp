@@ -0,0 +1,136 @@
+// Checks cpuGemmPosit8 (cpu_gemm.h), the reference for all device results, against a naive loop
+// that sums every row and column in one quire with fdpPosit8 and rounds it once. Covers all 8
+// layouts with padded leading dimensions, shapes that are no multiples of the blocking (MR, NR,
+// MC and KC of cpu_gemm.cpp), NaR rows and columns, the fused epilogue and 1 and several threads.
+// Build with compile_verify_host.sh and run ./verify_cpu_gemm.out, it exits with 1 on mismatches.
+#include <stdlib.h>
+#include <vector>
+#include "cpu_gemm.h"
+#include "../posit8.h"
+#include "verify_check.h"
+
+// C = A * B element by element, with the epilogue if it is not NULL
+void referenceGemm(const unsigned char *A, const unsigned char *B, unsigned char *C, const gemm_params &params, const gemm_epilogue *epilogue)
+{
+    for (unsigned m = 0; m < params.M; m++)
+    {
+        for (unsigned n = 0; n < params.N; n++)
+        {
+            quire8 q;
+            clearQuire8(&q);
+            for (unsigned k = 0; k < params.K; k++)
+            {
+                posit8 a = params.a_col_major ? A[k * params.lda + m] : A[m * params.lda + k];
+                posit8 b = params.b_col_major ? B[n * params.ldb + k] : B[k * params.ldb + n];
+                fdpPosit8(&q, a, b);
+            }
+            posit8 result;
+            if (epilogue)
+            {
+                result = epiloguePosit8(q, epilogue->bias ? epilogue->bias[n] : 0x0, epilogue->scale, epilogue->activation);
+            }
+            else
+            {
+                quire8ToPosit8(q, &result);
+            }
+            C[params.c_col_major ? n * params.ldc + m : m * params.ldc + n] = result;
+        }
+    }
+}
+
+// random posit8 values, mostly small so the sums do not all saturate, without NaR
+unsigned char randomPosit8()
+{
+    unsigned char value = rand() % 4 == 0 ? rand() : 0x30 + rand() % 0x20;
+    value = rand() % 2 ? (unsigned char)-value : value;
+    return value == 0x80 ? 0x40 : value;
+}
+
+void checkShape(unsigned M, unsigned N, unsigned K, unsigned layout, unsigned threads, bool fused)
+{
+    gemm_params params;
+    params.M = M;
+    params.N = N;
+    params.K = K;
+    params.a_col_major = layout & 1;
+    params.b_col_major = (layout >> 1) & 1;
+    params.c_col_major = (layout >> 2) & 1;
+    // padding between the rows (columns) that has to be skipped on reads and kept on writes
+    params.lda = (params.a_col_major ? M : K) + 3;
+    params.ldb = (params.b_col_major ? K : N) + 5;
+    params.ldc = (params.c_col_major ? M : N) + 2;
+
+    std::vector<unsigned char> A((size_t)params.lda * (params.a_col_major ? K : M));
+    std::vector<unsigned char> B((size_t)params.ldb * (params.b_col_major ? N : K));
+    std::vector<unsigned char> bias(N);
+    for (size_t i = 0; i < A.size(); i++)
+    {
+        A[i] = randomPosit8();
+    }
+    for (size_t i = 0; i < B.size(); i++)
+    {
+        B[i] = randomPosit8();
+    }
+    for (unsigned n = 0; n < N; n++)
+    {
+        bias[n] = randomPosit8();
+    }
+
+    // a NaR in the last row of A and in the first column of B turns them into NaR in C
+    if (M > 1)
+    {
+        unsigned k = rand() % K;
+        A[params.a_col_major ? k * params.lda + M - 1 : (M - 1) * params.lda + k] = 0x80;
+    }
+    if (N > 1)
+    {
+        unsigned k = rand() % K;
+        B[params.b_col_major ? k : k * params.ldb] = 0x80;
+    }
+
+    gemm_epilogue epilogue = {bias.data(), 0x48, (int)(layout % 3)};
+    const size_t c_size = (size_t)params.ldc * (params.c_col_major ? N : M);
+    std::vector<unsigned char> got(c_size, 0x5A), expected(c_size, 0x5A);
+    cpuGemmPosit8(A.data(), B.data(), got.data(), params, threads, fused ? &epilogue : NULL);
+    referenceGemm(A.data(), B.data(), expected.data(), params, fused ? &epilogue : NULL);
+
+    // the padding of C is compared as well, it has to be left alone
+    for (size_t i = 0; i < c_size; i++)
+    {
+        if (countCheck(got[i] == expected[i]))
+        {
+            printf("  cpuGemmPosit8(%ux%ux%u layout %u threads %u%s) at %zu: got 0x%02X, expected 0x%02X\n", M, N, K, layout, threads,
+                   fused ? " fused" : "", i, got[i], expected[i]);
+        }
+    }
+}
+
+int main()
+{
+    srand(1);
+
+    // around and across the blocking: MR = 4, NR = 8, MC = 64, KC = 64
+    const unsigned Ms[] = {1, 5, 67, 131};
+    const unsigned Ns[] = {1, 9, 70};
+    const unsigned Ks[] = {1, 63, 130};
+    const unsigned threads[] = {1, 4};
+
+    for (unsigned t = 0; t < 2; t++)
+    {
+        for (unsigned layout = 0; layout < 8; layout++)
+        {
+            for (unsigned m = 0; m < sizeof(Ms) / sizeof(Ms[0]); m++)
+            {
+                for (unsigned n = 0; n < sizeof(Ns) / sizeof(Ns[0]); n++)
+                {
+                    for (unsigned k = 0; k < sizeof(Ks) / sizeof(Ks[0]); k++)
+                    {
+                        checkShape(Ms[m], Ns[n], Ks[k], layout, threads[t], false);
+                        checkShape(Ms[m], Ns[n], Ks[k], layout, threads[t], true);
+                    }
+                }
+            }
+        }
+    }
+    return reportChecks();
+}
@@ -0,0 +1,117 @@
+// Checks the reuse of host_buffer_pool (opencl_utils.h), which -zerocopy and -serve allocate their
+// matrices from: released buffers are handed out again, the smallest free one that fits is taken
+// and nothing is allocated once the pool covers the requests. The OpenCL buffer calls are replaced
+// below, so no device is needed, only the headers and the ICD loader of the generic host build.
+// Build with compile_verify_host.sh and run ./verify_host_pool.out, it exits with 1 on mismatches.
+#include <cstdint>
+#include <map>
+#include "opencl_utils.h"
+#include "verify_check.h"
+
+using namespace ocl_utils;
+
+// buffers created and released through the replaced calls, with their host memory
+static std::map<cl_mem, void *> liveBuffers;
+static unsigned createdBuffers = 0;
+static uintptr_t nextBuffer = 1;
+
+extern "C"
+{
+
+cl_mem clCreateBuffer(cl_context, cl_mem_flags flags, size_t, void *host_ptr, cl_int *status)
+{
+    cl_mem buf = (cl_mem)nextBuffer++;
+    liveBuffers[buf] = (flags & CL_MEM_USE_HOST_PTR) ? host_ptr : NULL;
+    createdBuffers++;
+    *status = CL_SUCCESS;
+    return buf;
+}
+
+void *clEnqueueMapBuffer(cl_command_queue, cl_mem buf, cl_bool, cl_map_flags, size_t, size_t, cl_uint, const cl_event *, cl_event *,
+                         cl_int *status)
+{
+    *status = CL_SUCCESS;
+    return liveBuffers[buf];
+}
+
+cl_int clEnqueueUnmapMemObject(cl_command_queue, cl_mem, void *, cl_uint, const cl_event *, cl_event *event)
+{
+    if (event)
+    {
+        *event = NULL;
+    }
+    return CL_SUCCESS;
+}
+
+cl_int clFinish(cl_command_queue)
+{
+    return CL_SUCCESS;
+}
+
+cl_int clReleaseMemObject(cl_mem buf)
+{
+    liveBuffers.erase(buf);
+    return CL_SUCCESS;
+}
+
+} // extern "C"
+
+// checkError of opencl_utils.cpp calls it before exiting
+void cleanup() {}
+
+void check(bool ok, const char *what)
+{
+    if (countCheck(ok))
+    {
+        printf("  %s\n", what);
+    }
+}
+
+int main()
+{
+    {
+        host_buffer_pool pool(NULL, NULL);
+
+        host_buffer *a = pool.acquire(100);
+        check(a->size == 128 && a->mapped && a->in_use, "acquire rounds up to the alignment and maps");
+        check((uintptr_t)a->ptr % host_buffer_pool::ALIGNMENT == 0, "host memory is aligned");
+        check(liveBuffers[a->buf] == a->ptr, "the buffer uses the host memory");
+
+        // a buffer in use is never handed out twice
+        host_buffer *b = pool.acquire(100);
+        check(b != a && createdBuffers == 2, "a buffer in use is not shared");
+        host_buffer *c = pool.acquire(1000);
+        check(createdBuffers == 3 && pool.allocatedBytes() == 128 + 128 + 1024, "allocated bytes");
+
+        // released buffers come back, the smallest one that fits
+        pool.release(c);
+        pool.release(a);
+        host_buffer *small = pool.acquire(64);
+        check(small == a, "best fit takes the smallest free buffer");
+        host_buffer *large = pool.acquire(512);
+        check(large == c, "a larger request takes the larger free buffer");
+        check(createdBuffers == 3, "no allocation while free buffers fit");
+
+        // a request larger than every free buffer allocates, later ones of that size reuse it
+        pool.release(small);
+        pool.release(large);
+        for (int i = 0; i < 10; i++)
+        {
+            host_buffer *x = pool.acquire(4096);
+            host_buffer *y = pool.acquire(1000);
+            host_buffer *z = pool.acquire(100);
+            pool.unmap(x, 0, NULL, NULL);
+            check(!x->mapped, "unmap");
+            pool.release(x);
+            pool.release(y);
+            pool.release(z);
+        }
+        check(createdBuffers == 4, "repeated requests reuse the pool");
+        host_buffer *again = pool.acquire(4000);
+        check(again->size == 4096 && again->mapped, "an unmapped buffer is mapped again when it is acquired");
+        pool.release(b);
+    }
+    check(liveBuffers.empty(), "the destructor releases every buffer");
+
+    return reportChecks();
+}
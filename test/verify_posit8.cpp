@@ -0,0 +1,116 @@
+// Checks the Posit8 class of posit8.hpp against the C routines of posit8.h, which verify.c checks
+// against the exact reference: all operand pairs of +, -, * and /, all fma triples and the
+// conversions. The generated posit8_tables.h has to match the constexpr reference arithmetic it was
+// made from. The static_asserts make sure the arithmetic folds in constant expressions.
+// Build with compile_verify_cpp.sh and run ./verify_posit8.out, it exits with 1 on mismatches.
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <unordered_set>
+#include <vector>
+#include "../posit8.hpp"
+#include "verify_check.h"
+
+static_assert(sizeof(Posit8) == 1, "Posit8 has to stay a single byte");
+static_assert(Posit8(1.5) + Posit8(0.25) == Posit8(1.75), "constant addition");
+static_assert(Posit8(3) * Posit8(0.5) == Posit8(1.5), "constant multiplication");
+static_assert((Posit8(1) / Posit8(0)).isNaR(), "division by zero is NaR");
+static_assert(Posit8(1000.0) == std::numeric_limits<Posit8>::max(), "saturation at maxpos");
+static_assert(Posit8(1e-10) == std::numeric_limits<Posit8>::min(), "no underflow to zero");
+static_assert(std::numeric_limits<Posit8>::epsilon() == Posit8(0.03125), "epsilon");
+static_assert(Posit8::nar() < std::numeric_limits<Posit8>::lowest(), "NaR is the smallest value");
+static_assert(fma(Posit8(64.0), Posit8(64.0), -Posit8(64.0)) == Posit8(64.0), "fma saturates once");
+static_assert((double)Posit8::fromBits(0x41) == 1.03125, "exact conversion to double");
+
+void check(const char *op, posit8 got, posit8 expected, unsigned a, unsigned b, unsigned c = 0)
+{
+    if (countCheck(got == expected))
+    {
+        printf("  %s(0x%02X, 0x%02X, 0x%02X): got 0x%02X, expected 0x%02X\n", op, a, b, c, got, expected);
+    }
+}
+
+int main()
+{
+    for (unsigned a = 0; a < 256; a++)
+    {
+        Posit8 x = Posit8::fromBits(a);
+        for (unsigned b = 0; b < 256; b++)
+        {
+            Posit8 y = Posit8::fromBits(b);
+            unsigned i = (a << 8) | b;
+            check("addTable", posit8_detail::addTable[i], posit8_detail::add(a, b), a, b);
+            check("multTable", posit8_detail::multTable[i], posit8_detail::mult(a, b), a, b);
+            check("divTable", posit8_detail::divTable[i], posit8_detail::div(a, b), a, b);
+
+            posit8 expected;
+            addPosit8(a, b, &expected);
+            check("+", (x + y).bits(), expected, a, b);
+            subPosit8(a, b, &expected);
+            check("-", (x - y).bits(), expected, a, b);
+            multPosit8(a, b, &expected);
+            check("*", (x * y).bits(), expected, a, b);
+            divPosit8(a, b, &expected);
+            check("/", (x / y).bits(), expected, a, b);
+
+            for (unsigned c = 0; c < 256; c++)
+            {
+                fmaPosit8(a, b, c, &expected);
+                check("fma", fma(x, y, Posit8::fromBits(c)).bits(), expected, a, b, c);
+            }
+        }
+
+        double value;
+        posit8ToDouble(a, &value);
+        if (countCheck(a == 0x80 || (double)x == value))
+        {
+            printf("  double(0x%02X): got %g, expected %g\n", a, (double)x, value);
+        }
+    }
+
+    // conversion from double: every midpoint, its neighbours and random values over the whole range
+    std::vector<double> inputs;
+    for (unsigned a = 1; a < 0x7F; a++)
+    {
+        double mid = ((double)Posit8::fromBits(a) + (double)Posit8::fromBits(a + 1)) / 2;
+        inputs.insert(inputs.end(), {mid, std::nextafter(mid, 0.0), std::nextafter(mid, 100.0)});
+    }
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> exponent(-10, 10);
+    for (int i = 0; i < 100000; i++)
+    {
+        inputs.push_back(std::exp2(exponent(random)));
+    }
+    for (double input : inputs)
+    {
+        for (double signed_input : {input, -input})
+        {
+            posit8 expected;
+            doubleToPosit8(signed_input, &expected);
+            check("Posit8(double)", Posit8(signed_input).bits(), expected, 0, 0);
+        }
+    }
+
+    // the order has to agree with the values, so std algorithms work on Posit8
+    std::vector<Posit8> all;
+    for (unsigned a = 0; a < 256; a++)
+    {
+        if (a != 0x80)
+        {
+            all.push_back(Posit8::fromBits(a));
+        }
+    }
+    std::sort(all.begin(), all.end());
+    if (countCheck(std::is_sorted(all.begin(), all.end(), [](Posit8 x, Posit8 y) { return (double)x < (double)y; })))
+    {
+        printf("  std::sort: order of Posit8 differs from the order of the values\n");
+    }
+
+    std::unordered_set<Posit8> distinct(all.begin(), all.end());
+    if (countCheck(distinct.size() == all.size()))
+    {
+        printf("  std::hash: %zu distinct values, expected %zu\n", distinct.size(), all.size());
+    }
+
+    return reportChecks();
+}
@@ -0,0 +1,218 @@
+// Checks the generic posit<nbits, es> routines of positn.h through the Posit class of posit.hpp.
+// Posit<8, 0> has to agree with the posit8 routines (verified by verify.c) for all operand pairs
+// and fma triples. The other formats are compared against an independent reference that decodes
+// the bit strings one by one and rounds exact results to the nearest posit, the rounding point
+// between two neighbours is the posit with one more bit that lies between them (ties to even).
+// Build with compile_verify_cpp.sh and run ./verify_positn.out, it exits with 1 on mismatches.
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include "../posit.hpp"
+#include "verify_check.h"
+
+static_assert(sizeof(Posit<8, 1>) == 1 && sizeof(Posit16) == 2 && sizeof(Posit32) == 4, "smallest storage");
+static_assert(Posit16::fromBits(0x4000) * Posit16::fromBits(0x4000) == Posit16::fromBits(0x4000), "constant 1 * 1");
+static_assert((Posit32::fromBits(0x40000000) / Posit32()).isNaR(), "division by zero is NaR");
+
+void check(const char *format, const char *op, positn got, positn expected, positn a, positn b)
+{
+    if (countCheck(got == expected))
+    {
+        printf("  %s %s(0x%llX, 0x%llX): got 0x%llX, expected 0x%llX\n", format, op, a, b, got, expected);
+    }
+}
+
+// value of an encoding read bit by bit, long double holds every posit up to 33 bits exactly
+long double referenceValue(positn bits, int nbits, int es)
+{
+    if (bits == 0)
+    {
+        return 0;
+    }
+    bool sign = (bits >> (nbits - 1)) & 0x1;
+    if (sign)
+    {
+        bits = ((positn)1 << nbits) - bits;
+    }
+    int i = nbits - 2;
+    int first = (bits >> i) & 0x1;
+    int run = 0;
+    while (i >= 0 && (int)((bits >> i) & 0x1) == first)
+    {
+        run++;
+        i--;
+    }
+    i--; // terminating bit
+    int k = first ? run - 1 : -run;
+
+    int exponent = 0;
+    for (int e = 0; e < es; e++, i--)
+    {
+        exponent = exponent * 2 + (i >= 0 ? (int)((bits >> i) & 0x1) : 0);
+    }
+    long double fraction = 1;
+    for (long double weight = 0.5L; i >= 0; i--, weight /= 2)
+    {
+        fraction += ((bits >> i) & 0x1) ? weight : 0;
+    }
+    long double value = std::ldexp(fraction, k * (1 << es) + exponent);
+    return sign ? -value : value;
+}
+
+// nearest posit to the exact value / divisor. Bit string rounding puts the rounding point between
+// p and p + 1 at the encoding 2p + 1 of the format with one more bit. Candidates are compared
+// through their products with the divisor, which are exact for posits with up to 32 bits
+positn referenceRound(long double value, int nbits, int es, long double divisor = 1)
+{
+    if (value == 0)
+    {
+        return 0;
+    }
+    long double magnitude = std::fabs(value);
+    long double scale = std::fabs(divisor);
+    positn maxpos = ((positn)1 << (nbits - 1)) - 1;
+    positn result;
+    if (magnitude >= referenceValue(maxpos, nbits, es) * scale)
+    {
+        result = maxpos;
+    }
+    else if (magnitude <= referenceValue(1, nbits, es) * scale)
+    {
+        result = 1;
+    }
+    else
+    {
+        positn lo = 1, hi = maxpos;
+        while (hi - lo > 1)
+        {
+            positn mid = (lo + hi) / 2;
+            if (referenceValue(mid, nbits, es) * scale <= magnitude)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        long double rounding = referenceValue(2 * lo + 1, nbits + 1, es) * scale;
+        result = magnitude < rounding || (magnitude == rounding && (lo & 0x1) == 0) ? lo : hi;
+    }
+    return (value < 0) != (divisor < 0) ? negPositN(result, nbits) : result;
+}
+
+// Sums and products of two posits with up to 32 bits are exact in long double (64 bit significand),
+// or the smaller summand is far below every rounding point near the larger one, so rounding in
+// long double keeps the result.
+template <int nbits, int es>
+void checkPair(const char *format, positn a, positn b)
+{
+    typedef Posit<nbits, es> P;
+    P x = P::fromBits(a), y = P::fromBits(b);
+    positn nar = narPositN(nbits);
+    bool anyNaR = a == nar || b == nar;
+    long double va = referenceValue(a, nbits, es), vb = referenceValue(b, nbits, es);
+
+    check(format, "+", (x + y).bits(), anyNaR ? nar : referenceRound(va + vb, nbits, es), a, b);
+    check(format, "-", (x - y).bits(), anyNaR ? nar : referenceRound(va - vb, nbits, es), a, b);
+    check(format, "*", (x * y).bits(), anyNaR ? nar : referenceRound(va * vb, nbits, es), a, b);
+
+    positn quotient = nar;
+    if (!anyNaR && b != 0)
+    {
+        quotient = referenceRound(va, nbits, es, vb);
+    }
+    check(format, "/", (x / y).bits(), quotient, a, b);
+
+    // fma against the separately checked operations where it has to be exact
+    P one = P::fromBits((positn)1 << (nbits - 2));
+    check(format, "fma(a, b, 0)", fma(x, y, P()).bits(), (x * y).bits(), a, b);
+    check(format, "fma(a, 1, b)", fma(x, one, y).bits(), (x + y).bits(), a, b);
+}
+
+template <int nbits, int es>
+void checkConversions(const char *format)
+{
+    typedef Posit<nbits, es> P;
+    std::mt19937_64 random(nbits * 16 + es);
+    std::uniform_real_distribution<double> exponent(-(nbits - 1) * (1 << es), (nbits - 1) * (1 << es));
+    std::uniform_int_distribution<positn> encoding(0, maskPositN(nbits));
+    for (int i = 0; i < 100000; i++)
+    {
+        double input = std::exp2(exponent(random));
+        check(format, "Posit(double)", P(input).bits(), referenceRound(input, nbits, es), 0, 0);
+        check(format, "Posit(double)", P(-input).bits(), referenceRound(-input, nbits, es), 0, 0);
+
+        // exact back and forth
+        positn bits = encoding(random);
+        P p = P::fromBits(bits);
+        if (countCheck(p.isNaR() || ((double)p == (double)referenceValue(bits, nbits, es) && P((double)p) == p)))
+        {
+            printf("  %s double(0x%llX): got %g\n", format, bits, (double)p);
+        }
+    }
+}
+
+// all operand pairs if random_pairs is 0, otherwise random pairs
+template <int nbits, int es>
+void checkFormat(const char *format, unsigned long long random_pairs)
+{
+    positn count = (positn)1 << nbits;
+    if (random_pairs == 0)
+    {
+        for (positn a = 0; a < count; a++)
+        {
+            for (positn b = 0; b < count; b++)
+            {
+                checkPair<nbits, es>(format, a, b);
+            }
+        }
+    }
+    else
+    {
+        std::mt19937_64 random(nbits * 16 + es);
+        std::uniform_int_distribution<positn> encoding(0, count - 1);
+        for (unsigned long long i = 0; i < random_pairs; i++)
+        {
+            checkPair<nbits, es>(format, encoding(random), encoding(random));
+        }
+    }
+    checkConversions<nbits, es>(format);
+    printf("%-12s done, %llu mismatches so far\n", format, mismatches);
+}
+
+int main()
+{
+    // Posit<8, 0> against the posit8 routines, including all fma triples
+    for (unsigned a = 0; a < 256; a++)
+    {
+        Posit<8, 0> x = Posit<8, 0>::fromBits(a);
+        for (unsigned b = 0; b < 256; b++)
+        {
+            Posit<8, 0> y = Posit<8, 0>::fromBits(b);
+            posit8 expected;
+            addPosit8(a, b, &expected);
+            check("posit<8,0>", "+", (x + y).bits(), expected, a, b);
+            subPosit8(a, b, &expected);
+            check("posit<8,0>", "-", (x - y).bits(), expected, a, b);
+            multPosit8(a, b, &expected);
+            check("posit<8,0>", "*", (x * y).bits(), expected, a, b);
+            divPosit8(a, b, &expected);
+            check("posit<8,0>", "/", (x / y).bits(), expected, a, b);
+            for (unsigned c = 0; c < 256; c++)
+            {
+                fmaPosit8(a, b, c, &expected);
+                check("posit<8,0>", "fma", fma(x, y, Posit<8, 0>::fromBits(c)).bits(), expected, a, b);
+            }
+        }
+    }
+    printf("%-12s done, %llu mismatches so far\n", "posit<8,0>", mismatches);
+
+    checkFormat<8, 1>("posit<8,1>", 0);
+    checkFormat<8, 2>("posit<8,2>", 0);
+    checkFormat<12, 1>("posit<12,1>", 1000000);
+    checkFormat<16, 1>("posit<16,1>", 1000000);
+    checkFormat<32, 2>("posit<32,2>", 1000000);
+
+    return reportChecks();
+}
@@ -0,0 +1,69 @@
+// Checks the posit8_vector.h operations against the scalar ones of posit8.h: add, sub, mult and div
+// of every pair of posit8 values in every lane of the 4, 8 and 16 element vectors, and the vector
+// sigmoid and fused dot product on the same inputs.
+// Build with compile_verify_c.sh and run ./verify_vector.out, it exits with 1 on mismatches.
+#include "../posit8_vector.h"
+#include "verify_check.h"
+#include <stdio.h>
+
+void check(bool ok, const char *what, int n, posit8 a, posit8 b)
+{
+    if (countCheck(ok))
+    {
+        printf("  %s of posit8x%d: a = 0x%02x, b = 0x%02x\n", what, n, a, b);
+    }
+}
+
+// all 65536 pairs, n at a time, with pair i + lane in lane
+#define VERIFY_VECTOR(n)                                                                            \
+    void verifyVector##n()                                                                          \
+    {                                                                                               \
+        for (unsigned i = 0; i < 65536; i += n)                                                     \
+        {                                                                                           \
+            posit8x##n a, b, add, sub, mult, div, sigmoid;                                          \
+            posit8 *elementsA = (posit8 *)&a, *elementsB = (posit8 *)&b;                            \
+            for (int lane = 0; lane < n; lane++)                                                    \
+            {                                                                                       \
+                elementsA[lane] = (i + lane) >> 8;                                                  \
+                elementsB[lane] = (i + lane) & 0xFF;                                                \
+            }                                                                                       \
+            addPosit8x##n(a, b, &add);                                                              \
+            subPosit8x##n(a, b, &sub);                                                              \
+            multPosit8x##n(a, b, &mult);                                                            \
+            divPosit8x##n(a, b, &div);                                                              \
+            sigmoid = b;                                                                            \
+            sigmoidPosit8x##n(&sigmoid);                                                            \
+            quire8 vector_quire = 0, scalar_quire = 0;                                              \
+            fdpPosit8x##n(&vector_quire, a, b);                                                     \
+            for (int lane = 0; lane < n; lane++)                                                    \
+            {                                                                                       \
+                posit8 x = elementsA[lane], y = elementsB[lane], expected;                          \
+                addPosit8(x, y, &expected);                                                         \
+                check(((posit8 *)&add)[lane] == expected, "add", n, x, y);                          \
+                subPosit8(x, y, &expected);                                                         \
+                check(((posit8 *)&sub)[lane] == expected, "sub", n, x, y);                          \
+                multPosit8(x, y, &expected);                                                        \
+                check(((posit8 *)&mult)[lane] == expected, "mult", n, x, y);                        \
+                divPosit8(x, y, &expected);                                                         \
+                check(((posit8 *)&div)[lane] == expected, "div", n, x, y);                          \
+                expected = y;                                                                       \
+                sigmoidPosit8(&expected);                                                           \
+                check(((posit8 *)&sigmoid)[lane] == expected, "sigmoid", n, x, y);                  \
+                fdpPosit8(&scalar_quire, x, y);                                                     \
+            }                                                                                       \
+            check(vector_quire == scalar_quire, "fdp", n, elementsA[0], elementsB[0]);              \
+        }                                                                                           \
+    }
+
+VERIFY_VECTOR(4)
+VERIFY_VECTOR(8)
+VERIFY_VECTOR(16)
+
+int main()
+{
+    verifyVector4();
+    verifyVector8();
+    verifyVector16();
+
+    return reportChecks();
+}